@@ -0,0 +1,149 @@
+#include "aggregate.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+#include "column_store.h"
+#include "logging.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "stat_classifier.h"
+#include "stats_renderer.h"
+#include "work_stealing_pool.h"
+
+using namespace std;
+
+// rows per task, a multiple of 64 so tasks split the presence bitmaps on word boundaries
+static const size_t rowsPerTask = 16384;
+
+struct RowBlock {
+    size_t group;
+    size_t begin;
+    size_t end;
+};
+
+// higher values first, ties go to the lower SteamID64 so results don't depend on thread timing
+static bool Better(const RankedPlayer &a, const RankedPlayer &b) {
+    return a.value != b.value ? a.value > b.value : a.steamId < b.steamId;
+}
+
+// top is a heap with the worst of the kept players in front
+static void Offer(vector<RankedPlayer> &top, size_t limit, RankedPlayer player) {
+    if (top.size() < limit) {
+        top.push_back(player);
+        push_heap(top.begin(), top.end(), Better);
+    } else if (limit > 0 && Better(player, top.front())) {
+        pop_heap(top.begin(), top.end(), Better);
+        top.back() = player;
+        push_heap(top.begin(), top.end(), Better);
+    }
+}
+
+vector<StatAggregate> AggregateColumns(const ColumnStoreReader &reader, const vector<uint32_t> &stats,
+                                       const vector<bool> &ranked, size_t top, WorkStealingPool &pool) {
+    vector<RowBlock> blocks;
+    for (size_t group = 0; group < reader.rowGroups(); group++) {
+        for (size_t begin = 0; begin < reader.rowGroupRows(group); begin += rowsPerTask) {
+            blocks.push_back({group, begin, min(begin + rowsPerTask, reader.rowGroupRows(group))});
+        }
+    }
+
+    // one set of aggregates per thread, nothing is shared until the merge
+    vector<vector<StatAggregate>> partial(pool.size(), vector<StatAggregate>(stats.size()));
+    pool.ForEach(blocks.size(), [&](size_t index, unsigned worker) {
+        const RowBlock &block = blocks[index];
+        span<const uint64_t> steamIds = reader.SteamIds(block.group);
+        for (size_t i = 0; i < stats.size(); i++) {
+            ColumnChunk column = reader.Column(block.group, stats[i]);
+            if (column.values.empty()) {
+                continue;
+            }
+            StatAggregate &aggregate = partial[worker][i];
+            // only the rows that have the stat, a word of the bitmap at a time
+            for (size_t word = block.begin / 64; word < (block.end + 63) / 64; word++) {
+                for (uint64_t bits = column.presence[word]; bits != 0; bits &= bits - 1) {
+                    size_t row = word * 64 + (size_t) countr_zero(bits);
+                    int64_t value = column.values[row];
+                    aggregate.sum += value;
+                    aggregate.sketch.Add((double) value);
+                    if (ranked[i]) {
+                        Offer(aggregate.top, top, {steamIds[row], value});
+                    }
+                }
+            }
+        }
+    });
+
+    vector<StatAggregate> result(stats.size());
+    pool.ForEach(stats.size(), [&](size_t i, unsigned) {
+        StatAggregate &merged = result[i];
+        merged.name = reader.stats()[stats[i]].name;
+        merged.description = reader.stats()[stats[i]].description;
+        for (auto &threadAggregates: partial) {
+            StatAggregate &aggregate = threadAggregates[i];
+            merged.sum += aggregate.sum;
+            merged.sketch.Merge(aggregate.sketch);
+            for (const RankedPlayer &player: aggregate.top) {
+                Offer(merged.top, top, player);
+            }
+        }
+        sort(merged.top.begin(), merged.top.end(), Better);
+    });
+    return result;
+}
+
+int RunAggregate(const Options &options) {
+    ColumnStoreReader reader;
+    if (!reader.Open(options.aggregateFile)) {
+        return EXIT_FAILURE;
+    }
+
+    vector<string> rankStats = options.rankStats;
+    if (rankStats.empty()) {
+        for (auto className: tfClassNames) {
+            rankStats.push_back(string(className) + ".accum.iPlayTime");
+        }
+    }
+
+    vector<uint32_t> stats;
+    vector<bool> ranked;
+    size_t rankedCount = 0;
+    for (uint32_t i = 0; i < reader.stats().size(); i++) {
+        const string &name = reader.stats()[i].name;
+        StatName parsed = ClassifyStat(name);
+        if ((parsed.category == StatCategory::Class && !parsed.isClassTemplate) ||
+            parsed.category == StatCategory::Map) {
+            stats.push_back(i);
+            ranked.push_back(find(rankStats.begin(), rankStats.end(), name) != rankStats.end());
+            rankedCount += ranked.back();
+        }
+    }
+    if (!options.rankStats.empty() && rankedCount < options.rankStats.size()) {
+        fprintf(stderr, "Some of the stats to rank are not class or map stats in %s, they are left out\n",
+                options.aggregateFile.c_str());
+    }
+
+    auto start = chrono::steady_clock::now();
+    WorkStealingPool pool(options.workers);
+    vector<StatAggregate> aggregates = AggregateColumns(reader, stats, ranked, options.top, pool);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    Log(Verbosity::Normal, "Aggregated %zu stats of %zu players on %zu threads in %.2fs\n", stats.size(),
+        reader.rows(), pool.size(), seconds);
+    Log(Verbosity::Verbose, "%llu blocks of rows ran on another thread than they were given to\n",
+        (unsigned long long) pool.stolen());
+
+    StatsRenderer renderer;
+    OutputBuffer output;
+    if (!output.Open(options.output)) {
+        fprintf(stderr, "Error: could not open %s for writing\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    renderer.RenderAggregates(aggregates, reader.rows(), output.stream());
+    if (!output.Close()) {
+        fprintf(stderr, "Error: could not write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "quantile_sketch.h"
+
+struct Options;
+class ColumnStoreReader;
+class WorkStealingPool;
+
+struct RankedPlayer {
+    uint64_t steamId;
+    int64_t value;
+};
+
+// one stat over every player in an export that has it
+struct StatAggregate {
+    std::string name;
+    std::string description;
+    int64_t sum = 0;
+    // players, min and max are the sketch's
+    QuantileSketch sketch;
+    // best first, only filled for ranked stats
+    std::vector<RankedPlayer> top;
+};
+
+// aggregates the given dictionary positions of reader, blocks of rows are spread over pool and
+// every thread keeps its own aggregates until they are merged at the end. top is how many players
+// are ranked for the stats that have ranked set.
+std::vector<StatAggregate> AggregateColumns(const ColumnStoreReader &reader, const std::vector<uint32_t> &stats,
+                                            const std::vector<bool> &ranked, size_t top, WorkStealingPool &pool);
+
+// --aggregate: count, mean, min/max and percentiles of every class and map play time stat in an
+// export, plus the top players by options.rankStats, rendered to options.output.
+// Returns the process exit code.
+int RunAggregate(const Options &options);
@@ -0,0 +1,733 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#include <curl/curl.h>
+
+#include "main.h"
+#include "column_store.h"
+#include "crawl_queue.h"
+#include "data_classes.h"
+#include "http_client.h"
+#include "leaderboard.h"
+#include "logging.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "player_stats_builder.h"
+#include "profiler.h"
+#include "request_scheduler.h"
+#include "response_cache.h"
+#include "snapshot_log.h"
+#include "stat_index.h"
+#include "stats_renderer.h"
+#include "stats_serialization.h"
+#include "stats_writer.h"
+#include "worker_pool.h"
+
+using namespace std;
+
+// GetPlayerSummaries accepts at most this many comma-separated steamids per call
+static const size_t summariesPerRequest = 100;
+// how much of a crawl is lost when its worker dies
+static const chrono::seconds checkpointInterval(1);
+// with --leaderboard every checkpoint saves the whole snapshot first, so they are further apart
+static const chrono::seconds leaderboardCheckpointInterval(30);
+
+struct BatchPlayer {
+    string steamId;
+    PlayerStats stats;
+    string personaName = "User";
+    bool downloaded = false;
+    bool named = false;
+    // stale cache entries, revalidated with a conditional request
+    optional<CacheEntry> cachedStats;
+    optional<CacheEntry> cachedName;
+};
+
+struct PendingRequest {
+    bool isSummary;
+    // the player for stats requests, the chunk in summaryChunks for summaries
+    size_t index;
+    // retries made so far
+    unsigned attempt = 0;
+};
+
+// one easy handle per in-flight slot, reused for every request the slot runs so the multi
+// handle can keep connections alive
+struct TransferSlot {
+    CURL *handle = nullptr;
+    // row of the profile its transfers are drawn on
+    int track = 0;
+    PendingRequest request{};
+    string url;
+    // summaries are small and kept whole, stats are parsed while they arrive
+    string body;
+    PlayerStatsBuilder builder;
+    PlayerStats stats;
+    HttpValidators validators;
+    curl_slist *headers = nullptr;
+};
+
+static size_t AppendToString(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t real_size = size * nmemb;
+    static_cast<string *>(userp)->append(static_cast<char *>(contents), real_size);
+    return real_size;
+}
+
+static size_t StreamToBuilder(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t real_size = size * nmemb;
+    auto builder = static_cast<PlayerStatsBuilder *>(userp);
+    ProfileScope parse(Phase::Parse);
+    parse.AddBytes(real_size);
+    return builder->Feed(static_cast<char *>(contents), real_size) ? real_size : 0;
+}
+
+vector<string> ReadSteamIds(istream &in) {
+    vector<string> ids;
+    unordered_set<string> seen;
+    string line;
+
+    while (getline(in, line)) {
+        auto begin = line.find_first_not_of(" \t\r");
+        if (begin == string::npos || line[begin] == '#') {
+            continue;
+        }
+        auto end = line.find_last_not_of(" \t\r");
+        string id = line.substr(begin, end - begin + 1);
+
+        if (!all_of(id.begin(), id.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            fprintf(stderr, "Skipping invalid SteamID64 \"%s\"\n", id.c_str());
+            continue;
+        }
+        if (seen.insert(id).second) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+class BatchRun {
+public:
+    BatchRun(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache,
+             ColumnStoreWriter *exporter, LeaderboardIndex *leaderboard, OutputBuffer *lines, CrawlQueue *queue,
+             vector<string> ids)
+            : options(options), descriptions(descriptions), cache(cache), exporter(exporter),
+              leaderboard(leaderboard), lines(lines), queue(queue), pool(options.workers) {
+        players.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            players[i].steamId = std::move(ids[i]);
+        }
+
+        // each chunk's summary goes first so its players can be rendered as soon as their
+        // stats arrive
+        for (size_t first = 0; first < players.size(); first += summariesPerRequest) {
+            size_t end = min(first + summariesPerRequest, players.size());
+            vector<size_t> unnamed;
+            vector<size_t> undownloaded;
+            for (size_t i = first; i < end; i++) {
+                LoadFromCache(players[i]);
+                if (!players[i].named) unnamed.push_back(i);
+                if (!players[i].downloaded) undownloaded.push_back(i);
+            }
+            if (cache && cache->offline()) {
+                // nothing more to get, render what the cache had
+                for (size_t i = first; i < end; i++) {
+                    players[i].named = true;
+                    if (players[i].downloaded) {
+                        Render(i);
+                    } else {
+                        fprintf(stderr, "Error: stats for %s are not in the cache\n", players[i].steamId.c_str());
+                        Fail(i);
+                    }
+                }
+                continue;
+            }
+
+            if (!unnamed.empty()) {
+                pending.push_back({true, summaryChunks.size()});
+                summaryChunks.push_back(std::move(unnamed));
+            }
+            for (size_t i: undownloaded) {
+                pending.push_back({false, i});
+            }
+            for (size_t i = first; i < end; i++) {
+                if (players[i].named && players[i].downloaded) {
+                    Render(i);
+                }
+            }
+        }
+
+        multi = curl_multi_init();
+        curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) options.maxInFlight);
+        slots.resize(options.maxInFlight);
+        for (size_t i = 0; i < slots.size(); i++) {
+            slots[i] = make_unique<TransferSlot>();
+            slots[i]->track = (int) i;
+            freeSlots.push_back(slots[i].get());
+        }
+    }
+
+    ~BatchRun() {
+        StopCheckpoints();
+        for (auto &slot: slots) {
+            if (slot->handle) {
+                curl_easy_cleanup(slot->handle);
+            }
+            curl_slist_free_all(slot->headers);
+        }
+        curl_multi_cleanup(multi);
+    }
+
+    void Run() {
+        if (queue) {
+            checkpointer = thread([this] { Checkpoints(); });
+        }
+        int running = 0;
+        while (!pending.empty() || !delayed.empty() || running > 0) {
+            // retries whose backoff is over go back to the front of the line
+            auto now = chrono::steady_clock::now();
+            while (!delayed.empty() && delayed.begin()->first <= now) {
+                pending.push_front(delayed.begin()->second);
+                delayed.erase(delayed.begin());
+            }
+
+            chrono::milliseconds timeout(1000);
+            while (!pending.empty() && !freeSlots.empty()) {
+                string url = RequestUrl(pending.front());
+                auto wait = RequestScheduler::Get().TryAcquire(url, RequestPriority::Background);
+                if (!wait) {
+                    Abandon();
+                    break;
+                }
+                if (wait->count() > 0) {
+                    timeout = min(timeout, *wait);
+                    break;
+                }
+                Start(pending.front(), std::move(url));
+                pending.pop_front();
+                running++;
+            }
+            if (!delayed.empty()) {
+                auto untilRetry = chrono::ceil<chrono::milliseconds>(delayed.begin()->first - now);
+                timeout = clamp(untilRetry, chrono::milliseconds(0), timeout);
+            }
+
+            curl_multi_perform(multi, &running);
+
+            int queued;
+            bool freed = false;
+            while (CURLMsg *msg = curl_multi_info_read(multi, &queued)) {
+                if (msg->msg != CURLMSG_DONE) {
+                    continue;
+                }
+                TransferSlot *slot;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &slot);
+                CURLcode result = msg->data.result;
+                curl_multi_remove_handle(multi, slot->handle);
+                Finish(*slot, result);
+                freeSlots.push_back(slot);
+                freed = true;
+            }
+
+            // a slot that just came free takes the next request right away, without waiting for
+            // a socket that may never wake the poll
+            if (running > 0 || (!freed && (!pending.empty() || !delayed.empty()))) {
+                // also sleeps out the rate limit when nothing is running
+                curl_multi_poll(multi, nullptr, 0, (int) timeout.count(), nullptr);
+            }
+        }
+        pool.Wait();
+        StopCheckpoints();
+    }
+
+    size_t rendered() const { return renderedCount; }
+    size_t failed() const { return failedCount; }
+
+private:
+    // off the transfer loop, a slow disk or a large leaderboard doesn't hold up the downloads
+    void Checkpoints() {
+        auto interval = leaderboard ? leaderboardCheckpointInterval : checkpointInterval;
+        unique_lock lock(checkpointMutex);
+        while (!checkpointStop.wait_for(lock, interval, [this] { return stopCheckpoints; })) {
+            lock.unlock();
+            // the players the checkpoint sets done are ranked on disk before it is written
+            queue->Checkpoint([this] { return !leaderboard || leaderboard->Save(options.leaderboardFile); });
+            lock.lock();
+        }
+    }
+
+    void StopCheckpoints() {
+        if (!checkpointer.joinable()) {
+            return;
+        }
+        {
+            lock_guard lock(checkpointMutex);
+            stopCheckpoints = true;
+        }
+        checkpointStop.notify_all();
+        checkpointer.join();
+    }
+
+    void Fail(size_t index) {
+        failedCount++;
+        if (queue) {
+            queue->Set(index, CrawlState::Failed);
+        }
+    }
+
+    // fresh entries fill the player in, stale ones are kept for revalidation
+    void LoadFromCache(BatchPlayer &player) {
+        if (!cache) {
+            return;
+        }
+        auto statsEntry = cache->Load(statsCacheEndpoint, player.steamId);
+        // entries written by an older version are downloaded again
+        if (statsEntry && IsCurrentStatsPayload(statsEntry->payload)) {
+            if (cache->IsFresh(*statsEntry) &&
+                DeserializePlayerStats(statsEntry->payload, descriptions, player.stats)) {
+                player.downloaded = true;
+            } else {
+                player.stats = PlayerStats();
+                player.cachedStats = std::move(statsEntry);
+            }
+        }
+        if (auto entry = cache->Load(personaCacheEndpoint, player.steamId)) {
+            if (cache->IsFresh(*entry)) {
+                player.personaName = entry->payload;
+                player.named = true;
+            } else {
+                player.cachedName = std::move(entry);
+            }
+        }
+    }
+
+    string RequestUrl(const PendingRequest &request) const {
+        if (request.isSummary) {
+            string steamIds;
+            for (size_t i: summaryChunks[request.index]) {
+                steamIds += (steamIds.empty() ? "" : ",") + players[i].steamId;
+            }
+            return BuildApiUrl(options.apiBase, playerSummariesEndpoint, options.apiKey, steamIds);
+        }
+        return BuildApiUrl(options.apiBase, statsEndpoint, options.apiKey, players[request.index].steamId);
+    }
+
+    void Start(const PendingRequest &request, string url) {
+        TransferSlot *slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        if (!slot->handle) {
+            slot->handle = curl_easy_init();
+            curl_easy_setopt(slot->handle, CURLOPT_PRIVATE, (void *) slot);
+            curl_easy_setopt(slot->handle, CURLOPT_HEADERFUNCTION, CaptureValidators);
+            curl_easy_setopt(slot->handle, CURLOPT_HEADERDATA, (void *) &slot->validators);
+            HttpClient::Get().Configure(slot->handle);
+        }
+
+        curl_slist_free_all(slot->headers);
+        slot->headers = nullptr;
+        slot->validators = HttpValidators();
+        if (request.isSummary) {
+            // summaries are not revalidated, one changed name would invalidate the whole chunk
+            slot->body.clear();
+            curl_easy_setopt(slot->handle, CURLOPT_WRITEFUNCTION, AppendToString);
+            curl_easy_setopt(slot->handle, CURLOPT_WRITEDATA, (void *) &slot->body);
+        } else {
+            auto &player = players[request.index];
+            if (queue) {
+                queue->Set(request.index, CrawlState::InFlight);
+            }
+            if (player.cachedStats) {
+                slot->headers = ConditionalRequestHeaders(*player.cachedStats);
+            }
+            slot->stats = PlayerStats();
+            slot->builder.Reset(descriptions);
+            curl_easy_setopt(slot->handle, CURLOPT_WRITEFUNCTION, StreamToBuilder);
+            curl_easy_setopt(slot->handle, CURLOPT_WRITEDATA, (void *) &slot->builder);
+        }
+
+        slot->request = request;
+        slot->url = std::move(url);
+        curl_easy_setopt(slot->handle, CURLOPT_URL, slot->url.c_str());
+        curl_easy_setopt(slot->handle, CURLOPT_HTTPHEADER, slot->headers);
+        curl_multi_add_handle(multi, slot->handle);
+    }
+
+    void Finish(TransferSlot &slot, CURLcode code) {
+        const PendingRequest &request = slot.request;
+        ProfileTransfer(slot.handle, slot.track, request.isSummary ? "summaries" : players[request.index].steamId);
+
+        HttpResult result;
+        result.code = code;
+        result.validators = slot.validators;
+        curl_easy_getinfo(slot.handle, CURLINFO_RESPONSE_CODE, &result.status);
+        curl_off_t retryAfter = 0;
+        curl_easy_getinfo(slot.handle, CURLINFO_RETRY_AFTER, &retryAfter);
+        result.retryAfter = chrono::seconds(retryAfter);
+        if (auto delay = RequestScheduler::Get().RetryAfter(slot.url, result, request.attempt)) {
+            string reason = result.status >= 400 ? "HTTP " + to_string(result.status) : curl_easy_strerror(code);
+            Log(Verbosity::Normal, "Request for %s failed (%s), retrying in %.1fs\n",
+                request.isSummary ? "summaries" : players[request.index].steamId.c_str(), reason.c_str(),
+                delay->count() / 1000.0);
+            PendingRequest retry = request;
+            retry.attempt++;
+            delayed.emplace(chrono::steady_clock::now() + *delay, retry);
+            return;
+        }
+
+        bool ok = result.ok();
+        if (!ok && result.status >= 400) {
+            fprintf(stderr, "Request failed with HTTP %ld\n", result.status);
+        } else if (!ok) {
+            fprintf(stderr, "Request failed: %s\n", curl_easy_strerror(code));
+        }
+
+        if (request.isSummary) {
+            map<string, string> names;
+            if (ok) {
+                try {
+                    names = ParsePersonaNames(slot.body);
+                } catch (const exception &e) {
+                    fprintf(stderr, "Error: could not parse player summaries: %s\n", e.what());
+                }
+            }
+            NameChunk(request.index, names);
+            return;
+        }
+
+        auto &player = players[request.index];
+        if (ok && result.status == 304 && player.cachedStats &&
+            DeserializePlayerStats(player.cachedStats->payload, descriptions, slot.stats)) {
+            cache->Store(statsCacheEndpoint, player.steamId, *player.cachedStats);
+        } else if (ok && !slot.builder.Finish()) {
+            fprintf(stderr, "Error: malformed stats response: %s\n", slot.builder.error().c_str());
+            ok = false;
+        } else if (ok) {
+            slot.stats = slot.builder.Build();
+            if (cache) {
+                CacheEntry entry{0, slot.validators.etag, slot.validators.lastModified,
+                                 SerializePlayerStats(slot.stats)};
+                cache->Store(statsCacheEndpoint, player.steamId, entry);
+            }
+        }
+        player.cachedStats.reset();
+        if (!ok) {
+            fprintf(stderr, "Error: could not fetch stats for %s\n", player.steamId.c_str());
+            Fail(request.index);
+            return;
+        }
+        player.stats = std::move(slot.stats);
+        player.downloaded = true;
+        if (player.named) {
+            Render(request.index);
+        }
+    }
+
+    // players missing from names keep their cached or the default name
+    void NameChunk(size_t chunk, const map<string, string> &names) {
+        for (size_t i: summaryChunks[chunk]) {
+            auto &player = players[i];
+            auto it = names.find(player.steamId);
+            if (it != names.end()) {
+                player.personaName = it->second;
+                if (cache) {
+                    CacheEntry entry{0, "", "", player.personaName};
+                    cache->Store(personaCacheEndpoint, player.steamId, entry);
+                }
+            } else if (player.cachedName) {
+                player.personaName = player.cachedName->payload;
+            }
+            player.cachedName.reset();
+            player.named = true;
+            if (player.downloaded) {
+                Render(i);
+            }
+        }
+    }
+
+    // the daily budget is spent: players whose stats are in still get rendered, the rest fail (and
+    // stay pending in a crawl queue)
+    void Abandon() {
+        if (!budgetSpent) {
+            fprintf(stderr, "Error: the daily API budget is spent, the remaining requests are not made\n");
+            budgetSpent = true;
+        }
+        for (auto &[time, request]: delayed) {
+            pending.push_back(request);
+        }
+        delayed.clear();
+        for (const PendingRequest &request: pending) {
+            if (request.isSummary) {
+                NameChunk(request.index, {});
+            } else {
+                fprintf(stderr, "Error: could not fetch stats for %s\n", players[request.index].steamId.c_str());
+                failedCount++;
+                if (queue) {
+                    queue->Set(request.index, CrawlState::Pending);
+                }
+            }
+        }
+        pending.clear();
+    }
+
+    void Render(size_t index) {
+        pool.Submit([this, index] {
+            auto &player = players[index];
+            if (!options.historyDir.empty() && !options.offline) {
+                RecordSnapshot(options.historyDir, player.steamId, player.stats);
+            }
+            try {
+                {
+                    ProfileScope render(Phase::Render, player.steamId);
+                    if (lines) {
+                        WriteLine(player);
+                    } else {
+                        WriteFile(player);
+                    }
+                }
+                if (exporter && !exporter->Add(player.steamId, player.stats)) {
+                    throw runtime_error("could not export them");
+                }
+                if (leaderboard) {
+                    const string &steamId = player.steamId;
+                    uint64_t id = 0;
+                    auto [end, error] = from_chars(steamId.data(), steamId.data() + steamId.size(), id);
+                    if (error == errc() && end == steamId.data() + steamId.size()) {
+                        leaderboard->Update(id, player.stats);
+                    }
+                }
+                renderedCount++;
+                if (queue) {
+                    queue->Set(index, CrawlState::Done);
+                }
+            } catch (const exception &e) {
+                fprintf(stderr, "Error: could not render stats for %s: %s\n", player.steamId.c_str(), e.what());
+                Fail(index);
+            }
+            player.stats = PlayerStats();
+        });
+    }
+
+    void WriteFile(const BatchPlayer &player) {
+        auto file = filesystem::path(options.outDir) / (player.steamId + "." + FormatName(options.format));
+        // one buffer per worker, reused for every file it writes
+        thread_local OutputBuffer output;
+        if (!output.Open(file.string())) {
+            throw runtime_error("could not open " + file.string());
+        }
+        switch (options.format) {
+            case OutputFormat::Json:
+                WriteStatsJson(player.stats, player.steamId, player.personaName, output.stream());
+                output.Write("\n");
+                break;
+            case OutputFormat::Csv:
+                WriteCsvHeader(output.stream());
+                WriteStatsCsv(player.stats, player.steamId, player.personaName, output.stream());
+                break;
+            default:
+                renderer.Render(player.stats, player.personaName, output.stream());
+        }
+        if (!output.Close()) {
+            throw runtime_error("could not write " + file.string());
+        }
+    }
+
+    // NDJSON: the player's line is made on the worker, then appended and flushed right away so
+    // whatever reads the output sees every player as soon as it is parsed
+    void WriteLine(const BatchPlayer &player) {
+        thread_local ostringstream line;
+        line.str("");
+        WriteStatsJson(player.stats, player.steamId, player.personaName, line);
+        line << '\n';
+        lock_guard lock(linesMutex);
+        lines->Write(line.view());
+        if (!lines->stream().flush()) {
+            throw runtime_error("could not write " + options.output);
+        }
+    }
+
+    const Options &options;
+    const StatDescriptionIndex &descriptions;
+    const ResponseCache *cache;
+    ColumnStoreWriter *exporter;
+    LeaderboardIndex *leaderboard;
+    // the shared NDJSON output, null when every player gets a file of their own
+    OutputBuffer *lines;
+    mutex linesMutex;
+    // the crawl's work queue, players are its items in the same order, null outside of crawls
+    CrawlQueue *queue;
+    StatsRenderer renderer;
+    vector<BatchPlayer> players;
+    vector<vector<size_t>> summaryChunks;
+    deque<PendingRequest> pending;
+    // retries, by when their backoff is over
+    multimap<chrono::steady_clock::time_point, PendingRequest> delayed;
+    CURLM *multi = nullptr;
+    vector<unique_ptr<TransferSlot>> slots;
+    vector<TransferSlot *> freeSlots;
+    atomic<size_t> renderedCount{0};
+    atomic<size_t> failedCount{0};
+    bool budgetSpent = false;
+    thread checkpointer;
+    mutex checkpointMutex;
+    condition_variable checkpointStop;
+    bool stopCheckpoints = false;
+    // declared last so its threads are joined before anything they touch is destroyed
+    WorkerPool pool;
+};
+
+static bool ReadBatchFile(const string &path, vector<string> &ids) {
+    if (path == "-") {
+        ids = ReadSteamIds(cin);
+        return true;
+    }
+    ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Error: could not open %s\n", path.c_str());
+        return false;
+    }
+    ids = ReadSteamIds(in);
+    return true;
+}
+
+// creates the queue from the batch file the first time, then loads the shard's players that are
+// still to do
+static bool OpenCrawlQueue(const Options &options, CrawlQueue &queue, vector<string> &ids) {
+    error_code ec;
+    if (!filesystem::exists(options.queueFile, ec)) {
+        if (options.batchFile.empty()) {
+            fprintf(stderr, "Error: %s does not exist, create it with --batch <file>\n", options.queueFile.c_str());
+            return false;
+        }
+        if (!ReadBatchFile(options.batchFile, ids)) {
+            return false;
+        }
+        if (CrawlQueue::Create(options.queueFile, ids)) {
+            Log(Verbosity::Normal, "Created %s with %zu players\n", options.queueFile.c_str(), ids.size());
+        } else if (filesystem::exists(options.queueFile, ec)) {
+            Log(Verbosity::Normal, "%s was created by another worker, resuming it\n", options.queueFile.c_str());
+        } else {
+            return false;
+        }
+    } else if (!options.batchFile.empty()) {
+        Log(Verbosity::Normal, "Resuming %s, %s is not read\n", options.queueFile.c_str(), options.batchFile.c_str());
+    }
+
+    auto start = chrono::steady_clock::now();
+    if (!queue.Open(options.queueFile, options.shard, options.shards)) {
+        return false;
+    }
+    ids = queue.steamIds();
+    const CrawlResume &resume = queue.resume();
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    Log(Verbosity::Normal,
+        "Shard %u/%u: %zu players, %zu done, %zu interrupted, %zu to retry, %zu given up (opened in %.1fms)\n",
+        options.shard + 1, options.shards, resume.players, resume.done, resume.interrupted, resume.retried,
+        resume.givenUp, milliseconds);
+    return true;
+}
+
+int RunBatch(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache) {
+    vector<string> ids;
+    optional<CrawlQueue> queue;
+    if (!options.queueFile.empty()) {
+        if (!OpenCrawlQueue(options, queue.emplace(), ids)) {
+            return EXIT_FAILURE;
+        }
+    } else if (!ReadBatchFile(options.batchFile, ids)) {
+        return EXIT_FAILURE;
+    }
+
+    error_code ec;
+    filesystem::create_directories(options.outDir, ec);
+    if (ec) {
+        fprintf(stderr, "Error: could not create %s: %s\n", options.outDir.c_str(), ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    optional<ColumnStoreWriter> exporter;
+    if (!options.exportFile.empty() && !exporter.emplace().Open(options.exportFile)) {
+        return EXIT_FAILURE;
+    }
+
+    // every run ranks its players together with the ones the runs before it ranked
+    optional<LeaderboardIndex> leaderboard;
+    if (!options.leaderboardFile.empty()) {
+        leaderboard.emplace();
+        if (filesystem::exists(options.leaderboardFile, ec) &&
+            !leaderboard->Load(options.leaderboardFile, descriptions)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // a resumed crawl adds to the lines of the runs before it
+    optional<OutputBuffer> lines;
+    if (options.format == OutputFormat::Ndjson && !lines.emplace().Open(options.output, queue.has_value())) {
+        fprintf(stderr, "Error: could not open %s for writing\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    auto start = chrono::steady_clock::now();
+    size_t rendered;
+    size_t failed;
+    // initializes curl before any transfer starts
+    HttpClient::Get();
+    {
+        BatchRun run(options, descriptions, cache, exporter ? &*exporter : nullptr,
+                     leaderboard ? &*leaderboard : nullptr, lines ? &*lines : nullptr, queue ? &*queue : nullptr,
+                     std::move(ids));
+        run.Run();
+        rendered = run.rendered();
+        failed = run.failed();
+    }
+    if (lines && !lines->Close()) {
+        fprintf(stderr, "Error: could not write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    // saved before the queue's last checkpoint, like at every other one
+    if (leaderboard) {
+        if (!leaderboard->Save(options.leaderboardFile)) {
+            return EXIT_FAILURE;
+        }
+        Log(Verbosity::Normal, "%s now ranks %zu players\n", options.leaderboardFile.c_str(),
+            leaderboard->players());
+    }
+    if (queue && !queue->Close()) {
+        return EXIT_FAILURE;
+    }
+    if (exporter) {
+        size_t rows = exporter->rows();
+        if (!exporter->Close()) {
+            return EXIT_FAILURE;
+        }
+        Log(Verbosity::Normal, "%s now holds %zu players\n", options.exportFile.c_str(), rows);
+    }
+
+    SchedulerMetrics scheduler = RequestScheduler::Get().metrics();
+    if (scheduler.retried > 0) {
+        Log(Verbosity::Normal, "%llu requests retried, %llu throttled\n",
+            (unsigned long long) scheduler.retried, (unsigned long long) scheduler.throttled);
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    Log(Verbosity::Normal, "%zu players rendered, %zu failed in %.2fs (%.1f players/s)\n", rendered, failed,
+        seconds, seconds > 0 ? rendered / seconds : 0.0);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+struct Options;
+class StatDescriptionIndex;
+class ResponseCache;
+
+// one SteamID64 per line, blank lines and lines starting with # are skipped, duplicates dropped
+std::vector<std::string> ReadSteamIds(std::istream &in);
+
+// fetches every SteamID64 in options.batchFile through a single curl multi handle, parsing each
+// response as it arrives, and renders each player to <outDir>/<steamid64>.md on a worker pool.
+// Fresh cache entries skip the network entirely, stale ones are revalidated. cache may be null.
+// With options.queueFile the players come from a crawl queue instead and every one's progress is
+// checkpointed to it, see CrawlQueue. Returns the process exit code.
+int RunBatch(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache);
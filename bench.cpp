@@ -0,0 +1,680 @@
+// benchmarks for every stage between a GetUserStatsForGame response and the rendered Markdown,
+// run against the recorded (anonymised) responses in fixtures/. Results go to stdout one line per
+// benchmark and fixture, in a fixed order, so two runs can be diffed.
+//
+// usage: tf-steam-api-bench [--fixtures <dir>] [--templates <dir>] [--filter <text>]
+//                           [--min-time <ms>] [--json]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Poco/JSON/Parser.h>
+
+#include "main.h"
+#include "aggregate.h"
+#include "column_store.h"
+#include "data_classes.h"
+#include "leaderboard.h"
+#include "logging.h"
+#include "profiler.h"
+#include "stat_catalog.h"
+#include "stat_classifier.h"
+#include "stat_format.h"
+#include "stat_index.h"
+#include "stat_names.h"
+#include "stats_renderer.h"
+#include "stats_serialization.h"
+#include "stats_stream_parser.h"
+#include "stats_writer.h"
+#include "watch.h"
+#include "work_stealing_pool.h"
+
+#ifndef BENCH_SOURCE_DIR
+#define BENCH_SOURCE_DIR "."
+#endif
+
+using namespace std;
+
+// what curl hands the write callback at most (CURL_MAX_WRITE_SIZE)
+static const size_t chunkSize = 16 * 1024;
+// players in the columnar export the column scan runs over
+static const size_t exportPlayers = 1000000;
+// stats each of them has, the scan reads one
+static const size_t exportStats = 8;
+
+// results are added up in here so the compiler can't drop the work that produced them
+static volatile int64_t blackhole;
+
+struct Fixture {
+    string name;
+    string json;
+    vector<string> statNames;
+};
+
+struct Result {
+    string benchmark;
+    string fixture;
+    double nsPerPlayer;
+    size_t stats;
+    size_t bytes;
+    // heap the calling thread allocated for one player, for the benchmarks that run on one thread
+    optional<uint64_t> allocatedBytes;
+};
+
+// the code this replaced, kept to see what the rewrites bought
+namespace legacy {
+
+const regex classPvp("(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.(accum|max)\\.i([a-zA-Z]+)",
+                     regex::optimize);
+const regex classMvm(
+        "(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.mvm\\.(accum|max)\\.i([a-zA-Z]+)",
+        regex::optimize);
+const regex mapStat("((arena|cp|ctf|koth|pl|plr|sd)_[a-zA-Z0-9_]+)\\.accum\\.iPlayTime", regex::optimize);
+const regex achievementStat("TF_.*_STAT", regex::optimize);
+
+// the four regex_match calls FetchResults used to make for every stat
+StatCategory Classify(const string &name, smatch &match) {
+    if (regex_match(name, match, classPvp) || regex_match(name, match, classMvm)) {
+        return StatCategory::Class;
+    }
+    if (regex_match(name, match, mapStat)) {
+        return StatCategory::Map;
+    }
+    if (regex_match(name, match, achievementStat)) {
+        return StatCategory::Achievement;
+    }
+    return StatCategory::Unknown;
+}
+
+// getDescriptionForStat: a regex built from the stat name, matched against every description
+string Describe(const map<string, string> &descriptions, const string &name, const string &className,
+                bool isClassStat) {
+    if (isClassStat) {
+        string pattern = name;
+        FindAndReplaceAll(pattern, className, "Class");
+        regex reg(pattern, regex::optimize);
+        for (auto &it: descriptions) {
+            if (regex_match(it.first, reg)) {
+                string result = it.second;
+                FindAndReplaceAll(result, "Class", className);
+                return result;
+            }
+        }
+    } else {
+        for (auto &it: descriptions) {
+            if (name == it.first) {
+                return it.second;
+            }
+        }
+    }
+    return "null";
+}
+
+// the buffer responses used to be collected in, grown by realloc for every chunk
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+};
+
+size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t real_size = size * nmemb;
+    auto mem = (struct MemoryStruct *) userp;
+
+    char *ptr = static_cast<char *>(realloc(mem->memory, mem->size + real_size + 1));
+    if (!ptr) {
+        return 0;
+    }
+
+    mem->memory = ptr;
+    memcpy(&(mem->memory[mem->size]), contents, real_size);
+    mem->size += real_size;
+    mem->memory[mem->size] = 0;
+
+    return real_size;
+}
+
+// how main.h used to format every play time
+std::string ConvertMSToHHMMSS(std::chrono::milliseconds ms)
+{
+    using namespace std::chrono;
+    std::stringstream ss;
+
+    // compute h, m, s
+    auto secs = duration_cast<seconds>(ms);
+    ms -= duration_cast<milliseconds>(secs);
+
+    auto mins = duration_cast<minutes>(secs);
+    secs -= duration_cast<seconds>(mins);
+
+    auto hour = duration_cast<hours>(mins);
+    mins -= duration_cast<minutes>(hour);
+
+    std::string hr(std::to_string(hour.count()));
+    std::string min(std::to_string(mins.count()));
+    std::string s(std::to_string(secs.count()));
+
+    // add leading zero if needed
+    std::string mm = std::string(2 - min.length(), '0') + min;
+    std::string sec = std::string(2 - s.length(), '0') + s;
+
+    // return mm:ss if there are no hours
+    if (hour.count() != 0)
+    {
+        ss << hr << ":" << mm << ":" << sec;
+    }
+    else
+    {
+        ss << mm << ":" << sec;
+    }
+
+    return ss.str();
+}
+
+}  // namespace legacy
+
+// counts what is rendered without keeping it
+class DiscardBuffer : public streambuf {
+public:
+    size_t written = 0;
+
+protected:
+    int_type overflow(int_type c) override {
+        written++;
+        return traits_type::not_eof(c);
+    }
+    streamsize xsputn(const char *, streamsize size) override {
+        written += size;
+        return size;
+    }
+};
+
+static bool ReadFile(const string &path, string &contents) {
+    ifstream stream(path, ios::binary);
+    if (!stream) {
+        return false;
+    }
+    stringstream buf;
+    buf << stream.rdbuf();
+    contents = buf.str();
+    return true;
+}
+
+static bool LoadFixture(const string &dir, const string &name, Fixture &fixture) {
+    fixture.name = name;
+    string path = dir + "/stats_" + name + ".json";
+    if (!ReadFile(path, fixture.json)) {
+        fprintf(stderr, "Error: could not read %s\n", path.c_str());
+        return false;
+    }
+    StatsStreamParser parser([&](string_view statName, int64_t) { fixture.statNames.emplace_back(statName); });
+    if (!parser.Feed(fixture.json.data(), fixture.json.size()) || !parser.Finish()) {
+        fprintf(stderr, "Error: %s is malformed: %s\n", path.c_str(), parser.error().c_str());
+        return false;
+    }
+    return true;
+}
+
+// runs body until minSeconds have passed, five times, and returns the median time per call
+static double Measure(const function<void()> &body, double minSeconds) {
+    using clock = chrono::steady_clock;
+    body();
+
+    size_t iterations = 1;
+    vector<double> samples;
+    while (samples.size() < 5) {
+        auto start = clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body();
+        }
+        double elapsed = chrono::duration<double>(clock::now() - start).count();
+        if (elapsed < minSeconds / 5 && samples.empty()) {
+            iterations *= 2;
+            continue;
+        }
+        samples.push_back(elapsed * 1e9 / (double) iterations);
+    }
+    sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static void FeedInChunks(const string &json, const function<void(const char *, size_t)> &feed) {
+    for (size_t offset = 0; offset < json.size(); offset += chunkSize) {
+        feed(json.data() + offset, min(chunkSize, json.size() - offset));
+    }
+}
+
+int main(int argc, char **argv) {
+    string fixtureDir = BENCH_SOURCE_DIR "/fixtures";
+    string templateDir = BENCH_SOURCE_DIR "/templates/";
+    string filter;
+    double minSeconds = 0.5;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--json") == 0) {
+            json = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr,
+                    "Usage: %s [--fixtures <dir>] [--templates <dir>] [--filter <text>] [--min-time <ms>] [--json]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+        const char *value = argv[++i];
+        if (strcmp(arg, "--fixtures") == 0) {
+            fixtureDir = value;
+        } else if (strcmp(arg, "--templates") == 0) {
+            templateDir = string(value) + "/";
+        } else if (strcmp(arg, "--filter") == 0) {
+            filter = value;
+        } else if (strcmp(arg, "--min-time") == 0) {
+            minSeconds = atof(value) / 1000;
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", arg);
+            return EXIT_FAILURE;
+        }
+    }
+    SetVerbosity(Verbosity::Quiet);
+
+    vector<Fixture> fixtures(3);
+    if (!LoadFixture(fixtureDir, "small", fixtures[0]) || !LoadFixture(fixtureDir, "typical", fixtures[1]) ||
+        !LoadFixture(fixtureDir, "inflated", fixtures[2])) {
+        return EXIT_FAILURE;
+    }
+    string summaries;
+    if (!ReadFile(fixtureDir + "/summaries.json", summaries)) {
+        fprintf(stderr, "Error: could not read %s/summaries.json\n", fixtureDir.c_str());
+        return EXIT_FAILURE;
+    }
+
+    StatDescriptionIndex descriptions;
+    map<string, string> legacyDescriptions;
+    for (auto &entry: embeddedStatNames) {
+        legacyDescriptions.emplace(entry.name, entry.description);
+    }
+    StatsRenderer renderer(templateDir);
+
+    vector<Result> results;
+    auto run = [&](const string &benchmark, const Fixture &fixture, const function<void()> &body) {
+        if (!filter.empty() && (benchmark + "/" + fixture.name).find(filter) == string::npos) {
+            return;
+        }
+        double ns = Measure(body, minSeconds);
+        // once more after Measure warmed everything up, so only what every player costs is counted
+        uint64_t before = ThreadAllocatedBytes();
+        body();
+        uint64_t allocated = ThreadAllocatedBytes() - before;
+        results.push_back({benchmark, fixture.name, ns, fixture.statNames.size(), fixture.json.size(), allocated});
+    };
+
+    for (auto &fixture: fixtures) {
+        run("accumulate/legacy-realloc", fixture, [&] {
+            legacy::MemoryStruct data{static_cast<char *>(malloc(1)), 0};
+            FeedInChunks(fixture.json, [&](const char *chunk, size_t size) {
+                legacy::WriteMemoryCallback((void *) chunk, 1, size, &data);
+            });
+            blackhole = blackhole + (int64_t) data.size;
+            free(data.memory);
+        });
+
+        // what HttpClient does: reserved from Content-Length, capacity kept for the next response
+        string body;
+        run("accumulate/reused-buffer", fixture, [&] {
+            body.clear();
+            body.reserve(fixture.json.size());
+            FeedInChunks(fixture.json, [&](const char *chunk, size_t size) { body.append(chunk, size); });
+            blackhole = blackhole + (int64_t) body.size();
+        });
+
+        run("parse/stream", fixture, [&] {
+            int64_t sum = 0;
+            StatsStreamParser parser([&](string_view, int64_t value) { sum += value; });
+            FeedInChunks(fixture.json, [&](const char *chunk, size_t size) { parser.Feed(chunk, size); });
+            parser.Finish();
+            blackhole = blackhole + sum;
+        });
+
+        run("parse/poco-dom", fixture, [&] {
+            Poco::JSON::Parser parser;
+            auto result = parser.parse(fixture.json);
+            auto stats = result.extract<Poco::JSON::Object::Ptr>()->getObject("playerstats")->getArray("stats");
+            int64_t sum = 0;
+            for (int i = 0; i < stats->size(); i++) {
+                auto stat = stats->getObject(i);
+                sum += (int64_t) stat->getValue<string>("name").size();
+                sum += stat->getValue<int64_t>("value");
+            }
+            blackhole = blackhole + sum;
+        });
+
+        run("classify/one-pass", fixture, [&] {
+            int classStats = 0;
+            for (auto &name: fixture.statNames) {
+                classStats += ClassifyStat(name).category == StatCategory::Class;
+            }
+            blackhole = blackhole + classStats;
+        });
+
+        run("classify/legacy-regex", fixture, [&] {
+            smatch match;
+            int classStats = 0;
+            for (auto &name: fixture.statNames) {
+                classStats += legacy::Classify(name, match) == StatCategory::Class;
+            }
+            blackhole = blackhole + classStats;
+        });
+
+        run("describe/index", fixture, [&] {
+            for (auto &name: fixture.statNames) {
+                blackhole = blackhole + (int64_t) descriptions.Describe(ClassifyStat(name)).size();
+            }
+        });
+
+        run("describe/legacy-regex", fixture, [&] {
+            for (auto &name: fixture.statNames) {
+                StatName parsed = ClassifyStat(name);
+                if (parsed.category == StatCategory::Class || parsed.category == StatCategory::Achievement) {
+                    string description = legacy::Describe(legacyDescriptions, name, string(parsed.className),
+                                                          parsed.category == StatCategory::Class);
+                    blackhole = blackhole + (int64_t) description.size();
+                }
+            }
+        });
+
+        // the whole per-player path once the StatCatalog has seen every stat name
+        run("player/parse", fixture, [&] {
+            blackhole = blackhole + (int64_t) ParsePlayerStats(fixture.json, descriptions).pvpStats.size();
+        });
+
+        PlayerStats stats = ParsePlayerStats(fixture.json, descriptions);
+        // the values of a player the templates get: play times as H:MM:SS, everything else as
+        // numbers inja turns into text, thousands separators for templates that ask for them
+        vector<int64_t> playTimes;
+        vector<int64_t> values;
+        for (auto columns: {&stats.pvpStats, &stats.mvmStats}) {
+            for (auto [info, value]: StatCatalog::Get().View(*columns)) {
+                (info.shortName == "PlayTime" ? playTimes : values).push_back(value);
+            }
+        }
+        playTimes.insert(playTimes.end(), stats.mapStats.values.begin(), stats.mapStats.values.end());
+        values.insert(values.end(), stats.achievementStats.values.begin(), stats.achievementStats.values.end());
+        run("format/legacy-hhmmss", fixture, [&] {
+            for (int64_t seconds: playTimes) {
+                string text = legacy::ConvertMSToHHMMSS(chrono::duration_cast<chrono::milliseconds>(dseconds(seconds)));
+                blackhole = blackhole + (int64_t) text.size();
+            }
+        });
+        run("format/hhmmss", fixture, [&] {
+            char buffer[maxFormattedSize];
+            for (int64_t seconds: playTimes) {
+                blackhole = blackhole + (FormatHhMmSs(buffer, seconds) - buffer);
+            }
+        });
+        run("format/json-number", fixture, [&] {
+            for (int64_t value: values) {
+                blackhole = blackhole + (int64_t) inja::json(value).dump().size();
+            }
+        });
+        run("format/thousands", fixture, [&] {
+            char buffer[maxFormattedSize];
+            for (int64_t value: values) {
+                blackhole = blackhole + (FormatThousands(buffer, value, ',') - buffer);
+            }
+        });
+
+        run("player/render", fixture, [&] {
+            DiscardBuffer discard;
+            ostream out(&discard);
+            renderer.Render(stats, "Player", out);
+            blackhole = blackhole + (int64_t) discard.written;
+        });
+        // the same player without the template engine, --format json (and ndjson) and csv
+        run("player/write-json", fixture, [&] {
+            DiscardBuffer discard;
+            ostream out(&discard);
+            WriteStatsJson(stats, "76561197960287930", "Player", out);
+            blackhole = blackhole + (int64_t) discard.written;
+        });
+        run("player/write-csv", fixture, [&] {
+            DiscardBuffer discard;
+            ostream out(&discard);
+            WriteStatsCsv(stats, "76561197960287930", "Player", out);
+            blackhole = blackhole + (int64_t) discard.written;
+        });
+
+        run("player/cache-roundtrip", fixture, [&] {
+            PlayerStats restored;
+            DeserializePlayerStats(SerializePlayerStats(stats), descriptions, restored);
+            blackhole = blackhole + (int64_t) restored.achievementStats.size();
+        });
+
+        // a --watch tick once the response is in: nothing changed, which should cost next to
+        // nothing, and one stat changed, which re-renders the one section it is in
+        WatchedPage page(renderer);
+        page.UpdateStats(fixture.json, descriptions);
+        run("watch/unchanged", fixture, [&] {
+            blackhole = blackhole + (int64_t) page.UpdateStats(fixture.json, descriptions);
+        });
+        string changed = fixture.json;
+        size_t digit = changed.find_first_of("0123456789", changed.rfind("\"value\""));
+        if (digit != string::npos) {
+            changed[digit] = changed[digit] == '9' ? '1' : (char) (changed[digit] + 1);
+            bool flip = false;
+            run("watch/one-stat-changed", fixture, [&] {
+                flip = !flip;
+                blackhole = blackhole + (int64_t) page.UpdateStats(flip ? changed : fixture.json, descriptions);
+            });
+        }
+    }
+
+    // one GetPlayerSummaries chunk of 100 players per call
+    Fixture summaryFixture{"summaries", summaries, {}};
+    run("summaries/parse", summaryFixture, [&] {
+        blackhole = blackhole + (int64_t) ParsePersonaNames(summaries).size();
+    });
+
+    // one stat summed over a million players straight from the mapped export, and every stat of
+    // them aggregated on 1, 2, 4, ... threads up to one per core
+    Fixture exportFixture{"1M-players", "", {}};
+    auto wanted = [&](const string &benchmark) {
+        return filter.empty() || (benchmark + "/" + exportFixture.name).find(filter) != string::npos;
+    };
+    vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < thread::hardware_concurrency(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(max(1u, thread::hardware_concurrency()));
+    bool aggregate = any_of(threadCounts.begin(), threadCounts.end(), [&](unsigned threads) {
+        return wanted("aggregate/threads-" + to_string(threads));
+    });
+    if (wanted("export/append") || wanted("export/scan-column") || aggregate) {
+        auto path = (filesystem::temp_directory_path() / "tf-steam-api-bench.tfcol").string();
+        filesystem::remove(path);
+
+        PlayerStats typical = ParsePlayerStats(fixtures[1].json, descriptions);
+        PlayerStats player;
+        for (size_t i = 0; i < exportStats && i < typical.pvpStats.size(); i++) {
+            player.pvpStats.Add(typical.pvpStats.ids[i], typical.pvpStats.values[i]);
+        }
+        string statName = StatCatalog::Get()[player.pvpStats.ids[0]].fullName;
+
+        // every call grows the file, so this one is timed once instead of by Measure
+        auto start = chrono::steady_clock::now();
+        ColumnStoreWriter writer;
+        if (!writer.Open(path)) {
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < exportPlayers; i++) {
+            for (auto &value: player.pvpStats.values) {
+                value++;
+            }
+            writer.Add(to_string(76561197960265728ULL + i), player);
+        }
+        if (!writer.Close()) {
+            return EXIT_FAILURE;
+        }
+        double appendNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        if (wanted("export/append")) {
+            results.push_back({"export/append", exportFixture.name, appendNs / exportPlayers, exportStats,
+                               exportStats * sizeof(int64_t)});
+        }
+
+        ColumnStoreReader reader;
+        if (!reader.Open(path)) {
+            return EXIT_FAILURE;
+        }
+        uint32_t stat = *reader.Find(statName);
+        if (wanted("export/scan-column")) {
+            double ns = Measure([&] {
+                int64_t sum = 0;
+                for (size_t group = 0; group < reader.rowGroups(); group++) {
+                    for (int64_t value: reader.Column(group, stat).values) {
+                        sum += value;
+                    }
+                }
+                blackhole = blackhole + sum;
+            }, minSeconds);
+            results.push_back({"export/scan-column", exportFixture.name, ns / exportPlayers, 1, sizeof(int64_t)});
+        }
+
+        vector<uint32_t> allStats;
+        for (uint32_t i = 0; i < reader.stats().size(); i++) {
+            allStats.push_back(i);
+        }
+        vector<bool> ranked(allStats.size(), false);
+        ranked[stat] = true;
+        for (unsigned threads: threadCounts) {
+            string name = "aggregate/threads-" + to_string(threads);
+            if (!wanted(name)) {
+                continue;
+            }
+            WorkStealingPool pool(threads);
+            double ns = Measure([&] {
+                auto aggregates = AggregateColumns(reader, allStats, ranked, 10, pool);
+                blackhole = blackhole + aggregates[stat].sum;
+            }, minSeconds);
+            results.push_back({name, exportFixture.name, ns / exportPlayers, exportStats,
+                               exportStats * sizeof(int64_t)});
+        }
+        filesystem::remove(path);
+    }
+
+    // a million players with random values of the same stats ranked in the leaderboard, then
+    // one of them refreshed at a time and queried
+    if (wanted("leaderboard/insert") || wanted("leaderboard/update") || wanted("leaderboard/top-10") ||
+        wanted("leaderboard/rank") || wanted("leaderboard/save") || wanted("leaderboard/load")) {
+        auto path = (filesystem::temp_directory_path() / "tf-steam-api-bench.tfranks").string();
+        PlayerStats typical = ParsePlayerStats(fixtures[1].json, descriptions);
+        PlayerStats player;
+        for (size_t i = 0; i < exportStats && i < typical.pvpStats.size(); i++) {
+            player.pvpStats.Add(typical.pvpStats.ids[i], typical.pvpStats.values[i]);
+        }
+        StatId stat = player.pvpStats.ids[0];
+        const uint64_t firstId = 76561197960265728ULL;
+        mt19937_64 random(1);
+        auto randomize = [&] {
+            for (auto &value: player.pvpStats.values) {
+                value = (int64_t) (random() % 1000000);
+            }
+        };
+
+        // every call adds a player, so this one is timed once instead of by Measure
+        auto start = chrono::steady_clock::now();
+        auto leaderboard = make_unique<LeaderboardIndex>();
+        for (size_t i = 0; i < exportPlayers; i++) {
+            randomize();
+            leaderboard->Update(firstId + i, player);
+        }
+        double insertNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        if (wanted("leaderboard/insert")) {
+            results.push_back({"leaderboard/insert", exportFixture.name, insertNs / exportPlayers, exportStats,
+                               exportStats * sizeof(int64_t)});
+        }
+
+        if (wanted("leaderboard/update")) {
+            double ns = Measure([&] {
+                randomize();
+                leaderboard->Update(firstId + random() % exportPlayers, player);
+            }, minSeconds);
+            results.push_back({"leaderboard/update", exportFixture.name, ns, exportStats,
+                               exportStats * sizeof(int64_t)});
+        }
+        if (wanted("leaderboard/top-10")) {
+            double ns = Measure([&] {
+                blackhole = blackhole + leaderboard->Top(stat, 10).front().value;
+            }, minSeconds);
+            results.push_back({"leaderboard/top-10", exportFixture.name, ns, 1, sizeof(int64_t)});
+        }
+        if (wanted("leaderboard/rank")) {
+            double ns = Measure([&] {
+                blackhole = blackhole + (int64_t) leaderboard->Rank(stat, firstId + random() % exportPlayers)->rank;
+            }, minSeconds);
+            results.push_back({"leaderboard/rank", exportFixture.name, ns, 1, sizeof(int64_t)});
+        }
+
+        // the whole snapshot once each way, per player
+        if (wanted("leaderboard/save") || wanted("leaderboard/load")) {
+            start = chrono::steady_clock::now();
+            if (!leaderboard->Save(path)) {
+                return EXIT_FAILURE;
+            }
+            double saveNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            auto bytes = (size_t) filesystem::file_size(path) / exportPlayers;
+            leaderboard.reset();
+
+            start = chrono::steady_clock::now();
+            LeaderboardIndex loaded;
+            if (!loaded.Load(path, descriptions)) {
+                return EXIT_FAILURE;
+            }
+            double loadNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            if (wanted("leaderboard/save")) {
+                results.push_back({"leaderboard/save", exportFixture.name, saveNs / exportPlayers, exportStats,
+                                   bytes});
+            }
+            if (wanted("leaderboard/load")) {
+                results.push_back({"leaderboard/load", exportFixture.name, loadNs / exportPlayers, exportStats,
+                                   bytes});
+            }
+            filesystem::remove(path);
+        }
+    }
+
+    if (!json) {
+        printf("%-28s %-10s %14s %14s %14s %10s %14s\n", "benchmark", "fixture", "ns/player", "players/s", "stats/s",
+               "MB/s", "heap B/player");
+    }
+    for (auto &result: results) {
+        double playersPerSecond = 1e9 / result.nsPerPlayer;
+        double statsPerSecond = playersPerSecond * (double) result.stats;
+        double megabytesPerSecond = playersPerSecond * (double) result.bytes / 1e6;
+        string heap = result.allocatedBytes ? to_string(*result.allocatedBytes) : (json ? "null" : "-");
+        if (json) {
+            printf("{\"benchmark\":\"%s\",\"fixture\":\"%s\",\"nsPerPlayer\":%.1f,\"playersPerSecond\":%.1f,"
+                   "\"statsPerSecond\":%.1f,\"megabytesPerSecond\":%.2f,\"heapBytesPerPlayer\":%s}\n",
+                   result.benchmark.c_str(), result.fixture.c_str(), result.nsPerPlayer, playersPerSecond,
+                   statsPerSecond, megabytesPerSecond, heap.c_str());
+        } else {
+            printf("%-28s %-10s %14.1f %14.1f %14.1f %10.2f %14s\n", result.benchmark.c_str(), result.fixture.c_str(),
+                   result.nsPerPlayer, playersPerSecond, statsPerSecond, megabytesPerSecond, heap.c_str());
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// little-endian fixed-width integers, LEB128 varints and length-prefixed strings appended to a
+// byte string
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string &out) : out(out) {}
+
+    void U8(uint8_t value) { out += (char) value; }
+
+    void U32(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out += (char) ((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void U64(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            out += (char) ((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void VarUInt(uint64_t value) {
+        while (value >= 0x80) {
+            out += (char) ((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += (char) value;
+    }
+
+    // zigzag, so small negative numbers stay small
+    void VarInt(int64_t value) {
+        VarUInt(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+    }
+
+    void String(std::string_view value) {
+        VarUInt(value.size());
+        out.append(value.data(), value.size());
+    }
+
+    void Bytes(std::string_view value) { out.append(value.data(), value.size()); }
+
+private:
+    std::string &out;
+};
+
+// reads what ByteWriter wrote, every read fails (returns false) once the input is exhausted
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view in) : in(in) {}
+
+    bool U8(uint8_t &value) {
+        if (pos + 1 > in.size()) return false;
+        value = (uint8_t) in[pos++];
+        return true;
+    }
+
+    bool U32(uint32_t &value) {
+        if (pos + 4 > in.size()) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= (uint32_t) (uint8_t) in[pos++] << (8 * i);
+        }
+        return true;
+    }
+
+    bool U64(uint64_t &value) {
+        if (pos + 8 > in.size()) return false;
+        value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= (uint64_t) (uint8_t) in[pos++] << (8 * i);
+        }
+        return true;
+    }
+
+    bool VarUInt(uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= in.size()) return false;
+            auto byte = (uint8_t) in[pos++];
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool VarInt(int64_t &value) {
+        uint64_t zigzag;
+        if (!VarUInt(zigzag)) return false;
+        value = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+        return true;
+    }
+
+    bool String(std::string &value) {
+        std::string_view view;
+        if (!String(view)) return false;
+        value.assign(view);
+        return true;
+    }
+
+    bool String(std::string_view &value) {
+        uint64_t size;
+        if (!VarUInt(size) || size > in.size() - pos) return false;
+        value = in.substr(pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool Bytes(size_t size, std::string_view &value) {
+        if (size > in.size() - pos) return false;
+        value = in.substr(pos, size);
+        pos += size;
+        return true;
+    }
+
+    size_t position() const { return pos; }
+    bool atEnd() const { return pos == in.size(); }
+
+private:
+    std::string_view in;
+    size_t pos = 0;
+};
+
+// 64-bit FNV-1a
+inline uint64_t HashBytes(std::string_view data, uint64_t seed = 0xcbf29ce484222325ULL) {
+    uint64_t hash = seed;
+    for (char c: data) {
+        hash ^= (uint8_t) c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
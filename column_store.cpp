@@ -0,0 +1,451 @@
+#include "column_store.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "binary_io.h"
+#include "stat_catalog.h"
+
+using namespace std;
+
+// columns are written and mapped as they are in memory
+static_assert(endian::native == endian::little, "the column store is little-endian only");
+
+static const uint32_t columnStoreMagic = 0x4C435446; // "TFCL"
+static const uint32_t columnStoreVersion = 1;
+static const uint64_t pageSize = 4096;
+// footer offset, footer checksum, magic
+static const size_t trailerSize = 16;
+// a row group is also written once this many values are buffered, whatever its row count
+static const size_t maxPendingValues = 1u << 22;
+
+static uint64_t AlignToPage(uint64_t offset) {
+    return (offset + pageSize - 1) / pageSize * pageSize;
+}
+
+static uint64_t PresenceWords(uint64_t rows) {
+    return (rows + 63) / 64;
+}
+
+static string EncodeHeader(uint64_t committedSize) {
+    string header;
+    ByteWriter writer(header);
+    writer.U32(columnStoreMagic);
+    writer.U32(columnStoreVersion);
+    writer.U32((uint32_t) pageSize);
+    writer.U32(0);
+    writer.U64(committedSize);
+    return header;
+}
+
+// header and trailer, hands out the footer, false if the file isn't a column store
+static bool ParseEnvelope(string_view file, uint64_t &committedSize, string_view &footer) {
+    ByteReader header(file);
+    uint32_t magic, version, page, reserved;
+    if (!header.U32(magic) || magic != columnStoreMagic || !header.U32(version) || version != columnStoreVersion ||
+        !header.U32(page) || page != pageSize || !header.U32(reserved) || !header.U64(committedSize) ||
+        committedSize < pageSize || committedSize > file.size()) {
+        return false;
+    }
+    footer = {};
+    if (committedSize == pageSize) {
+        // created, nothing committed yet
+        return true;
+    }
+
+    ByteReader trailer(file.substr(committedSize - trailerSize, trailerSize));
+    uint64_t footerOffset;
+    uint32_t checksum;
+    if (committedSize < pageSize + trailerSize || !trailer.U64(footerOffset) || !trailer.U32(checksum) ||
+        !trailer.U32(magic) || magic != columnStoreMagic || footerOffset < pageSize ||
+        footerOffset > committedSize - trailerSize) {
+        return false;
+    }
+    footer = file.substr(footerOffset, committedSize - trailerSize - footerOffset);
+    return checksum == (uint32_t) HashBytes(footer);
+}
+
+// dictionary, then per row group its row count, SteamID64 column and (stat, chunk offset) pairs
+template<typename OnStat, typename OnGroup>
+static bool ParseFooter(string_view footer, OnStat onStat, OnGroup onGroup) {
+    if (footer.empty()) {
+        return true;
+    }
+    ByteReader reader(footer);
+    uint64_t statCount;
+    if (!reader.VarUInt(statCount)) return false;
+    for (uint64_t i = 0; i < statCount; i++) {
+        string_view name, description;
+        if (!reader.String(name) || !reader.String(description)) return false;
+        onStat(name, description);
+    }
+    uint64_t groupCount;
+    if (!reader.VarUInt(groupCount)) return false;
+    for (uint64_t i = 0; i < groupCount; i++) {
+        uint64_t rows, steamIdsOffset, columnCount;
+        if (!reader.VarUInt(rows) || !reader.U64(steamIdsOffset) || !reader.VarUInt(columnCount)) return false;
+        vector<pair<uint64_t, uint64_t>> columns(columnCount);
+        for (auto &[stat, offset]: columns) {
+            if (!reader.VarUInt(stat) || !reader.U64(offset) || stat >= statCount) return false;
+        }
+        if (!onGroup(rows, steamIdsOffset, columns)) return false;
+    }
+    return reader.atEnd();
+}
+
+ColumnStoreWriter::~ColumnStoreWriter() {
+    if (file.is_open()) {
+        Close();
+    }
+}
+
+bool ColumnStoreWriter::Open(const string &storePath) {
+    path = storePath;
+    error_code ec;
+    if (!filesystem::exists(path, ec) || filesystem::file_size(path, ec) == 0) {
+        string header = EncodeHeader(pageSize);
+        header.resize(pageSize, '\0');
+        ofstream created(path, ios::binary | ios::trunc);
+        created.write(header.data(), (streamsize) header.size());
+        if (!created) {
+            fprintf(stderr, "Error: could not create %s\n", path.c_str());
+            return false;
+        }
+        fileSize = pageSize;
+        // an empty store is still readable
+        dirty = true;
+    } else if (!Load()) {
+        fprintf(stderr, "Error: %s is not a stats export\n", path.c_str());
+        return false;
+    }
+
+    file.open(path, ios::binary | ios::in | ios::out);
+    if (!file) {
+        fprintf(stderr, "Error: could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ColumnStoreWriter::Load() {
+    ifstream in(path, ios::binary);
+    string contents((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    string_view footer;
+    if (!ParseEnvelope(contents, fileSize, footer)) {
+        return false;
+    }
+    auto onStat = [this](string_view name, string_view description) {
+        statIndex.emplace(name, (uint32_t) stats.size());
+        stats.push_back({string(name), string(description)});
+    };
+    auto onGroup = [this](uint64_t rows, uint64_t steamIdsOffset, const vector<pair<uint64_t, uint64_t>> &columns) {
+        RowGroup group{rows, steamIdsOffset, {}};
+        for (auto [stat, offset]: columns) {
+            group.columns.push_back({(uint32_t) stat, offset});
+        }
+        rowGroups.push_back(std::move(group));
+        committedRows += rows;
+        return true;
+    };
+    if (!ParseFooter(footer, onStat, onGroup)) {
+        return false;
+    }
+    if (contents.size() != fileSize) {
+        // row groups of a run that never wrote its footer
+        error_code ec;
+        filesystem::resize_file(path, fileSize, ec);
+    }
+    return true;
+}
+
+uint32_t ColumnStoreWriter::StatIndex(StatId id) {
+    auto it = statsById.find(id);
+    if (it != statsById.end()) {
+        return it->second;
+    }
+    const StatInfo &info = StatCatalog::Get()[id];
+    uint32_t index;
+    auto known = statIndex.find(info.fullName);
+    if (known != statIndex.end()) {
+        index = known->second;
+    } else {
+        index = (uint32_t) stats.size();
+        stats.push_back({info.fullName, info.description == "null" ? "" : info.description});
+        statIndex.emplace(info.fullName, index);
+    }
+    statsById.emplace(id, index);
+    return index;
+}
+
+bool ColumnStoreWriter::Add(string_view steamId, const PlayerStats &player) {
+    uint64_t id = 0;
+    auto [end, error] = from_chars(steamId.data(), steamId.data() + steamId.size(), id);
+    if (error != errc() || end != steamId.data() + steamId.size()) {
+        fprintf(stderr, "Error: %.*s is not a SteamID64\n", (int) steamId.size(), steamId.data());
+        return false;
+    }
+
+    lock_guard lock(mutex);
+    pendingSteamIds.push_back(id);
+    rowStarts.push_back(pendingStats.size());
+    for (const StatColumns *columns: {&player.pvpStats, &player.mvmStats, &player.mapStats,
+                                      &player.achievementStats}) {
+        for (size_t i = 0; i < columns->size(); i++) {
+            pendingStats.push_back(StatIndex(columns->ids[i]));
+            pendingValues.push_back(columns->values[i]);
+        }
+    }
+    dirty = true;
+    if (pendingSteamIds.size() >= maxRowGroupRows || pendingValues.size() >= maxPendingValues) {
+        return FlushRowGroup();
+    }
+    return true;
+}
+
+uint64_t ColumnStoreWriter::WriteAligned(const void *bytes, size_t size) {
+    uint64_t offset = AlignToPage(fileSize);
+    static const char padding[pageSize] = {};
+    file.seekp((streamoff) fileSize);
+    file.write(padding, (streamsize) (offset - fileSize));
+    file.write(static_cast<const char *>(bytes), (streamsize) size);
+    fileSize = offset + size;
+    return offset;
+}
+
+bool ColumnStoreWriter::FlushRowGroup() {
+    size_t rows = pendingSteamIds.size();
+    if (rows == 0) {
+        return true;
+    }
+    rowStarts.push_back(pendingStats.size());
+
+    RowGroup group{rows, WriteAligned(pendingSteamIds.data(), rows * sizeof(uint64_t)), {}};
+
+    // counting sort of the buffered values by stat, so each column is built from a contiguous range
+    vector<size_t> starts(stats.size() + 1, 0);
+    for (uint32_t stat: pendingStats) {
+        starts[stat + 1]++;
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        starts[i + 1] += starts[i];
+    }
+    vector<pair<uint32_t, int64_t>> byStat(pendingStats.size());
+    vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t i = rowStarts[row]; i < rowStarts[row + 1]; i++) {
+            byStat[next[pendingStats[i]]++] = {(uint32_t) row, pendingValues[i]};
+        }
+    }
+
+    size_t words = PresenceWords(rows);
+    // presence words followed by the values, one stat at a time
+    vector<uint64_t> chunk(words + rows);
+    for (uint32_t stat = 0; stat < stats.size(); stat++) {
+        if (starts[stat] == starts[stat + 1]) {
+            continue;
+        }
+        fill(chunk.begin(), chunk.end(), 0);
+        for (size_t i = starts[stat]; i < starts[stat + 1]; i++) {
+            auto [row, value] = byStat[i];
+            chunk[row / 64] |= 1ULL << (row % 64);
+            chunk[words + row] = (uint64_t) value;
+        }
+        group.columns.push_back({stat, WriteAligned(chunk.data(), chunk.size() * sizeof(uint64_t))});
+    }
+
+    rowGroups.push_back(std::move(group));
+    committedRows += rows;
+    pendingSteamIds.clear();
+    rowStarts.clear();
+    pendingStats.clear();
+    pendingValues.clear();
+    if (!file) {
+        fprintf(stderr, "Error: could not write to %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ColumnStoreWriter::WriteFooter() {
+    string footer;
+    ByteWriter writer(footer);
+    writer.VarUInt(stats.size());
+    for (auto &stat: stats) {
+        writer.String(stat.name);
+        writer.String(stat.description);
+    }
+    writer.VarUInt(rowGroups.size());
+    for (auto &group: rowGroups) {
+        writer.VarUInt(group.rows);
+        writer.U64(group.steamIdsOffset);
+        writer.VarUInt(group.columns.size());
+        for (auto &column: group.columns) {
+            writer.VarUInt(column.stat);
+            writer.U64(column.offset);
+        }
+    }
+    uint64_t footerOffset = fileSize;
+    uint32_t checksum = (uint32_t) HashBytes(footer);
+    writer.U64(footerOffset);
+    writer.U32(checksum);
+    writer.U32(columnStoreMagic);
+
+    file.seekp((streamoff) fileSize);
+    file.write(footer.data(), (streamsize) footer.size());
+    file.flush();
+    fileSize += footer.size();
+    // only now does the file grow to include this run's row groups
+    string header = EncodeHeader(fileSize);
+    file.seekp(0);
+    file.write(header.data(), (streamsize) header.size());
+    file.flush();
+    return (bool) file;
+}
+
+bool ColumnStoreWriter::Close() {
+    lock_guard lock(mutex);
+    bool ok = true;
+    if (dirty) {
+        ok = FlushRowGroup() && WriteFooter();
+        dirty = false;
+    }
+    file.close();
+    if (!ok) {
+        fprintf(stderr, "Error: could not write %s\n", path.c_str());
+    }
+    return ok;
+}
+
+ColumnStoreReader::~ColumnStoreReader() {
+    Unmap();
+}
+
+void ColumnStoreReader::Unmap() {
+    if (!data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+#else
+    munmap((void *) data, size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool ColumnStoreReader::Open(const string &path) {
+    Unmap();
+    dictionary.clear();
+    statIndex.clear();
+    groups.clear();
+    rowCount = 0;
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        fprintf(stderr, "Error: could not open %s\n", path.c_str());
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mappingHandle) CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        fprintf(stderr, "Error: could not map %s\n", path.c_str());
+        return false;
+    }
+    data = static_cast<const char *>(view);
+    size = (size_t) fileSize.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info{};
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, "Error: could not open %s\n", path.c_str());
+        return false;
+    }
+    void *view = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file referenced
+    close(fd);
+    if (view == MAP_FAILED) {
+        fprintf(stderr, "Error: could not map %s\n", path.c_str());
+        return false;
+    }
+    data = static_cast<const char *>(view);
+    size = (size_t) info.st_size;
+#endif
+
+    uint64_t committedSize;
+    string_view footer;
+    bool valid = ParseEnvelope({data, size}, committedSize, footer);
+    auto onStat = [this](string_view name, string_view description) {
+        statIndex.emplace(name, (uint32_t) dictionary.size());
+        dictionary.push_back({string(name), string(description)});
+    };
+    // everything a span will be made of has to lie within what was committed
+    auto onGroup = [&](uint64_t rows, uint64_t steamIdsOffset, const vector<pair<uint64_t, uint64_t>> &columns) {
+        if (steamIdsOffset % pageSize != 0 || steamIdsOffset > committedSize ||
+            rows > (committedSize - steamIdsOffset) / sizeof(uint64_t)) {
+            return false;
+        }
+        uint64_t chunkSize = (PresenceWords(rows) + rows) * sizeof(uint64_t);
+        Group group{(size_t) rows, steamIdsOffset, vector<uint64_t>(dictionary.size(), 0)};
+        for (auto [stat, offset]: columns) {
+            if (offset % pageSize != 0 || offset == 0 || offset > committedSize ||
+                chunkSize > committedSize - offset) {
+                return false;
+            }
+            group.columns[stat] = offset;
+        }
+        groups.push_back(std::move(group));
+        rowCount += rows;
+        return true;
+    };
+    if (!valid || !ParseFooter(footer, onStat, onGroup)) {
+        Unmap();
+        fprintf(stderr, "Error: %s is not a stats export or is damaged\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+optional<uint32_t> ColumnStoreReader::Find(string_view statName) const {
+    auto it = statIndex.find(statName);
+    if (it == statIndex.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+span<const uint64_t> ColumnStoreReader::SteamIds(size_t group) const {
+    auto ids = reinterpret_cast<const uint64_t *>(data + groups[group].steamIdsOffset);
+    return {ids, groups[group].rows};
+}
+
+ColumnChunk ColumnStoreReader::Column(size_t group, uint32_t stat) const {
+    const Group &rowGroup = groups[group];
+    uint64_t offset = rowGroup.columns[stat];
+    if (offset == 0) {
+        return {};
+    }
+    auto words = reinterpret_cast<const uint64_t *>(data + offset);
+    size_t presenceWords = PresenceWords(rowGroup.rows);
+    return {{reinterpret_cast<const int64_t *>(words + presenceWords), rowGroup.rows}, {words, presenceWords}};
+}
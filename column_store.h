@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "data_classes.h"
+#include "stat_index.h"
+
+// columnar export of many players' stats, one row per player and one column per stat:
+//   page 0        magic, version, page size and the size of the file up to its last complete footer
+//   row groups    up to maxRowGroupRows players each: a SteamID64 column, then one chunk per stat any of
+//                 them has, every column starting on its own page so a scan over one stat only
+//                 touches that stat's pages
+//   footer        the stat dictionary (name and description, columns refer to stats by their
+//                 position in it) and where every row group and column chunk starts
+//   trailer       footer offset and an end marker
+// A column chunk is a presence bitmap (one bit per row, rows without the stat are 0) followed by
+// the values as little-endian int64. Appending writes new row groups after the committed size and
+// a new footer after them, the header is only moved forward once that footer is complete, so a run
+// that dies halfway leaves the file as it was.
+struct ColumnStat {
+    std::string name;
+    // empty if stat_names.json has none
+    std::string description;
+};
+
+struct ColumnChunk {
+    std::span<const int64_t> values;
+    std::span<const uint64_t> presence;
+
+    // false for every row of a stat nobody in the row group has
+    bool has(size_t row) const { return !presence.empty() && (presence[row / 64] >> (row % 64)) & 1; }
+};
+
+// thread-safe, rows are buffered and written a row group at a time
+class ColumnStoreWriter {
+public:
+    static const size_t maxRowGroupRows = 65536;
+
+    ~ColumnStoreWriter();
+
+    // creates path or opens it for appending, dropping whatever a previous run left uncommitted
+    bool Open(const std::string &path);
+    bool Add(std::string_view steamId, const PlayerStats &stats);
+    // writes the buffered rows and the footer, the file can be read (and appended to) afterwards
+    bool Close();
+
+    size_t rows() const { return committedRows + pendingSteamIds.size(); }
+
+private:
+    bool Load();
+    uint32_t StatIndex(StatId id);
+    bool FlushRowGroup();
+    bool WriteFooter();
+    // pads the file to the next page and writes size bytes there, returns their offset
+    uint64_t WriteAligned(const void *bytes, size_t size);
+
+    struct ColumnOffset {
+        uint32_t stat;
+        uint64_t offset;
+    };
+
+    struct RowGroup {
+        uint64_t rows;
+        uint64_t steamIdsOffset;
+        std::vector<ColumnOffset> columns;
+    };
+
+    std::mutex mutex;
+    std::fstream file;
+    std::string path;
+    uint64_t fileSize = 0;
+    std::vector<ColumnStat> stats;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> statIndex;
+    // catalog ids are only stable within one process, the file uses dictionary positions
+    std::unordered_map<StatId, uint32_t> statsById;
+    std::vector<RowGroup> rowGroups;
+    size_t committedRows = 0;
+    // rows were added since the last footer
+    bool dirty = false;
+
+    // rows not written yet, row i's stats are pendingStats/pendingValues[rowStarts[i], rowStarts[i + 1])
+    std::vector<uint64_t> pendingSteamIds;
+    std::vector<size_t> rowStarts;
+    std::vector<uint32_t> pendingStats;
+    std::vector<int64_t> pendingValues;
+};
+
+// memory-maps a file written by ColumnStoreWriter, columns are handed out as spans into the mapping
+class ColumnStoreReader {
+public:
+    ColumnStoreReader() = default;
+    ~ColumnStoreReader();
+
+    ColumnStoreReader(const ColumnStoreReader &) = delete;
+    ColumnStoreReader &operator=(const ColumnStoreReader &) = delete;
+
+    bool Open(const std::string &path);
+
+    const std::vector<ColumnStat> &stats() const { return dictionary; }
+    std::optional<uint32_t> Find(std::string_view statName) const;
+
+    size_t rows() const { return rowCount; }
+    size_t rowGroups() const { return groups.size(); }
+    size_t rowGroupRows(size_t group) const { return groups[group].rows; }
+
+    std::span<const uint64_t> SteamIds(size_t group) const;
+    // empty spans if nobody in the row group has the stat
+    ColumnChunk Column(size_t group, uint32_t stat) const;
+
+private:
+    void Unmap();
+
+    struct Group {
+        size_t rows;
+        uint64_t steamIdsOffset;
+        // dictionary position -> chunk offset, 0 if the group has no chunk for it
+        std::vector<uint64_t> columns;
+    };
+
+    const char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+    std::vector<ColumnStat> dictionary;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> statIndex;
+    std::vector<Group> groups;
+    size_t rowCount = 0;
+};
@@ -0,0 +1,262 @@
+#include "crawl_queue.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "binary_io.h"
+
+using namespace std;
+
+static const char crawlMagic[8] = {'T', 'F', 'C', 'R', 'A', 'W', 'L', '\0'};
+static const uint32_t crawlVersion = 1;
+static const size_t headerSize = 32;
+static const size_t recordSize = 16;
+// state and attempts follow the SteamID64
+static const size_t stateOffset = 8;
+
+CrawlQueue::~CrawlQueue() {
+    if (file) {
+        Close();
+    }
+}
+
+// moves or links temp to path unless path exists, sets exists if it does
+static bool Publish(const string &temp, const string &path, const string &contents, bool &exists) {
+#ifdef _WIN32
+    (void) contents;
+    if (MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_WRITE_THROUGH)) {
+        return true;
+    }
+    DWORD error = GetLastError();
+    exists = error == ERROR_ALREADY_EXISTS || error == ERROR_FILE_EXISTS;
+    return false;
+#else
+    if (link(temp.c_str(), path.c_str()) == 0) {
+        return true;
+    }
+    exists = errno == EEXIST;
+    if (exists || (errno != EPERM && errno != ENOTSUP && errno != ENOSYS)) {
+        return false;
+    }
+    // no hard links on this file system: create it exclusively and write it in place, a worker
+    // opening it meanwhile finds it truncated
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        exists = errno == EEXIST;
+        return false;
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t) n;
+    }
+    bool ok = written == contents.size() && fsync(fd) == 0;
+    ok &= close(fd) == 0;
+    return ok;
+#endif
+}
+
+bool CrawlQueue::Create(const string &path, const vector<string> &steamIds) {
+    string contents;
+    contents.reserve(headerSize + steamIds.size() * recordSize);
+    ByteWriter writer(contents);
+    writer.Bytes(string_view(crawlMagic, sizeof(crawlMagic)));
+    writer.U32(crawlVersion);
+    writer.U32(recordSize);
+    writer.U64(0);
+    contents.resize(headerSize, '\0');
+
+    uint64_t count = 0;
+    for (auto &steamId: steamIds) {
+        uint64_t id = 0;
+        auto [end, error] = from_chars(steamId.data(), steamId.data() + steamId.size(), id);
+        if (error != errc() || end != steamId.data() + steamId.size()) {
+            fprintf(stderr, "Skipping invalid SteamID64 \"%s\"\n", steamId.c_str());
+            continue;
+        }
+        writer.U64(id);
+        writer.U8((uint8_t) CrawlState::Pending);
+        contents.resize(contents.size() + recordSize - stateOffset - 1, '\0');
+        count++;
+    }
+    string header;
+    ByteWriter(header).U64(count);
+    contents.replace(16, 8, header);
+
+    filesystem::path temp = path;
+    temp += ".tmp" + to_string(random_device{}());
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out.write(contents.data(), (streamsize) contents.size()) || !out.flush()) {
+            fprintf(stderr, "Error: could not create %s\n", path.c_str());
+            out.close();
+            error_code ec;
+            filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    // published without replacing anything, two workers starting at once can't both create the queue
+    bool exists = false;
+    bool ok = Publish(temp.string(), path, contents, exists);
+    error_code ec;
+    filesystem::remove(temp, ec);
+    if (!ok && !exists) {
+        fprintf(stderr, "Error: could not create %s\n", path.c_str());
+    }
+    return ok;
+}
+
+bool CrawlQueue::Open(const string &queuePath, unsigned shard, unsigned shards) {
+    path = queuePath;
+    string contents;
+    {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            fprintf(stderr, "Error: could not open %s\n", path.c_str());
+            return false;
+        }
+        contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    ByteReader reader(contents);
+    string_view magic;
+    uint32_t version = 0;
+    uint32_t size = 0;
+    uint64_t count = 0;
+    if (!reader.Bytes(sizeof(crawlMagic), magic) || magic != string_view(crawlMagic, sizeof(crawlMagic)) ||
+        !reader.U32(version) || !reader.U32(size) || !reader.U64(count)) {
+        fprintf(stderr, "Error: %s is not a crawl queue\n", path.c_str());
+        return false;
+    }
+    if (version != crawlVersion || size != recordSize) {
+        fprintf(stderr, "Error: %s was written by another version\n", path.c_str());
+        return false;
+    }
+    if (contents.size() != headerSize + count * recordSize) {
+        fprintf(stderr, "Error: %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    resumed = CrawlResume();
+    work.clear();
+    records.clear();
+    dirty.clear();
+    for (uint64_t position = shard; position < count; position += shards) {
+        ByteReader record(string_view(contents).substr(headerSize + position * recordSize, recordSize));
+        uint64_t steamId = 0;
+        uint8_t state = 0;
+        uint8_t attempts = 0;
+        record.U64(steamId);
+        record.U8(state);
+        record.U8(attempts);
+
+        resumed.players++;
+        if (state == (uint8_t) CrawlState::Done) {
+            resumed.done++;
+            continue;
+        }
+        if (state == (uint8_t) CrawlState::Failed) {
+            if (attempts >= maxAttempts) {
+                resumed.givenUp++;
+                continue;
+            }
+            resumed.retried++;
+        } else if (state == (uint8_t) CrawlState::InFlight) {
+            resumed.interrupted++;
+            dirty.push_back(records.size());
+            state = (uint8_t) CrawlState::Pending;
+        }
+        work.push_back(to_string(steamId));
+        records.push_back({position, (CrawlState) state, attempts});
+    }
+
+    file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        fprintf(stderr, "Error: could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    // unbuffered, every write only touches this shard's bytes
+    setvbuf(file, nullptr, _IONBF, 0);
+    return true;
+}
+
+bool CrawlQueue::Close() {
+    if (!file) {
+        return true;
+    }
+    bool ok = Checkpoint();
+    ok &= fclose(file) == 0;
+    file = nullptr;
+    return ok;
+}
+
+void CrawlQueue::Set(size_t item, CrawlState state) {
+    lock_guard lock(mutex);
+    Record &record = records[item];
+    if (state == CrawlState::Failed && record.attempts < 255) {
+        record.attempts++;
+    }
+    record.state = state;
+    dirty.push_back(item);
+}
+
+bool CrawlQueue::Checkpoint(const function<bool()> &beforeWrite) {
+    // copied under the lock, written without it so the workers don't wait for the disk
+    vector<size_t> items;
+    vector<pair<uint64_t, Record>> changes;
+    {
+        lock_guard lock(mutex);
+        sort(dirty.begin(), dirty.end());
+        dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+        for (size_t item: dirty) {
+            changes.emplace_back(headerSize + records[item].position * recordSize + stateOffset, records[item]);
+        }
+        items.swap(dirty);
+    }
+    if (changes.empty() || !file) {
+        return true;
+    }
+    if (beforeWrite && !beforeWrite()) {
+        lock_guard lock(mutex);
+        dirty.insert(dirty.end(), items.begin(), items.end());
+        return false;
+    }
+
+    bool ok = true;
+    for (auto &[offset, record]: changes) {
+        char bytes[2] = {(char) record.state, (char) record.attempts};
+        ok = ok && fseek(file, (long) offset, SEEK_SET) == 0 && fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+#ifdef _WIN32
+    ok = ok && fflush(file) == 0 && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+#endif
+    if (!ok) {
+        // written again, maybe only in part, by the next checkpoint
+        fprintf(stderr, "Error: could not checkpoint %s\n", path.c_str());
+        lock_guard lock(mutex);
+        dirty.insert(dirty.end(), items.begin(), items.end());
+    }
+    return ok;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class CrawlState : uint8_t {
+    Pending,
+    InFlight,
+    Done,
+    Failed,
+};
+
+// what a worker found in its shard when it opened the queue
+struct CrawlResume {
+    size_t players = 0;
+    size_t done = 0;
+    // in flight when the last run stopped, fetched again
+    size_t interrupted = 0;
+    // failed before, fetched again until they have failed maxAttempts times
+    size_t retried = 0;
+    size_t givenUp = 0;
+};
+
+// the work queue of a resumable crawl (--queue), one fixed-size record per SteamID64:
+//   header    magic, version, record size and record count
+//   records   SteamID64 as little-endian uint64, state, failed attempts and padding
+// Records only change in place and only their state and attempts bytes are ever written. Shard k
+// of N owns the records whose position modulo N is k, so any number of workers (on one machine
+// or several sharing the file) can run against the same queue as long as each shard has one.
+// State changes are kept in memory until Checkpoint() writes and syncs them, a worker that dies
+// fetches whatever it did since its last checkpoint again.
+class CrawlQueue {
+public:
+    // players that failed this many runs are not fetched again
+    static const unsigned maxAttempts = 3;
+
+    ~CrawlQueue();
+
+    // writes a queue with every player pending, through a temporary file so a worker never sees
+    // half of it. Never replaces an existing file: returns false without an error message if path
+    // exists, e.g. because another worker created it first.
+    static bool Create(const std::string &path, const std::vector<std::string> &steamIds);
+
+    // loads the records of one shard and puts the ones still to do back to pending
+    bool Open(const std::string &path, unsigned shard, unsigned shards);
+    // writes what changed since the last checkpoint and closes the file
+    bool Close();
+
+    // the players left to do, item i of the shard is steamIds()[i]
+    const std::vector<std::string> &steamIds() const { return work; }
+    const CrawlResume &resume() const { return resumed; }
+
+    // thread-safe, takes effect on disk at the next checkpoint
+    void Set(size_t item, CrawlState state);
+    // beforeWrite runs once the changes are taken and before they are written, to save whatever
+    // the players set done so far produced first. If it fails nothing is written, the changes wait
+    // for the next checkpoint.
+    bool Checkpoint(const std::function<bool()> &beforeWrite = nullptr);
+
+private:
+    struct Record {
+        uint64_t position;
+        CrawlState state;
+        uint8_t attempts;
+    };
+
+    std::string path;
+    FILE *file = nullptr;
+    std::vector<std::string> work;
+    std::vector<Record> records;
+    CrawlResume resumed;
+    std::mutex mutex;
+    // items changed since the last checkpoint
+    std::vector<size_t> dirty;
+};
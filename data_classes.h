@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <vector>
 #include <type_traits>
 #include <chrono>
 
@@ -25,6 +30,11 @@ enum class TfClass {
     Spy = 8
 };
 
+// indexed by TfClass
+constexpr std::array<std::string_view, 9> tfClassNames = {
+        "Scout", "Soldier", "Pyro", "Demoman", "Heavy", "Engineer", "Medic", "Sniper", "Spy"
+};
+
 enum class StatType {
     accum = 0,
     max = 1
@@ -45,52 +55,67 @@ const std::map<std::string, std::string> gamemodes = {
         {"sd", "Special Delivery"}
 };
 
-class ClassStat {
-public:
-    static inline std::regex regPvp = std::regex("(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.(accum|max)\\.i([a-zA-Z]+)", std::regex::optimize);
-    static inline std::regex regMvm = std::regex("(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.mvm\\.(accum|max)\\.i([a-zA-Z]+)", std::regex::optimize);
-    std::string fullName;
-    std::string className;
-    std::string shortName;
-    std::string description;
-    int value;
-    GameType gameType;
-    StatType statType;
-    TfClass tfClass;
-};
+// index into the process-wide StatCatalog (see stat_catalog.h)
+using StatId = uint32_t;
+
+// adds (id, value) to a pair of parallel vectors kept ordered by id, for any kind of vector
+template <class Ids, class Values>
+void InsertOrdered(Ids &ids, Values &values, StatId id, int64_t value) {
+    if (ids.empty() || ids.back() < id) {
+        ids.push_back(id);
+        values.push_back(value);
+        return;
+    }
+    size_t pos = std::upper_bound(ids.begin(), ids.end(), id) - ids.begin();
+    ids.insert(ids.begin() + pos, id);
+    values.insert(values.begin() + pos, value);
+}
 
-class MapStat {
+// one section of a player's stats as (stat id, value) pairs, kept ordered by id so class stats
+// come out grouped by class
+class StatColumns {
 public:
-    static inline std::regex reg = std::regex("((arena|cp|ctf|koth|pl|plr|sd)_[a-zA-Z0-9_]+)\\.accum\\.iPlayTime", std::regex::optimize);
-    std::string name;
-    std::string gamemode;
-    int playTime;
+    std::vector<StatId> ids;
+    std::vector<int64_t> values;
+
+    void Add(StatId id, int64_t value) { InsertOrdered(ids, values, id, value); }
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
 };
 
-class AchievementStat {
-public:
-    static inline std::regex reg = std::regex("TF_.*_STAT", std::regex::optimize);
-    std::string name;
-    std::string description;
-    int value;
+// the sections of a player's stats, in the order pages show them
+enum class StatSection {
+    Pvp,
+    Mvm,
+    Maps,
+    Achievements
 };
 
+const StatSection statSections[] = {StatSection::Pvp, StatSection::Mvm, StatSection::Maps, StatSection::Achievements};
+
 class PlayerStats {
 public:
-    std::vector<ClassStat> pvpStats;
-    std::vector<ClassStat> mvmStats;
-    std::vector<MapStat> mapStats;
-    std::vector<AchievementStat> achievementStats;
-};
+    StatColumns pvpStats;
+    StatColumns mvmStats;
+    StatColumns mapStats;
+    StatColumns achievementStats;
+
+    StatColumns &section(StatSection which) { return SectionOf(*this, which); }
+    const StatColumns &section(StatSection which) const { return SectionOf(*this, which); }
 
-TfClass GetEnumFromClassString(const std::string& name) {
-    if (name == "Scout") return TfClass::Scout;
-    if (name == "Soldier") return TfClass::Soldier;
-    if (name == "Pyro") return TfClass::Pyro;
-    if (name == "Demoman") return TfClass::Demoman;
-    if (name == "Heavy") return TfClass::Heavy;
-    if (name == "Engineer") return TfClass::Engineer;
-    if (name == "Medic") return TfClass::Medic;
-    if (name == "Sniper") return TfClass::Sniper;
-    if (name == "Spy") return TfClass::Spy;
-}
\ No newline at end of file
+private:
+    template <class Stats>
+    static auto SectionOf(Stats &stats, StatSection which) -> decltype((stats.pvpStats)) {
+        switch (which) {
+            case StatSection::Pvp:
+                return stats.pvpStats;
+            case StatSection::Mvm:
+                return stats.mvmStats;
+            case StatSection::Maps:
+                return stats.mapStats;
+            default:
+                return stats.achievementStats;
+        }
+    }
+};
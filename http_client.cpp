@@ -0,0 +1,161 @@
+#include "http_client.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#include "profiler.h"
+
+using namespace std;
+
+// handles beyond this many are closed when they are given back instead of kept for reuse
+static const size_t maxIdleHandles = 32;
+
+struct StringBody {
+    CURL *handle;
+    string *body;
+};
+
+static size_t WriteToSink(char *contents, size_t size, size_t nmemb, void *userp) {
+    size_t real_size = size * nmemb;
+    auto &sink = *static_cast<const HttpClient::BodySink *>(userp);
+    // returning less than real_size aborts the transfer
+    return sink(contents, real_size) ? real_size : 0;
+}
+
+static size_t WriteToString(char *contents, size_t size, size_t nmemb, void *userp) {
+    size_t real_size = size * nmemb;
+    auto target = static_cast<StringBody *>(userp);
+    if (target->body->empty()) {
+        // the headers are in by the first chunk. With compression this is the compressed size, a
+        // lower bound that still saves most of the reallocations
+        curl_off_t length = -1;
+        curl_easy_getinfo(target->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0) {
+            target->body->reserve((size_t) length);
+        }
+    }
+    target->body->append(contents, real_size);
+    return real_size;
+}
+
+HttpClient &HttpClient::Get() {
+    static HttpClient client;
+    return client;
+}
+
+HttpClient::HttpClient(string caFile) : caFile(std::move(caFile)) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, Lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, Unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, (void *) this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // connections stay with their handle, curl can't share those between threads safely
+}
+
+HttpClient::~HttpClient() {
+    for (auto &pooled: idle) {
+        curl_easy_cleanup(pooled.handle);
+    }
+    curl_share_cleanup(share);
+    curl_global_cleanup();
+}
+
+void HttpClient::Configure(CURL *handle) {
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    // "" offers every encoding this curl was built with (gzip and deflate at least) and decodes
+    // the response before it reaches the write callback
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    if (!caFile.empty()) {
+        curl_easy_setopt(handle, CURLOPT_CAINFO, caFile.c_str());
+    }
+#ifdef _WIN32
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0);
+#endif
+}
+
+HttpClient::PooledHandle HttpClient::Acquire() {
+    {
+        lock_guard lock(poolMutex);
+        if (!idle.empty()) {
+            PooledHandle pooled = idle.back();
+            idle.pop_back();
+            return pooled;
+        }
+    }
+    CURL *handle = curl_easy_init();
+    if (!handle) {
+        fprintf(stderr, "Error: Failed to create CURL connection!\n");
+        exit(EXIT_FAILURE);
+    }
+    Configure(handle);
+    lock_guard lock(poolMutex);
+    return {handle, handleCount++};
+}
+
+void HttpClient::Release(PooledHandle pooled) {
+    {
+        lock_guard lock(poolMutex);
+        if (idle.size() < maxIdleHandles) {
+            idle.push_back(pooled);
+            return;
+        }
+    }
+    curl_easy_cleanup(pooled.handle);
+}
+
+HttpResult HttpClient::Fetch(const string &url, const curl_slist *headers, const BodySink &sink, string_view detail) {
+    PooledHandle pooled = Acquire();
+    HttpResult result = Perform(pooled, url, headers, WriteToSink, (void *) &sink, detail);
+    Release(pooled);
+    return result;
+}
+
+HttpResult HttpClient::Fetch(const string &url, const curl_slist *headers, string &body, string_view detail) {
+    PooledHandle pooled = Acquire();
+    body.clear();
+    StringBody target{pooled.handle, &body};
+    HttpResult result = Perform(pooled, url, headers, WriteToString, (void *) &target, detail);
+    Release(pooled);
+    return result;
+}
+
+HttpResult HttpClient::Perform(PooledHandle pooled, const string &url, const curl_slist *headers,
+                               curl_write_callback write, void *writeData, string_view detail) {
+    CURL *handle = pooled.handle;
+    HttpResult result;
+    // everything set per request, whatever the previous one left behind is overwritten
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, writeData);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, CaptureValidators);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, (void *) &result.validators);
+
+    result.code = curl_easy_perform(handle);
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &result.status);
+    curl_off_t retryAfter = 0;
+    curl_easy_getinfo(handle, CURLINFO_RETRY_AFTER, &retryAfter);
+    result.retryAfter = chrono::seconds(retryAfter);
+    long connects = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    requestCount++;
+    connectionCount += (uint64_t) connects;
+    ProfileTransfer(handle, pooled.track, detail);
+    return result;
+}
+
+void HttpClient::Lock(CURL *, curl_lock_data data, curl_lock_access, void *userp) {
+    static_cast<HttpClient *>(userp)->shareLocks[data].lock();
+}
+
+void HttpClient::Unlock(CURL *, curl_lock_data data, void *userp) {
+    static_cast<HttpClient *>(userp)->shareLocks[data].unlock();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "response_cache.h"
+
+struct HttpResult {
+    CURLcode code = CURLE_OK;
+    long status = 0;
+    HttpValidators validators;
+    // Retry-After of a 429 or 503, 0 if there was none
+    std::chrono::seconds retryAfter{0};
+
+    bool ok() const { return code == CURLE_OK; }
+};
+
+// process-wide pool of keep-alive easy handles. Each handle keeps its connections open between
+// the requests made with it; connections aren't shared between handles. DNS lookups and TLS
+// sessions are shared through one share handle, so a new connection on any thread resumes a
+// session instead of a full handshake. Owns the curl_global_init/curl_global_cleanup pair.
+class HttpClient {
+public:
+    // receives the body as it arrives, returning false aborts the transfer
+    using BodySink = std::function<bool(const char *data, size_t size)>;
+
+    static HttpClient &Get();
+
+    // caFile replaces the system's trusted certificates, e.g. for a local server in the tests
+    explicit HttpClient(std::string caFile = {});
+    ~HttpClient();
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    // keep-alive, compression, HTTP/2 and the shared caches, for handles the client doesn't own
+    // (batch mode drives its own through a multi handle)
+    void Configure(CURL *handle);
+
+    // headers may be null, detail names the transfer in the profile
+    HttpResult Fetch(const std::string &url, const curl_slist *headers, const BodySink &sink,
+                     std::string_view detail = {});
+    // collects the body in body, which is reserved from Content-Length and keeps its capacity
+    // when the caller reuses it
+    HttpResult Fetch(const std::string &url, const curl_slist *headers, std::string &body,
+                     std::string_view detail = {});
+
+    uint64_t requests() const { return requestCount; }
+    // connections opened, each one a TCP (and TLS) handshake; the rest reused a connection
+    uint64_t connections() const { return connectionCount; }
+
+private:
+    struct PooledHandle {
+        CURL *handle;
+        // row of the profile its transfers are drawn on
+        int track;
+    };
+
+    PooledHandle Acquire();
+    void Release(PooledHandle pooled);
+    HttpResult Perform(PooledHandle pooled, const std::string &url, const curl_slist *headers,
+                       curl_write_callback write, void *writeData, std::string_view detail);
+
+    static void Lock(CURL *, curl_lock_data data, curl_lock_access, void *userp);
+    static void Unlock(CURL *, curl_lock_data data, void *userp);
+
+    std::string caFile;
+    CURLSH *share;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> shareLocks;
+    std::mutex poolMutex;
+    std::vector<PooledHandle> idle;
+    int handleCount = 0;
+    std::atomic<uint64_t> requestCount{0};
+    std::atomic<uint64_t> connectionCount{0};
+};
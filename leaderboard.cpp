@@ -0,0 +1,446 @@
+#include "leaderboard.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "binary_io.h"
+#include "stat_catalog.h"
+
+using namespace std;
+
+static const char leaderboardMagic[8] = {'T', 'F', 'R', 'A', 'N', 'K', 'S', '\0'};
+static const uint32_t leaderboardVersion = 1;
+
+RankTree::RankTree() : nodes(1, Node{0, 0, 0, 0, 0, 0}) {}
+
+uint32_t RankTree::NewNode(LeaderboardEntry entry) {
+    // xorshift, the priorities only have to look random to keep the tree balanced
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    Node node{entry.value, entry.steamId, (uint32_t) (random >> 32), 1, 0, 0};
+    if (!freeNodes.empty()) {
+        uint32_t index = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return (uint32_t) (nodes.size() - 1);
+}
+
+void RankTree::Split(uint32_t node, LeaderboardEntry entry, uint32_t &before, uint32_t &after) {
+    if (node == 0) {
+        before = after = 0;
+        return;
+    }
+    if (Precedes(nodes[node], entry)) {
+        Split(nodes[node].right, entry, nodes[node].right, after);
+        before = node;
+    } else {
+        Split(nodes[node].left, entry, before, nodes[node].left);
+        after = node;
+    }
+    Resize(node);
+}
+
+uint32_t RankTree::Merge(uint32_t before, uint32_t after) {
+    if (before == 0 || after == 0) {
+        return before ? before : after;
+    }
+    if (nodes[before].priority > nodes[after].priority) {
+        nodes[before].right = Merge(nodes[before].right, after);
+        Resize(before);
+        return before;
+    }
+    nodes[after].left = Merge(before, nodes[after].left);
+    Resize(after);
+    return after;
+}
+
+// goes down like a binary search tree until the new node's priority puts it above the rest
+uint32_t RankTree::InsertAt(uint32_t node, uint32_t inserted) {
+    if (node == 0) {
+        return inserted;
+    }
+    Node &added = nodes[inserted];
+    LeaderboardEntry entry{added.steamId, added.value};
+    if (added.priority > nodes[node].priority) {
+        Split(node, entry, added.left, added.right);
+        Resize(inserted);
+        return inserted;
+    }
+    if (Precedes(nodes[node], entry)) {
+        nodes[node].right = InsertAt(nodes[node].right, inserted);
+    } else {
+        nodes[node].left = InsertAt(nodes[node].left, inserted);
+    }
+    nodes[node].size++;
+    return node;
+}
+
+bool RankTree::EraseAt(uint32_t &node, LeaderboardEntry entry) {
+    if (node == 0) {
+        return false;
+    }
+    Node &current = nodes[node];
+    if (current.value == entry.value && current.steamId == entry.steamId) {
+        freeNodes.push_back(node);
+        node = Merge(current.left, current.right);
+        return true;
+    }
+    bool erased = EraseAt(Precedes(current, entry) ? current.right : current.left, entry);
+    if (erased) {
+        current.size--;
+    }
+    return erased;
+}
+
+void RankTree::Insert(LeaderboardEntry entry) {
+    // made before InsertAt starts, which holds references into nodes
+    uint32_t inserted = NewNode(entry);
+    root = InsertAt(root, inserted);
+}
+
+bool RankTree::Erase(LeaderboardEntry entry) {
+    return EraseAt(root, entry);
+}
+
+void RankTree::Build(const vector<LeaderboardEntry> &ordered) {
+    nodes.resize(1);
+    nodes.reserve(ordered.size() + 1);
+    freeNodes.clear();
+    // the right spine of the tree built so far, a new node goes below the last one with a higher
+    // priority and takes the ones it passes as its left subtree
+    vector<uint32_t> spine;
+    for (auto &entry: ordered) {
+        uint32_t node = NewNode(entry);
+        uint32_t passed = 0;
+        while (!spine.empty() && nodes[spine.back()].priority < nodes[node].priority) {
+            passed = spine.back();
+            spine.pop_back();
+            Resize(passed);
+        }
+        nodes[node].left = passed;
+        if (!spine.empty()) {
+            nodes[spine.back()].right = node;
+        }
+        spine.push_back(node);
+    }
+    // the bottom of the spine has the highest priority of all
+    root = spine.empty() ? 0 : spine.front();
+    while (!spine.empty()) {
+        Resize(spine.back());
+        spine.pop_back();
+    }
+}
+
+size_t RankTree::Before(LeaderboardEntry entry) const {
+    size_t count = 0;
+    uint32_t node = root;
+    while (node != 0) {
+        if (Precedes(nodes[node], entry)) {
+            count += nodes[nodes[node].left].size + 1;
+            node = nodes[node].right;
+        } else {
+            node = nodes[node].left;
+        }
+    }
+    return count;
+}
+
+void RankTree::Top(size_t k, vector<LeaderboardEntry> &out) const {
+    vector<uint32_t> path;
+    uint32_t node = root;
+    while (k > 0 && (node != 0 || !path.empty())) {
+        while (node != 0) {
+            path.push_back(node);
+            node = nodes[node].left;
+        }
+        node = path.back();
+        path.pop_back();
+        out.push_back({nodes[node].steamId, nodes[node].value});
+        k--;
+        node = nodes[node].right;
+    }
+}
+
+void LeaderboardIndex::AddName(StatId stat) {
+    const StatInfo &info = StatCatalog::Get()[stat];
+    names.emplace(info.fullName, stat);
+    if (info.category == StatCategory::Map) {
+        names.emplace(info.mapName, stat);
+    }
+}
+
+void LeaderboardIndex::Update(uint64_t steamId, const PlayerStats &stats) {
+    // the ranked stats of all three sections, ordered by id like one StatColumns
+    vector<pair<StatId, int64_t>> current;
+    for (auto columns: {&stats.pvpStats, &stats.mvmStats, &stats.mapStats}) {
+        for (size_t i = 0; i < columns->size(); i++) {
+            current.emplace_back(columns->ids[i], columns->values[i]);
+        }
+    }
+    sort(current.begin(), current.end());
+
+    unique_lock lock(mutex);
+    StatColumns &previous = ranked[steamId];
+    size_t i = 0;
+    size_t j = 0;
+    while (i < previous.size() || j < current.size()) {
+        if (j == current.size() || (i < previous.size() && previous.ids[i] < current[j].first)) {
+            trees[previous.ids[i]].Erase({steamId, previous.values[i]});
+            i++;
+            continue;
+        }
+        auto [stat, value] = current[j];
+        if (i < previous.size() && previous.ids[i] == stat) {
+            if (previous.values[i] != value) {
+                RankTree &tree = trees[stat];
+                tree.Erase({steamId, previous.values[i]});
+                tree.Insert({steamId, value});
+            }
+            i++;
+        } else {
+            auto [it, added] = trees.try_emplace(stat);
+            if (added) {
+                AddName(stat);
+            }
+            it->second.Insert({steamId, value});
+        }
+        j++;
+    }
+
+    if (current.empty()) {
+        ranked.erase(steamId);
+        return;
+    }
+    previous.ids.resize(current.size());
+    previous.values.resize(current.size());
+    for (size_t k = 0; k < current.size(); k++) {
+        previous.ids[k] = current[k].first;
+        previous.values[k] = current[k].second;
+    }
+}
+
+bool LeaderboardIndex::Remove(uint64_t steamId) {
+    unique_lock lock(mutex);
+    auto it = ranked.find(steamId);
+    if (it == ranked.end()) {
+        return false;
+    }
+    for (size_t i = 0; i < it->second.size(); i++) {
+        trees[it->second.ids[i]].Erase({steamId, it->second.values[i]});
+    }
+    ranked.erase(it);
+    return true;
+}
+
+optional<StatId> LeaderboardIndex::Find(string_view name) const {
+    shared_lock lock(mutex);
+    auto it = names.find(name);
+    if (it == names.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+vector<LeaderboardEntry> LeaderboardIndex::Top(StatId stat, size_t k) const {
+    vector<LeaderboardEntry> top;
+    shared_lock lock(mutex);
+    auto it = trees.find(stat);
+    if (it != trees.end()) {
+        top.reserve(min(k, it->second.size()));
+        it->second.Top(k, top);
+    }
+    return top;
+}
+
+optional<PlayerRank> LeaderboardIndex::Rank(StatId stat, uint64_t steamId) const {
+    shared_lock lock(mutex);
+    auto player = ranked.find(steamId);
+    auto tree = trees.find(stat);
+    if (player == ranked.end() || tree == trees.end()) {
+        return nullopt;
+    }
+    const StatColumns &columns = player->second;
+    auto at = lower_bound(columns.ids.begin(), columns.ids.end(), stat);
+    if (at == columns.ids.end() || *at != stat) {
+        return nullopt;
+    }
+    int64_t value = columns.values[at - columns.ids.begin()];
+
+    PlayerRank rank{};
+    rank.value = value;
+    rank.players = tree->second.size();
+    // everyone with a higher value comes before SteamID64 0, everyone with the same or a higher
+    // one before the largest SteamID64
+    rank.rank = tree->second.Before({0, value}) + 1;
+    size_t atLeast = tree->second.Before({numeric_limits<uint64_t>::max(), value});
+    rank.percentile = 100.0 * (double) (rank.players - atLeast) / (double) rank.players;
+    return rank;
+}
+
+size_t LeaderboardIndex::players() const {
+    shared_lock lock(mutex);
+    return ranked.size();
+}
+
+// makes a rename in the directory durable, Windows can't sync a directory
+static bool SyncDirectory(const filesystem::path &directory) {
+#ifdef _WIN32
+    (void) directory;
+    return true;
+#else
+    int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    // some file systems can't sync a directory and say so with EINVAL
+    bool ok = fsync(fd) == 0 || errno == EINVAL;
+    ok &= close(fd) == 0;
+    return ok;
+#endif
+}
+
+// magic, version, the number of stats, then for every stat its name, how many players have it
+// and those players from the highest value down as SteamID64 and zigzag varint value
+bool LeaderboardIndex::Save(const string &path) const {
+    string contents;
+    ByteWriter writer(contents);
+    writer.Bytes(string_view(leaderboardMagic, sizeof(leaderboardMagic)));
+    writer.U32(leaderboardVersion);
+    {
+        shared_lock lock(mutex);
+        writer.VarUInt(trees.size());
+        vector<LeaderboardEntry> entries;
+        for (auto &[stat, tree]: trees) {
+            entries.clear();
+            tree.Top(tree.size(), entries);
+            writer.String(StatCatalog::Get()[stat].fullName);
+            writer.VarUInt(entries.size());
+            for (auto &entry: entries) {
+                writer.U64(entry.steamId);
+                writer.VarInt(entry.value);
+            }
+        }
+    }
+
+    // synced before it replaces the last snapshot, so a crawl checkpoint that relies on it never
+    // gets to the disk first
+    filesystem::path temp = path;
+    temp += ".tmp" + to_string(random_device{}());
+    bool ok = false;
+    if (FILE *file = fopen(temp.string().c_str(), "wb")) {
+        ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size() && fflush(file) == 0;
+#ifdef _WIN32
+        ok = ok && _commit(_fileno(file)) == 0;
+#else
+        ok = ok && fsync(fileno(file)) == 0;
+#endif
+        ok &= fclose(file) == 0;
+    }
+    error_code ec;
+    if (!ok) {
+        fprintf(stderr, "Error: could not write %s\n", path.c_str());
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    filesystem::rename(temp, path, ec);
+    if (ec) {
+        fprintf(stderr, "Error: could not write %s: %s\n", path.c_str(), ec.message().c_str());
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    if (!SyncDirectory(filesystem::path(path).parent_path())) {
+        fprintf(stderr, "Error: could not sync the directory of %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LeaderboardIndex::Load(const string &path, const StatDescriptionIndex &descriptions) {
+    string contents;
+    {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            fprintf(stderr, "Error: could not open %s\n", path.c_str());
+            return false;
+        }
+        contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    ByteReader reader(contents);
+    string_view magic;
+    uint32_t version = 0;
+    uint64_t statCount = 0;
+    if (!reader.Bytes(sizeof(leaderboardMagic), magic) ||
+        magic != string_view(leaderboardMagic, sizeof(leaderboardMagic)) || !reader.U32(version)) {
+        fprintf(stderr, "Error: %s is not a leaderboard snapshot\n", path.c_str());
+        return false;
+    }
+    if (version != leaderboardVersion) {
+        fprintf(stderr, "Error: %s was written by another version\n", path.c_str());
+        return false;
+    }
+
+    unordered_map<StatId, RankTree> loadedTrees;
+    unordered_map<uint64_t, StatColumns> loadedPlayers;
+    bool ok = reader.VarUInt(statCount);
+    vector<LeaderboardEntry> entries;
+    for (uint64_t i = 0; ok && i < statCount; i++) {
+        string_view name;
+        uint64_t count = 0;
+        ok = reader.String(name) && reader.VarUInt(count) && count <= contents.size();
+        if (!ok) {
+            break;
+        }
+        StatId stat = StatCatalog::Get().Intern(name, descriptions);
+        entries.clear();
+        entries.reserve(count);
+        for (uint64_t j = 0; ok && j < count; j++) {
+            LeaderboardEntry entry{};
+            ok = reader.U64(entry.steamId) && reader.VarInt(entry.value);
+            const LeaderboardEntry *last = entries.empty() ? nullptr : &entries.back();
+            // out of order would break the tree, and a player ranks at most once per stat
+            ok = ok && (!last || last->value > entry.value ||
+                        (last->value == entry.value && last->steamId < entry.steamId));
+            if (ok) {
+                entries.push_back(entry);
+                loadedPlayers[entry.steamId].Add(stat, entry.value);
+            }
+        }
+        ok = ok && loadedTrees.try_emplace(stat).second;
+        if (ok) {
+            loadedTrees[stat].Build(entries);
+        }
+    }
+    if (!ok || !reader.atEnd()) {
+        fprintf(stderr, "Error: %s is damaged\n", path.c_str());
+        return false;
+    }
+
+    unique_lock lock(mutex);
+    trees = std::move(loadedTrees);
+    ranked = std::move(loadedPlayers);
+    names.clear();
+    for (auto &[stat, tree]: trees) {
+        AddName(stat);
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "data_classes.h"
+#include "stat_index.h"
+
+struct LeaderboardEntry {
+    uint64_t steamId;
+    int64_t value;
+};
+
+struct PlayerRank {
+    int64_t value;
+    // 1 for the highest value, players with the same value share a rank
+    size_t rank;
+    // players that have the stat
+    size_t players;
+    // share of them with a lower value, 0 to 100
+    double percentile;
+};
+
+// one stat's players ordered from the highest value down, ties by SteamID64. A treap whose nodes
+// know the size of their subtree, so a player's position is counted on the way down and inserts
+// and erases take O(log n). Nodes live in one vector and refer to each other by index.
+class RankTree {
+public:
+    RankTree();
+
+    void Insert(LeaderboardEntry entry);
+    bool Erase(LeaderboardEntry entry);
+    // replaces the tree in O(n), entries have to be in order already
+    void Build(const std::vector<LeaderboardEntry> &ordered);
+
+    // how many entries come before this one, whether it is in the tree or not
+    size_t Before(LeaderboardEntry entry) const;
+    // the first k entries (or all of them) in order, appended to out
+    void Top(size_t k, std::vector<LeaderboardEntry> &out) const;
+
+    size_t size() const { return nodes[root].size; }
+
+private:
+    struct Node {
+        int64_t value;
+        uint64_t steamId;
+        uint32_t priority;
+        uint32_t size;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    static bool Precedes(const Node &node, LeaderboardEntry entry) {
+        return node.value > entry.value || (node.value == entry.value && node.steamId < entry.steamId);
+    }
+
+    uint32_t NewNode(LeaderboardEntry entry);
+    void Resize(uint32_t node) { nodes[node].size = 1 + nodes[nodes[node].left].size + nodes[nodes[node].right].size; }
+    void Split(uint32_t node, LeaderboardEntry entry, uint32_t &before, uint32_t &after);
+    uint32_t Merge(uint32_t before, uint32_t after);
+    uint32_t InsertAt(uint32_t node, uint32_t inserted);
+    bool EraseAt(uint32_t &node, LeaderboardEntry entry);
+
+    // node 0 stands for no node, its size is always 0
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = 0;
+    uint64_t random = 0x9e3779b97f4a7c15ULL;
+};
+
+// who is top-k in, and where a player ranks on, every class stat (PvP and MvM) and every map's
+// play time across all players it has seen. Updating a player replaces their values of the stats
+// that changed, each in O(log n), queries never scan. Thread-safe, queries run concurrently.
+class LeaderboardIndex {
+public:
+    // puts the player's class and map stats in place of what the index had for them
+    void Update(uint64_t steamId, const PlayerStats &stats);
+    bool Remove(uint64_t steamId);
+
+    // a stat by its full name, or a map's play time by the map's name
+    std::optional<StatId> Find(std::string_view name) const;
+    std::vector<LeaderboardEntry> Top(StatId stat, size_t k) const;
+    // nothing if the player doesn't have the stat
+    std::optional<PlayerRank> Rank(StatId stat, uint64_t steamId) const;
+
+    size_t players() const;
+
+    // every stat's players in order, by stat name so another process can load it. Written to a
+    // temporary file and synced first, an interrupted save leaves the last snapshot as it was and
+    // a successful one is on disk when it returns.
+    bool Save(const std::string &path) const;
+    // replaces the index with a snapshot, rebuilding every stat in O(n)
+    bool Load(const std::string &path, const StatDescriptionIndex &descriptions);
+
+private:
+    // the caller holds mutex
+    void AddName(StatId stat);
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<StatId, RankTree> trees;
+    // what each player is ranked with, to take them out again when their stats change
+    std::unordered_map<uint64_t, StatColumns> ranked;
+    std::unordered_map<std::string, StatId, StringHash, std::equal_to<>> names;
+};
@@ -0,0 +1,115 @@
+#include "logging.h"
+
+#include <condition_variable>
+#include <cstdarg>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+static Verbosity currentVerbosity = Verbosity::Normal;
+static FILE *logOutput = stdout;
+
+class LogSink {
+public:
+    ~LogSink() {
+        {
+            lock_guard lock(pendingMutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        Drain();
+    }
+
+    void Append(const char *text, size_t size) {
+        {
+            lock_guard lock(pendingMutex);
+            pending.append(text, size);
+            if (!writer.joinable()) {
+                writer = thread([this] { Run(); });
+            }
+        }
+        ready.notify_one();
+    }
+
+    // writeMutex keeps the order of chunks when FlushLog and the writer thread race
+    void Drain() {
+        lock_guard writeLock(writeMutex);
+        {
+            lock_guard lock(pendingMutex);
+            swap(pending, writing);
+        }
+        if (!writing.empty()) {
+            fwrite(writing.data(), 1, writing.size(), logOutput);
+            fflush(logOutput);
+            writing.clear();
+        }
+    }
+
+private:
+    void Run() {
+        unique_lock lock(pendingMutex);
+        while (!stopping) {
+            ready.wait(lock, [this] { return stopping || !pending.empty(); });
+            lock.unlock();
+            Drain();
+            lock.lock();
+        }
+    }
+
+    mutex pendingMutex;
+    condition_variable ready;
+    mutex writeMutex;
+    string pending;
+    string writing;
+    bool stopping = false;
+    thread writer;
+};
+
+static LogSink &Sink() {
+    static LogSink sink;
+    return sink;
+}
+
+void SetVerbosity(Verbosity verbosity) {
+    currentVerbosity = verbosity;
+}
+
+void SetLogOutput(FILE *file) {
+    logOutput = file;
+}
+
+bool LogEnabled(Verbosity level) {
+    return level <= currentVerbosity;
+}
+
+void Log(Verbosity level, const char *format, ...) {
+    if (!LogEnabled(level)) {
+        return;
+    }
+
+    thread_local string buffer(256, '\0');
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+    int length = vsnprintf(buffer.data(), buffer.size(), format, args);
+    if (length >= 0 && (size_t) length >= buffer.size()) {
+        buffer.resize(length + 1);
+        vsnprintf(buffer.data(), buffer.size(), format, retry);
+    }
+    va_end(retry);
+    va_end(args);
+
+    if (length > 0) {
+        Sink().Append(buffer.data(), length);
+    }
+}
+
+void FlushLog() {
+    Sink().Drain();
+}
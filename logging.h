@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+
+enum class Verbosity {
+    // errors only, those always go straight to stderr
+    Quiet = 0,
+    // a line or two per player
+    Normal = 1,
+    // every stat as it is classified and rendered
+    Verbose = 2
+};
+
+// both are meant to be set once at startup, before any thread logs
+void SetVerbosity(Verbosity verbosity);
+// stdout by default
+void SetLogOutput(FILE *file);
+
+bool LogEnabled(Verbosity level);
+
+// printf-style, the formatted text is queued and written by a background thread in large
+// chunks, so logging never waits for the console
+void Log(Verbosity level, const char *format, ...);
+// blocks until everything logged so far was written
+void FlushLog();
@@ -3,10 +3,17 @@
 #include <iostream>
 #include <chrono>
 #include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
 
-class PlayerStats;
+#include "data_classes.h"
 
-void FindAndReplaceAll(std::string &data, const std::string& toSearch, const std::string& replaceStr)
+class StatDescriptionIndex;
+class ResponseCache;
+
+inline void FindAndReplaceAll(std::string &data, const std::string& toSearch, const std::string& replaceStr)
 {
     // Get the first occurrence
     size_t pos = data.find(toSearch);
@@ -20,47 +27,37 @@ void FindAndReplaceAll(std::string &data, const std::string& toSearch, const std
         pos = data.find(toSearch, pos + replaceStr.size());
     }
 }
-std::string ConvertMSToHHMMSS(std::chrono::milliseconds ms)
-{
-    using namespace std::chrono;
-    std::stringstream ss;
-
-    // compute h, m, s
-    auto secs = duration_cast<seconds>(ms);
-    ms -= duration_cast<milliseconds>(secs);
-
-    auto mins = duration_cast<minutes>(secs);
-    secs -= duration_cast<seconds>(mins);
-
-    auto hour = duration_cast<hours>(mins);
-    mins -= duration_cast<minutes>(hour);
-
-    std::string hr(std::to_string(hour.count()));
-    std::string min(std::to_string(mins.count()));
-    std::string s(std::to_string(secs.count()));
-    //std::string msecs(std::to_string(ms.count()));
-
-    // msecs = msecs.substr(0, 2);
 
-    // add leading zero if needed
-    std::string hh = std::string(4 - hr.length(), '0') + hr;
-    std::string mm = std::string(2 - min.length(), '0') + min;
-    std::string sec = std::string(2 - s.length(), '0') + s;
+const std::string statsEndpoint =
+        "/ISteamUserStats/GetUserStatsForGame/v0002/?appid=440&key=apikey&steamid=id64";
+const std::string playerSummariesEndpoint =
+        "/ISteamUser/GetPlayerSummaries/v2/?key=apikey&format=json&steamids=id64";
 
-    // return mm:ss if hh is 0000
-    if (hh.compare("0000") != 0)
-    {
-        ss << hr << ":" << mm << ":" << sec;
-    }
-    else
-    {
-        ss << mm << ":" << sec;
-    }
-
-    return ss.str();
+// steamIds may be a comma-separated list for GetPlayerSummaries
+inline std::string BuildApiUrl(const std::string& apiBase, const std::string& endpoint,
+                               const std::string& apiKey, const std::string& steamIds)
+{
+    std::string url = apiBase + endpoint;
+    FindAndReplaceAll(url, "id64", steamIds);
+    FindAndReplaceAll(url, "apikey", apiKey);
+    return url;
 }
-std::map<std::string, std::string> FetchDescriptions();
-template<class T>
-std::string getDescriptionForStat(const std::map<std::string, std::string>& desc, T stat);
-PlayerStats FetchResults(const std::string& apiUrl);
-void ParseResults(const PlayerStats& stats);
\ No newline at end of file
+
+// adds the descriptions from a file in the stat_names.json format on top of the built-in ones
+bool LoadStatNames(const std::string& path, StatDescriptionIndex& descriptions);
+// classifies one stat of a GetUserStatsForGame response: its id and the section of PlayerStats it
+// goes in, false for stats that aren't shown
+bool InternStat(const StatDescriptionIndex& descriptions, std::string_view statName, int64_t value, StatId& id,
+                StatSection& section);
+// classifies one stat of a GetUserStatsForGame response and appends it to playerStats
+void AddStat(PlayerStats& playerStats, const StatDescriptionIndex& descriptions, std::string_view statName,
+             int64_t value);
+PlayerStats ParsePlayerStats(const std::string& json, const StatDescriptionIndex& descriptions);
+// cache may be null, steamId is only used as the cache key. Failures are reported on stderr and
+// return nothing.
+std::optional<PlayerStats> FetchResults(const std::string& apiUrl, const StatDescriptionIndex& descriptions,
+                         const ResponseCache* cache = nullptr, const std::string& steamId = "");
+// SteamID64 -> persona name for every player in a GetPlayerSummaries response
+std::map<std::string, std::string> ParsePersonaNames(const std::string& json);
+std::string getPersonaName(const std::string& apiUrl, const ResponseCache* cache = nullptr,
+                           const std::string& steamId = "");
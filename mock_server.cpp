@@ -0,0 +1,336 @@
+// a stand-in for the two Steam Web API endpoints the parser uses, serving synthetic players (see
+// player_generator.h) so batches and the service can be load tested without an API key. Faults
+// the real API shows under load can be injected: latency, limited bandwidth, 5xx errors, 429s
+// and bodies cut off halfway. Point the parser at it with --api-base http://127.0.0.1:<port>.
+//
+// usage: tf-steam-api-mock [--port <n>] [--threads <n>] [--latency <ms>] [--jitter <ms>]
+//                          [--bandwidth <KiB/s>] [--error-rate <p>] [--throttle-rate <p>]
+//                          [--truncate-rate <p>] [--extra-stats <n>] [--value-scale <n>]
+//                          [--seed <n>] [-v]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/URI.h>
+
+#include "logging.h"
+#include "player_generator.h"
+#include "server.h"
+
+using namespace std;
+using Poco::Net::HTTPResponse;
+using Poco::Net::HTTPServerRequest;
+using Poco::Net::HTTPServerResponse;
+
+// GetPlayerSummaries answers at most this many players per call, like the real one
+static const size_t maxSummaries = 100;
+// bandwidth is metered out in this many slices per second
+static const unsigned slicesPerSecond = 20;
+
+struct MockSettings {
+    unsigned port = 8080;
+    // most of a request is spent sleeping, so there are plenty of them
+    unsigned threads = 64;
+    double latencyMs = 0;
+    // added to latencyMs, uniformly distributed
+    double jitterMs = 0;
+    // per response, 0 is unlimited
+    double bandwidthKiB = 0;
+    // fractions of requests that fail in each way, checked in this order
+    double throttleRate = 0;
+    double errorRate = 0;
+    double truncateRate = 0;
+    PlayerGeneratorSettings players;
+};
+
+struct MockCounters {
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> stats{0};
+    atomic<uint64_t> summaries{0};
+    atomic<uint64_t> throttled{0};
+    atomic<uint64_t> errors{0};
+    atomic<uint64_t> truncated{0};
+    atomic<uint64_t> bytes{0};
+};
+
+class MockApi {
+public:
+    explicit MockApi(const MockSettings &settings) : settings(settings), generator(settings.players) {}
+
+    void Handle(HTTPServerRequest &request, HTTPServerResponse &response) {
+        counters.requests++;
+        Poco::URI uri(request.getURI());
+        const string &path = uri.getPath();
+        string steamIds;
+        string key;
+        for (auto &[name, value]: uri.getQueryParameters()) {
+            if (name == "steamid" || name == "steamids") {
+                steamIds = value;
+            } else if (name == "key") {
+                key = value;
+            }
+        }
+        Log(Verbosity::Verbose, "GET %s\n", request.getURI().c_str());
+
+        Delay();
+        if (request.getMethod() != "GET") {
+            SendError(response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+            return;
+        }
+        bool stats = path == "/ISteamUserStats/GetUserStatsForGame/v0002/" ||
+                     path == "/ISteamUserStats/GetUserStatsForGame/v2/";
+        bool summaries = path == "/ISteamUser/GetPlayerSummaries/v2/" ||
+                         path == "/ISteamUser/GetPlayerSummaries/v0002/";
+        if (!stats && !summaries) {
+            SendError(response, HTTPResponse::HTTP_NOT_FOUND);
+            return;
+        }
+        // any key will do, but like the real API there has to be one
+        if (key.empty()) {
+            SendError(response, HTTPResponse::HTTP_FORBIDDEN);
+            return;
+        }
+
+        double roll = Uniform(0, 1);
+        if (roll < settings.throttleRate) {
+            counters.throttled++;
+            response.set("Retry-After", "1");
+            SendError(response, HTTPResponse::HTTP_TOO_MANY_REQUESTS);
+            return;
+        }
+        roll -= settings.throttleRate;
+        if (roll < settings.errorRate) {
+            counters.errors++;
+            static const HTTPResponse::HTTPStatus failures[] = {HTTPResponse::HTTP_INTERNAL_SERVER_ERROR,
+                                                                HTTPResponse::HTTP_BAD_GATEWAY,
+                                                                HTTPResponse::HTTP_SERVICE_UNAVAILABLE};
+            SendError(response, failures[(size_t) Uniform(0, size(failures)) % size(failures)]);
+            return;
+        }
+        roll -= settings.errorRate;
+        bool truncate = roll < settings.truncateRate;
+
+        vector<string_view> ids = SplitIds(steamIds);
+        if (ids.empty() || (stats && ids.size() != 1) || ids.size() > maxSummaries) {
+            SendError(response, HTTPResponse::HTTP_BAD_REQUEST);
+            return;
+        }
+        if (stats) {
+            counters.stats++;
+            Send(response, generator.StatsResponse(ids[0]), truncate);
+        } else {
+            counters.summaries++;
+            Send(response, generator.SummariesResponse(ids), truncate);
+        }
+    }
+
+    void LogSummary() const {
+        Log(Verbosity::Normal,
+            "%llu requests: %llu stats, %llu summaries, %llu throttled, %llu failed, %llu truncated, %.1f MiB sent\n",
+            (unsigned long long) counters.requests.load(), (unsigned long long) counters.stats.load(),
+            (unsigned long long) counters.summaries.load(), (unsigned long long) counters.throttled.load(),
+            (unsigned long long) counters.errors.load(), (unsigned long long) counters.truncated.load(),
+            counters.bytes.load() / (1024.0 * 1024.0));
+    }
+
+private:
+    // comma-separated SteamID64s, nothing if any of them isn't one
+    static vector<string_view> SplitIds(string_view list) {
+        vector<string_view> ids;
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            string_view id = list.substr(0, comma);
+            if (id.empty() || !all_of(id.begin(), id.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                return {};
+            }
+            ids.push_back(id);
+            list = comma == string_view::npos ? string_view() : list.substr(comma + 1);
+        }
+        return ids;
+    }
+
+    double Uniform(double low, double high) {
+        thread_local mt19937_64 random(settings.players.seed ^ hash<thread::id>()(this_thread::get_id()));
+        return uniform_real_distribution<double>(low, high)(random);
+    }
+
+    void Delay() {
+        double ms = settings.latencyMs + (settings.jitterMs > 0 ? Uniform(0, settings.jitterMs) : 0);
+        if (ms > 0) {
+            this_thread::sleep_for(chrono::duration<double, milli>(ms));
+        }
+    }
+
+    // the real API answers errors with a bit of HTML
+    static void SendError(HTTPServerResponse &response, HTTPResponse::HTTPStatus status) {
+        string body = "<html><head><title>" + to_string((int) status) + "</title></head><body><h1>" +
+                      to_string((int) status) + "</h1></body></html>";
+        response.setStatus(status);
+        response.setContentType("text/html; charset=UTF-8");
+        response.sendBuffer(body.data(), body.size());
+    }
+
+    // a truncated body announces its full length and then stops, the connection is closed under it
+    void Send(HTTPServerResponse &response, const string &body, bool truncate) {
+        size_t length = body.size();
+        if (truncate) {
+            counters.truncated++;
+            length = (size_t) ((double) body.size() * Uniform(0.1, 0.9));
+            response.setKeepAlive(false);
+        }
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType("application/json; charset=UTF-8");
+        response.setContentLength((streamsize) body.size());
+        ostream &out = response.send();
+        size_t slice = settings.bandwidthKiB > 0
+                               ? max<size_t>(1, (size_t) (settings.bandwidthKiB * 1024 / slicesPerSecond))
+                               : length;
+        auto next = chrono::steady_clock::now();
+        for (size_t offset = 0; offset < length && out; offset += slice) {
+            if (offset > 0) {
+                next += chrono::milliseconds(1000 / slicesPerSecond);
+                this_thread::sleep_until(next);
+            }
+            size_t size = min(slice, length - offset);
+            out.write(body.data() + offset, (streamsize) size);
+            out.flush();
+            counters.bytes += size;
+        }
+    }
+
+    const MockSettings &settings;
+    PlayerGenerator generator;
+    MockCounters counters;
+};
+
+class MockRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit MockRequestHandler(MockApi &api) : api(api) {}
+
+    void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override {
+        api.Handle(request, response);
+    }
+
+private:
+    MockApi &api;
+};
+
+class MockRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    explicit MockRequestHandlerFactory(MockApi &api) : api(api) {}
+
+    Poco::Net::HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override {
+        return new MockRequestHandler(api);
+    }
+
+private:
+    MockApi &api;
+};
+
+static bool ParseNumber(const char *flag, const char *value, double low, double high, double &out) {
+    char *end = nullptr;
+    double parsed = strtod(value, &end);
+    if (*value == '\0' || *end != '\0' || !(parsed >= low && parsed <= high)) {
+        fprintf(stderr, "Error: %s expects a number from %g to %g, got \"%s\"\n", flag, low, high, value);
+        return false;
+    }
+    out = parsed;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    MockSettings settings;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--verbose") == 0 || strcmp(arg, "-v") == 0) {
+            SetVerbosity(Verbosity::Verbose);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr,
+                    "Usage: %s [--port <n>] [--threads <n>] [--latency <ms>] [--jitter <ms>] [--bandwidth <KiB/s>]\n"
+                    "       [--error-rate <p>] [--throttle-rate <p>] [--truncate-rate <p>] [--extra-stats <n>]\n"
+                    "       [--value-scale <n>] [--seed <n>] [-v]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+        const char *value = argv[++i];
+        double number;
+        bool valid;
+        if (strcmp(arg, "--port") == 0) {
+            valid = ParseNumber(arg, value, 1, 65535, number);
+            settings.port = (unsigned) number;
+        } else if (strcmp(arg, "--threads") == 0) {
+            valid = ParseNumber(arg, value, 1, 4096, number);
+            settings.threads = (unsigned) number;
+        } else if (strcmp(arg, "--latency") == 0) {
+            valid = ParseNumber(arg, value, 0, 600000, settings.latencyMs);
+        } else if (strcmp(arg, "--jitter") == 0) {
+            valid = ParseNumber(arg, value, 0, 600000, settings.jitterMs);
+        } else if (strcmp(arg, "--bandwidth") == 0) {
+            valid = ParseNumber(arg, value, 0, 1e9, settings.bandwidthKiB);
+        } else if (strcmp(arg, "--error-rate") == 0) {
+            valid = ParseNumber(arg, value, 0, 1, settings.errorRate);
+        } else if (strcmp(arg, "--throttle-rate") == 0) {
+            valid = ParseNumber(arg, value, 0, 1, settings.throttleRate);
+        } else if (strcmp(arg, "--truncate-rate") == 0) {
+            valid = ParseNumber(arg, value, 0, 1, settings.truncateRate);
+        } else if (strcmp(arg, "--extra-stats") == 0) {
+            valid = ParseNumber(arg, value, 0, 1000000, number);
+            settings.players.extraStats = (unsigned) number;
+        } else if (strcmp(arg, "--value-scale") == 0) {
+            valid = ParseNumber(arg, value, 1, 1e12, number);
+            settings.players.valueScale = (int64_t) number;
+        } else if (strcmp(arg, "--seed") == 0) {
+            valid = ParseNumber(arg, value, 0, 1e18, number);
+            settings.players.seed = (uint64_t) number;
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", arg);
+            return EXIT_FAILURE;
+        }
+        if (!valid) {
+            return EXIT_FAILURE;
+        }
+    }
+    if (settings.throttleRate + settings.errorRate + settings.truncateRate > 1) {
+        fprintf(stderr, "Error: --throttle-rate, --error-rate and --truncate-rate add up to more than 1\n");
+        return EXIT_FAILURE;
+    }
+
+    BlockTerminationSignals();
+    MockApi api(settings);
+    Poco::ThreadPool pool(2, (int) settings.threads);
+    Poco::Net::HTTPServerParams::Ptr params = new Poco::Net::HTTPServerParams;
+    params->setMaxThreads((int) settings.threads);
+    try {
+        Poco::Net::ServerSocket socket((Poco::UInt16) settings.port);
+        Poco::Net::HTTPServer server(new MockRequestHandlerFactory(api), pool, socket, params);
+        server.start();
+        Log(Verbosity::Normal, "Mock Steam Web API on http://127.0.0.1:%u\n", settings.port);
+        WaitForTermination();
+        server.stopAll();
+        pool.joinAll();
+    } catch (const exception &e) {
+        fprintf(stderr, "Error: could not serve on port %u: %s\n", settings.port, e.what());
+        return EXIT_FAILURE;
+    }
+    api.LogSummary();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,356 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+using namespace std;
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] [steamid64] [apikey]\n"
+            "       %s --batch <file|-> [options] [apikey]\n"
+            "       %s [--batch <file>] --queue <file> [--shard <k>/<n>] [options] [apikey]\n"
+            "       %s --serve <port> [options] [apikey]\n"
+            "       %s --history-dir <dir> --since <time> [--until <time>] [options] <steamid64>\n"
+            "       %s --aggregate <file> [--rank <stat>]... [--top <n>] [options]\n\n"
+            "Options:\n"
+            "  --output <file|->       where a single player's stats are written, and a batch's with\n"
+            "                          --format ndjson (default: stats.<format>)\n"
+            "  --format <format>       md (rendered from the templates), json, csv or ndjson\n"
+            "                          (default: md)\n"
+            "  --watch <seconds>       keep fetching a single player's stats at this interval and\n"
+            "                          rewrite --output whenever they changed\n"
+            "  --batch <file|->        read SteamID64s (one per line) from a file or stdin\n"
+            "  --out-dir <dir>         directory for batch output files (default: .)\n"
+            "  --max-inflight <n>      concurrent HTTP transfers in batch mode (default: 16)\n"
+            "  --workers <n>           parse/render threads in batch mode and aggregation threads\n"
+            "                          (default: all cores), request threads in service mode\n"
+            "                          (default: 16)\n"
+            "  --export <file>         append every player of a batch to a columnar stats file\n"
+            "  --queue <file>          crawl through a work queue that is created from --batch the\n"
+            "                          first time, later runs resume where the last one stopped\n"
+            "  --shard <k>/<n>         only crawl the k-th of n disjoint slices of the queue, one\n"
+            "                          worker per slice (default: 1/1)\n"
+            "  --serve <port>          run as an HTTP service answering GET /stats/<steamid64>\n"
+            "                          (Markdown, or ?format=json or csv) and GET /metrics\n"
+            "  --max-players <n>       players the service keeps in memory (default: 1024), they\n"
+            "                          are fetched again after --cache-ttl seconds\n"
+            "  --leaderboard <file>    rank every fetched player's class and map stats, kept in this\n"
+            "                          file between runs, not with --shard (the service answers\n"
+            "                          GET /top/<stat> and GET /rank/<stat>/<steamid64> either way)\n"
+            "  --api-base <url>        Steam Web API base URL (default: %s)\n"
+            "  --rate <n>              Steam Web API requests per second, fractions allowed\n"
+            "                          (default: unlimited)\n"
+            "  --daily-budget <n>      Steam Web API requests per UTC day (default: 100000)\n"
+            "  --stat-names <file>     load additional or changed stat descriptions from a file in\n"
+            "                          the stat_names.json format\n"
+            "  --cache-dir <dir>       cache responses in this directory\n"
+            "  --cache-ttl <seconds>   how long cached responses are used without asking the API\n"
+            "                          again (default: 300), after that they are revalidated\n"
+            "  --offline               only use cached responses (needs --cache-dir)\n"
+            "  --history-dir <dir>     append a snapshot of every fetched player's stats to a log in\n"
+            "                          this directory\n"
+            "  --since <time>          instead of fetching, render the stats that changed between\n"
+            "  --until <time>          the snapshots taken last before these times (default: now),\n"
+            "                          as unix time, YYYY-MM-DD or YYYY-MM-DDTHH:MM[:SS] in UTC\n"
+            "  --aggregate <file>      instead of fetching, render count, mean, percentiles, min and\n"
+            "                          max of every class and map stat over all players in an export\n"
+            "  --rank <stat>           list the top players by this stat in the aggregate, can be\n"
+            "                          repeated (default: every class's accum.iPlayTime)\n"
+            "  --top <n>               players listed per ranked stat (default: 10)\n"
+            "  -v, --verbose           log every stat as it is parsed and rendered\n"
+            "  -q, --quiet             only print errors\n"
+            "  --profile <file>        write timings, transfer sizes and allocation counts of every\n"
+            "                          phase to a Chrome trace-event file (chrome://tracing, Perfetto)\n",
+            program, program, program, program, program, program, defaultApiBase.c_str());
+}
+
+// days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = (unsigned) (year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int64_t) dayOfEra - 719468;
+}
+
+static bool ParseTime(const char *flag, const char *value, optional<int64_t> &out) {
+    char *end = nullptr;
+    long long seconds = strtoll(value, &end, 10);
+    if (*value != '\0' && *end == '\0') {
+        out = seconds;
+        return true;
+    }
+
+    int year, month, day, hour = 0, minute = 0, second = 0, length = 0;
+    int fields = sscanf(value, "%4d-%2d-%2d%n", &year, &month, &day, &length);
+    if (fields == 3 && (value[length] == 'T' || value[length] == ' ')) {
+        int timeLength = 0;
+        const char *time = value + length + 1;
+        if (sscanf(time, "%2d:%2d%n:%2d%n", &hour, &minute, &timeLength, &second, &timeLength) >= 2) {
+            length += 1 + timeLength;
+        }
+    }
+    if (fields != 3 || value[length] != '\0' || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 ||
+        minute > 59 || second > 60) {
+        fprintf(stderr, "Error: %s expects a unix time, YYYY-MM-DD or YYYY-MM-DDTHH:MM[:SS], got \"%s\"\n", flag,
+                value);
+        return false;
+    }
+    out = DaysFromCivil(year, (unsigned) month, (unsigned) day) * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+static bool ParseCount(const char *flag, const char *value, unsigned &out) {
+    char *end = nullptr;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || parsed == 0) {
+        fprintf(stderr, "Error: %s expects a positive number, got \"%s\"\n", flag, value);
+        return false;
+    }
+    out = (unsigned) parsed;
+    return true;
+}
+
+// "k/n" with 1 <= k <= n, shard is zero-based
+static bool ParseShard(const char *flag, const char *value, unsigned &shard, unsigned &shards) {
+    char *end = nullptr;
+    unsigned long k = strtoul(value, &end, 10);
+    unsigned long n = 0;
+    if (end != value && *end == '/') {
+        const char *rest = end + 1;
+        n = strtoul(rest, &end, 10);
+        if (end == rest) n = 0;
+    }
+    if (*end != '\0' || k == 0 || n == 0 || k > n || n > 1000000) {
+        fprintf(stderr, "Error: %s expects <k>/<n> with 1 <= k <= n, got \"%s\"\n", flag, value);
+        return false;
+    }
+    shard = (unsigned) k - 1;
+    shards = (unsigned) n;
+    return true;
+}
+
+static bool ParseRate(const char *flag, const char *value, double &out) {
+    char *end = nullptr;
+    double parsed = strtod(value, &end);
+    if (*value == '\0' || *end != '\0' || !(parsed > 0) || parsed > 1e6) {
+        fprintf(stderr, "Error: %s expects a positive number, got \"%s\"\n", flag, value);
+        return false;
+    }
+    out = parsed;
+    return true;
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    vector<string> positional;
+    bool outputSet = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (arg[0] != '-' || arg[1] == '\0') {
+            positional.emplace_back(arg);
+            continue;
+        }
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            return false;
+        }
+        if (strcmp(arg, "--offline") == 0) {
+            options.offline = true;
+            continue;
+        }
+        if (strcmp(arg, "--verbose") == 0 || strcmp(arg, "-v") == 0) {
+            options.verbosity = Verbosity::Verbose;
+            continue;
+        }
+        if (strcmp(arg, "--quiet") == 0 || strcmp(arg, "-q") == 0) {
+            options.verbosity = Verbosity::Quiet;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Error: missing value for %s\n", arg);
+            return false;
+        }
+        const char *value = argv[++i];
+
+        if (strcmp(arg, "--batch") == 0) {
+            options.batchFile = value;
+        } else if (strcmp(arg, "--output") == 0) {
+            options.output = value;
+            outputSet = true;
+        } else if (strcmp(arg, "--format") == 0) {
+            optional<OutputFormat> format = ParseOutputFormat(value);
+            if (!format) {
+                fprintf(stderr, "Error: unknown format \"%s\", expected md, json, csv or ndjson\n", value);
+                return false;
+            }
+            options.format = *format;
+        } else if (strcmp(arg, "--out-dir") == 0) {
+            options.outDir = value;
+        } else if (strcmp(arg, "--max-inflight") == 0) {
+            if (!ParseCount(arg, value, options.maxInFlight)) return false;
+        } else if (strcmp(arg, "--workers") == 0) {
+            if (!ParseCount(arg, value, options.workers)) return false;
+        } else if (strcmp(arg, "--export") == 0) {
+            options.exportFile = value;
+        } else if (strcmp(arg, "--queue") == 0) {
+            options.queueFile = value;
+        } else if (strcmp(arg, "--shard") == 0) {
+            if (!ParseShard(arg, value, options.shard, options.shards)) return false;
+        } else if (strcmp(arg, "--aggregate") == 0) {
+            options.aggregateFile = value;
+        } else if (strcmp(arg, "--rank") == 0) {
+            options.rankStats.emplace_back(value);
+        } else if (strcmp(arg, "--watch") == 0) {
+            if (!ParseCount(arg, value, options.watchInterval)) return false;
+        } else if (strcmp(arg, "--top") == 0) {
+            if (!ParseCount(arg, value, options.top)) return false;
+        } else if (strcmp(arg, "--serve") == 0) {
+            if (!ParseCount(arg, value, options.servePort)) return false;
+            if (options.servePort > 65535) {
+                fprintf(stderr, "Error: %s is not a valid port\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--leaderboard") == 0) {
+            options.leaderboardFile = value;
+        } else if (strcmp(arg, "--max-players") == 0) {
+            if (!ParseCount(arg, value, options.maxPlayers)) return false;
+        } else if (strcmp(arg, "--profile") == 0) {
+            options.profile = value;
+        } else if (strcmp(arg, "--stat-names") == 0) {
+            options.statNames = value;
+        } else if (strcmp(arg, "--history-dir") == 0) {
+            options.historyDir = value;
+        } else if (strcmp(arg, "--since") == 0) {
+            if (!ParseTime(arg, value, options.since)) return false;
+        } else if (strcmp(arg, "--until") == 0) {
+            if (!ParseTime(arg, value, options.until)) return false;
+        } else if (strcmp(arg, "--cache-dir") == 0) {
+            options.cacheDir = value;
+        } else if (strcmp(arg, "--cache-ttl") == 0) {
+            if (!ParseCount(arg, value, options.cacheTtl)) return false;
+        } else if (strcmp(arg, "--rate") == 0) {
+            if (!ParseRate(arg, value, options.ratePerSecond)) return false;
+        } else if (strcmp(arg, "--daily-budget") == 0) {
+            if (!ParseCount(arg, value, options.dailyBudget)) return false;
+        } else if (strcmp(arg, "--api-base") == 0) {
+            options.apiBase = value;
+            while (!options.apiBase.empty() && options.apiBase.back() == '/') {
+                options.apiBase.pop_back();
+            }
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", arg);
+            return false;
+        }
+    }
+
+    // a queue that exists already is crawled without --batch
+    bool batch = !options.batchFile.empty() || !options.queueFile.empty();
+    if (options.shards > 1 && options.queueFile.empty()) {
+        fprintf(stderr, "Error: --shard needs --queue\n");
+        return false;
+    }
+    // every worker would write its own slice's ranks over the others'
+    if (options.shards > 1 && !options.leaderboardFile.empty()) {
+        fprintf(stderr, "Error: --leaderboard can't be used with --shard\n");
+        return false;
+    }
+
+    if (options.offline && options.cacheDir.empty()) {
+        fprintf(stderr, "Error: --offline needs --cache-dir\n");
+        return false;
+    }
+    if (options.format != OutputFormat::Markdown) {
+        if (options.servePort != 0 || options.since || !options.aggregateFile.empty() || options.watchInterval != 0) {
+            fprintf(stderr, "Error: --format only works for single players and batches\n");
+            return false;
+        }
+        if (!outputSet) {
+            options.output = string("stats.") + FormatName(options.format);
+        }
+    }
+    if (options.watchInterval != 0) {
+        if (batch || options.servePort != 0 || options.since || !options.aggregateFile.empty()) {
+            fprintf(stderr, "Error: --watch only works for a single player\n");
+            return false;
+        }
+        if (options.offline || options.output == "-") {
+            fprintf(stderr, "Error: --watch needs the network and an output file\n");
+            return false;
+        }
+    }
+
+    if (!options.aggregateFile.empty()) {
+        if (batch || options.servePort != 0 || options.since || !positional.empty()) {
+            fprintf(stderr, "Error: --aggregate only reads an export, it takes no other mode or arguments\n");
+            return false;
+        }
+        return true;
+    }
+
+    if (options.until && !options.since) {
+        fprintf(stderr, "Error: --until needs --since\n");
+        return false;
+    }
+    if (options.since) {
+        if (options.historyDir.empty()) {
+            fprintf(stderr, "Error: --since needs --history-dir\n");
+            return false;
+        }
+        if (batch || options.servePort != 0 || positional.size() != 1) {
+            fprintf(stderr, "Error: reports are made for one SteamID64 at a time\n");
+            return false;
+        }
+        if (!options.until) {
+            options.until = (int64_t) time(nullptr);
+        }
+        if (*options.until < *options.since) {
+            fprintf(stderr, "Error: --until is before --since\n");
+            return false;
+        }
+        options.steamId = positional[0];
+        return true;
+    }
+
+    if (!options.exportFile.empty() && !batch) {
+        fprintf(stderr, "Error: --export needs --batch or --queue\n");
+        return false;
+    }
+    if (!options.leaderboardFile.empty() && !batch && options.servePort == 0) {
+        fprintf(stderr, "Error: --leaderboard needs --batch, --queue or --serve\n");
+        return false;
+    }
+    if (batch && options.servePort != 0) {
+        fprintf(stderr, "Error: --batch and --serve can't be combined\n");
+        return false;
+    }
+    if (batch || options.servePort != 0) {
+        if (positional.size() > 1) {
+            fprintf(stderr, "Error: batch and service mode take only the API key as argument\n");
+            return false;
+        }
+        if (!positional.empty()) {
+            options.apiKey = positional[0];
+        }
+        return true;
+    }
+
+    if (positional.size() > 2) {
+        fprintf(stderr, "Error: too many arguments\n");
+        return false;
+    }
+    // like before, both the SteamID64 and the API key are asked for unless both were given
+    if (positional.size() == 2) {
+        options.steamId = positional[0];
+        options.apiKey = positional[1];
+    } else if (positional.size() == 1 && options.offline) {
+        // no API key needed when nothing is downloaded
+        options.steamId = positional[0];
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+#include "stats_writer.h"
+
+const std::string defaultApiBase = "https://api.steampowered.com";
+
+struct Options {
+    // single player mode
+    std::string steamId;
+    std::string apiKey;
+    std::string apiBase = defaultApiBase;
+    // "-" writes the stats to stdout
+    std::string output = "stats.md";
+    // of single player and batch output, the NDJSON of a batch goes to output as well
+    OutputFormat format = OutputFormat::Markdown;
+    // fetch again every this many seconds and update output when something changed, unless it is 0
+    unsigned watchInterval = 0;
+
+    // batch mode, reads SteamID64s from batchFile ("-" for stdin)
+    std::string batchFile;
+    std::string outDir = ".";
+    unsigned maxInFlight = 16;
+    // 0 picks the number of hardware threads
+    unsigned workers = 0;
+    // every rendered player is also appended to this columnar export, unless it is empty
+    std::string exportFile;
+    // resumable crawl: the batch's players are kept in this work queue (created from batchFile
+    // unless it exists) and only shard of shards is fetched, see CrawlQueue
+    std::string queueFile;
+    unsigned shard = 0;
+    unsigned shards = 1;
+
+    // service mode, serves /stats/<steamid64> over HTTP on this port unless it is 0
+    unsigned servePort = 0;
+    // players kept in memory by the service
+    unsigned maxPlayers = 1024;
+
+    // the class and map stats of every player a batch or the service fetched are ranked in a
+    // LeaderboardIndex that is loaded from and saved to this snapshot, unless it is empty
+    std::string leaderboardFile;
+
+    // requests per second and API key, 0 is unlimited
+    double ratePerSecond = 0;
+    // requests per API key and UTC day, nothing is sent once they are used up
+    unsigned dailyBudget = 100000;
+
+    // extra stat descriptions in the stat_names.json format, on top of the built-in table
+    std::string statNames;
+
+    // response cache, disabled unless cacheDir is set
+    std::string cacheDir;
+    unsigned cacheTtl = 300;
+    // serve only from the cache, never touch the network
+    bool offline = false;
+
+    // every fetched player's stats are appended to a snapshot log in here, unless it is empty
+    std::string historyDir;
+    // report mode, renders what changed between the snapshots taken last before these two unix times
+    std::optional<int64_t> since;
+    std::optional<int64_t> until;
+
+    // aggregate mode, summarizes every player in this export (see --export) instead of fetching
+    std::string aggregateFile;
+    // stats whose top players are listed, the class play times if empty
+    std::vector<std::string> rankStats;
+    unsigned top = 10;
+
+    Verbosity verbosity = Verbosity::Normal;
+    // Chrome trace-event file with timings of every phase, not written unless set
+    std::string profile;
+};
+
+void PrintUsage(const char *program);
+// parses "[options] [steamid64] [apikey]", prints the problem and returns false on bad input
+bool ParseOptions(int argc, char **argv, Options &options);
@@ -0,0 +1,96 @@
+#include "output_buffer.h"
+
+#include <cstring>
+
+#include "profiler.h"
+
+using namespace std;
+
+OutputBuffer::OutputBuffer(size_t capacity) : buffer(capacity), out(this) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+OutputBuffer::~OutputBuffer() {
+    Close();
+}
+
+bool OutputBuffer::Open(const string &path, bool append) {
+    Close();
+    if (path == "-") {
+        file = stdout;
+        ownsFile = false;
+    } else {
+        file = fopen(path.c_str(), append ? "ab" : "wb");
+        ownsFile = true;
+    }
+    failed = file == nullptr;
+    out.clear();
+    return !failed;
+}
+
+bool OutputBuffer::Close() {
+    if (!file) {
+        return !failed;
+    }
+    FlushBuffer();
+    if (ownsFile) {
+        failed |= fclose(file) != 0;
+    } else {
+        failed |= fflush(file) != 0;
+    }
+    file = nullptr;
+    return !failed;
+}
+
+bool OutputBuffer::WriteOut(const char *data, size_t size) {
+    if (size == 0 || !file) {
+        return !failed;
+    }
+    ProfileScope write(Phase::Write);
+    write.AddBytes(size);
+    if (fwrite(data, 1, size, file) != size) {
+        failed = true;
+    }
+    return !failed;
+}
+
+bool OutputBuffer::FlushBuffer() {
+    WriteOut(pbase(), pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return !failed;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type c) {
+    if (!FlushBuffer()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+streamsize OutputBuffer::xsputn(const char *data, streamsize size) {
+    streamsize written = 0;
+    while (written < size) {
+        streamsize space = epptr() - pptr();
+        if (space == 0) {
+            if (!FlushBuffer()) break;
+            // bigger than the whole buffer, no point copying it through
+            if (size - written >= (streamsize) buffer.size()) {
+                return WriteOut(data + written, size - written) ? size : written;
+            }
+            continue;
+        }
+        streamsize chunk = min(space, size - written);
+        memcpy(pptr(), data + written, chunk);
+        pbump((int) chunk);
+        written += chunk;
+    }
+    return written;
+}
+
+int OutputBuffer::sync() {
+    return FlushBuffer() ? 0 : -1;
+}
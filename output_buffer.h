@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// std::ostream over a fixed-size buffer that is written to a file (or stdout) in large chunks.
+// Meant to be kept around and reopened for every output file so its buffer is reused.
+class OutputBuffer : private std::streambuf {
+public:
+    static const size_t defaultCapacity = 256 * 1024;
+
+    explicit OutputBuffer(size_t capacity = defaultCapacity);
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    // "-" writes to stdout, append adds to the end of an existing file instead of replacing it
+    bool Open(const std::string &path, bool append = false);
+    // flushes and closes, returns false if anything failed to be written
+    bool Close();
+
+    std::ostream &stream() { return out; }
+    void Write(std::string_view data) { xsputn(data.data(), (std::streamsize) data.size()); }
+
+private:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+    int sync() override;
+    bool WriteOut(const char *data, size_t size);
+    bool FlushBuffer();
+
+    std::vector<char> buffer;
+    FILE *file = nullptr;
+    bool ownsFile = false;
+    bool failed = false;
+    std::ostream out;
+};
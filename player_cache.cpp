@@ -0,0 +1,67 @@
+#include "player_cache.h"
+
+using namespace std;
+
+PlayerCache::PlayerCache(size_t capacity, chrono::seconds ttl) : capacity(capacity), ttl(ttl) {}
+
+shared_ptr<const CachedPlayer> PlayerCache::Get(const string &steamId, const Loader &load) {
+    promise<shared_ptr<const CachedPlayer>> loaded;
+    {
+        unique_lock lock(cacheMutex);
+        auto it = entries.find(steamId);
+        // expired entries stay until their replacement is loaded
+        if (it != entries.end() && chrono::steady_clock::now() - it->second->second->fetchedAt < ttl) {
+            recent.splice(recent.begin(), recent, it->second);
+            stats.hits++;
+            return it->second->second;
+        }
+        stats.misses++;
+        auto pending = loading.find(steamId);
+        if (pending != loading.end()) {
+            stats.coalesced++;
+            auto result = pending->second;
+            lock.unlock();
+            return result.get();
+        }
+        loading.emplace(steamId, loaded.get_future().share());
+    }
+
+    shared_ptr<const CachedPlayer> player;
+    try {
+        player = load(steamId);
+    } catch (...) {
+        lock_guard lock(cacheMutex);
+        stats.loadFailures++;
+        loading.erase(steamId);
+        loaded.set_exception(current_exception());
+        throw;
+    }
+
+    lock_guard lock(cacheMutex);
+    Insert(steamId, player);
+    loading.erase(steamId);
+    loaded.set_value(player);
+    return player;
+}
+
+void PlayerCache::Insert(const string &steamId, shared_ptr<const CachedPlayer> player) {
+    auto it = entries.find(steamId);
+    if (it != entries.end()) {
+        it->second->second = std::move(player);
+        recent.splice(recent.begin(), recent, it->second);
+        return;
+    }
+    recent.emplace_front(steamId, std::move(player));
+    entries.emplace(steamId, recent.begin());
+    if (recent.size() > capacity) {
+        entries.erase(recent.back().first);
+        recent.pop_back();
+    }
+}
+
+PlayerCacheCounters PlayerCache::counters() const {
+    lock_guard lock(cacheMutex);
+    PlayerCacheCounters result = stats;
+    result.size = recent.size();
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "data_classes.h"
+
+// everything rendering a player needs, immutable once it is in the cache
+struct CachedPlayer {
+    PlayerStats stats;
+    std::string personaName;
+    std::chrono::steady_clock::time_point fetchedAt;
+};
+
+struct PlayerCacheCounters {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // misses that waited for a load another request had already started
+    uint64_t coalesced = 0;
+    uint64_t loadFailures = 0;
+    size_t size = 0;
+};
+
+// bounded in-memory LRU of recently requested players. A miss runs the loader once per SteamID64
+// no matter how many requests for it arrive meanwhile, they all wait for and share its result.
+class PlayerCache {
+public:
+    // throws when the player can't be loaded, the exception is rethrown to every waiting caller
+    using Loader = std::function<std::shared_ptr<const CachedPlayer>(const std::string &steamId)>;
+
+    PlayerCache(size_t capacity, std::chrono::seconds ttl);
+
+    std::shared_ptr<const CachedPlayer> Get(const std::string &steamId, const Loader &load);
+
+    PlayerCacheCounters counters() const;
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const CachedPlayer>>;
+
+    // the caller holds cacheMutex
+    void Insert(const std::string &steamId, std::shared_ptr<const CachedPlayer> player);
+
+    size_t capacity;
+    std::chrono::seconds ttl;
+    mutable std::mutex cacheMutex;
+    // most recently used first
+    std::list<Entry> recent;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const CachedPlayer>>> loading;
+    PlayerCacheCounters stats;
+};
@@ -0,0 +1,229 @@
+#include "player_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "binary_io.h"
+#include "data_classes.h"
+#include "stat_names.h"
+
+using namespace std;
+
+// the official maps a player's play time is spread over, stat_names.json only has "{Map}"
+static const array<string_view, 48> officialMaps = {
+        "arena_badlands", "arena_byre", "arena_granary", "arena_lumberyard", "arena_nucleus", "arena_offblast_final",
+        "arena_ravine", "arena_sawmill", "arena_watchtower", "arena_well", "cp_5gorge", "cp_badlands",
+        "cp_coldfront", "cp_dustbowl", "cp_egypt_final", "cp_fastlane", "cp_foundry", "cp_freight_final1",
+        "cp_gorge", "cp_gravelpit", "cp_granary", "cp_gullywash_final1", "cp_junction_final", "cp_mountainlab",
+        "cp_process_final", "cp_snakewater_final1", "cp_steel", "cp_well", "cp_yukon_final", "ctf_2fort",
+        "ctf_doublecross", "ctf_sawmill", "ctf_turbine", "ctf_well", "koth_harvest_final", "koth_lakeside_final",
+        "koth_nucleus", "koth_sawmill", "koth_viaduct", "pl_badwater", "pl_frontier_final", "pl_goldrush",
+        "pl_hoodoo_final", "pl_thundermountain", "pl_upward", "plr_hightower", "plr_pipeline", "sd_doomsday"};
+
+static const string_view extraGamemodes[] = {"arena", "cp", "ctf", "koth", "pl", "plr", "sd"};
+
+// the usual amount of a class stat per hour played, anything not listed is rarer
+static double PerHour(string_view statName) {
+    static const pair<string_view, double> rates[] = {
+            {"iDamageDealt", 6000}, {"iHealthPointsHealed", 2500}, {"iPointsScored", 40}, {"iNumberOfKills", 25},
+            {"iKillAssists", 10},   {"iPlayTime", 3600},           {"iFireDamage", 1500}};
+    for (auto [name, rate]: rates) {
+        if (statName.size() >= name.size() && statName.substr(statName.size() - name.size()) == name) {
+            return rate;
+        }
+    }
+    return 3;
+}
+
+static void AppendNumber(string &out, int64_t value) {
+    char buffer[24];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// the generated names have no control characters, quotes and backslashes are all there is to escape
+static void AppendJsonString(string &out, string_view text) {
+    out += '"';
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+PlayerGenerator::PlayerGenerator(const PlayerGeneratorSettings &settings) : settings(settings) {
+    const string_view classPrefix = "Class.";
+    for (auto &entry: embeddedStatNames) {
+        string_view name = entry.name;
+        if (name.substr(0, classPrefix.size()) == classPrefix) {
+            string_view rest = name.substr(classPrefix.size());
+            (rest.substr(0, 4) == "mvm." ? mvmStats : pvpStats).emplace_back(rest);
+        } else if (name.substr(0, 3) == "TF_") {
+            achievementStats.emplace_back(name);
+        } else if (name.find("{Map}") == string_view::npos) {
+            otherStats.emplace_back(name);
+        }
+    }
+    // like the stats the table doesn't know yet: community maps and new achievements
+    for (unsigned i = 0; i < settings.extraStats; i++) {
+        if (i % 2 == 0) {
+            extraStats.push_back(string(extraGamemodes[i / 2 % size(extraGamemodes)]) + "_community" +
+                                 to_string(i / 2) + ".accum.iPlayTime");
+        } else {
+            extraStats.push_back("TF_SYNTHETIC_" + to_string(i / 2) + "_STAT");
+        }
+    }
+}
+
+string PlayerGenerator::StatsResponse(string_view steamId) const {
+    mt19937_64 random(HashBytes(steamId) ^ (settings.seed * 0x9e3779b97f4a7c15ULL));
+    auto uniform = [&](double low, double high) { return uniform_real_distribution<double>(low, high)(random); };
+    auto chance = [&](double p) { return uniform(0, 1) < p; };
+
+    vector<pair<string, int64_t>> stats;
+    auto add = [&](string name, double value) {
+        if (value < 1) {
+            return;
+        }
+        auto scaled = (int64_t) min(value, 1e15);
+        if (settings.valueScale > 1) {
+            scaled = scaled > numeric_limits<int64_t>::max() / settings.valueScale
+                             ? numeric_limits<int64_t>::max()
+                             : scaled * settings.valueScale;
+        }
+        stats.emplace_back(std::move(name), scaled);
+    };
+
+    // most players have a few hundred hours, some a few, some many thousands
+    double hours = clamp(lognormal_distribution<double>(log(300.0), 1.2)(random), 0.5, 20000.0);
+
+    // play time goes to a few favourite classes, the rest get a little or nothing
+    array<double, tfClassNames.size()> shares{};
+    double total = 0;
+    for (double &share: shares) {
+        double weight = exponential_distribution<double>(1)(random);
+        share = weight * weight * weight;
+        total += share;
+    }
+    auto addClassStats = [&](const vector<string> &names, double classHours, size_t tfClass) {
+        for (auto &name: names) {
+            bool isMax = name.find("max.") != string::npos;
+            double rate = PerHour(name);
+            if (rate < 10 && chance(0.2)) {
+                // not every class has every stat
+                continue;
+            }
+            double value = classHours * rate * lognormal_distribution<double>(0, 0.4)(random);
+            if (name.find("iPlayTime") != string::npos) {
+                value = isMax ? min(classHours * 3600, uniform(60, 1200)) : classHours * 3600;
+            } else if (isMax) {
+                value = min(value, max(1.0, rate * uniform(0.05, 0.3)));
+            }
+            add(string(tfClassNames[tfClass]) + "." + name, value);
+        }
+    };
+    bool playsMvm = chance(0.35);
+    double mvmHours = playsMvm ? hours * uniform(0.02, 0.3) : 0;
+    for (size_t i = 0; i < shares.size(); i++) {
+        double share = shares[i] / total;
+        if (share * hours >= 0.2) {
+            addClassStats(pvpStats, share * (hours - mvmHours), i);
+        }
+        if (playsMvm && share * mvmHours >= 0.2) {
+            addClassStats(mvmStats, share * mvmHours, i);
+        }
+    }
+
+    // the longer someone has played, the more maps they have been on
+    array<size_t, officialMaps.size()> maps;
+    for (size_t i = 0; i < maps.size(); i++) {
+        maps[i] = i;
+    }
+    shuffle(maps.begin(), maps.end(), random);
+    size_t mapCount = min(maps.size(), 3 + (size_t) (hours / 25));
+    vector<double> mapShares(mapCount);
+    total = 0;
+    for (double &share: mapShares) {
+        share = exponential_distribution<double>(1)(random);
+        total += share;
+    }
+    for (size_t i = 0; i < mapCount; i++) {
+        add(string(officialMaps[maps[i]]) + ".accum.iPlayTime", mapShares[i] / total * hours * 0.8 * 3600);
+    }
+
+    double progress = min(1.0, hours / 2000);
+    for (auto &name: achievementStats) {
+        if (chance(0.2 + 0.6 * progress)) {
+            add(name, uniform(1, 50 + 5000 * progress));
+        }
+    }
+    for (auto &name: otherStats) {
+        if (chance(0.5)) {
+            add(name, uniform(1, 10 + hours * 5));
+        }
+    }
+    for (auto &name: extraStats) {
+        add(name, uniform(1, 100000));
+    }
+    shuffle(stats.begin(), stats.end(), random);
+
+    string body;
+    body.reserve(64 + stats.size() * 64);
+    body += "{\n\t\"playerstats\": {\n\t\t\"steamID\": ";
+    AppendJsonString(body, steamId);
+    body += ",\n\t\t\"gameName\": \"Team Fortress 2\",\n\t\t\"stats\": [";
+    for (size_t i = 0; i < stats.size(); i++) {
+        body += i == 0 ? "\n\t\t\t{\n\t\t\t\t\"name\": " : ",\n\t\t\t{\n\t\t\t\t\"name\": ";
+        AppendJsonString(body, stats[i].first);
+        body += ",\n\t\t\t\t\"value\": ";
+        AppendNumber(body, stats[i].second);
+        body += "\n\t\t\t}";
+    }
+    // the achievements the grind stats led to, nothing reads them but they are part of the size
+    body += "\n\t\t],\n\t\t\"achievements\": [";
+    bool first = true;
+    for (auto &[name, value]: stats) {
+        if (name.substr(0, 3) == "TF_" && value > 1000) {
+            body += first ? "\n\t\t\t{\n\t\t\t\t\"name\": " : ",\n\t\t\t{\n\t\t\t\t\"name\": ";
+            AppendJsonString(body, name);
+            body += ",\n\t\t\t\t\"achieved\": 1\n\t\t\t}";
+            first = false;
+        }
+    }
+    body += "\n\t\t]\n\t}\n}";
+    return body;
+}
+
+string PlayerGenerator::SummariesResponse(const vector<string_view> &steamIds) const {
+    static const string_view syllables[] = {"ka", "zu", "mi", "ro", "ba", "te", "ny", "lo", "ä", "x", "\"", "ö"};
+    string body = "{\n\t\"response\": {\n\t\t\"players\": [";
+    for (size_t i = 0; i < steamIds.size(); i++) {
+        string_view steamId = steamIds[i];
+        mt19937_64 random(HashBytes(steamId) ^ (settings.seed * 0x9e3779b97f4a7c15ULL) ^ 1);
+        // sometimes with quotes and umlauts, so escaping and UTF-8 get exercised
+        string name;
+        size_t length = 2 + random() % 4;
+        for (size_t j = 0; j < length; j++) {
+            name += syllables[random() % size(syllables)];
+        }
+        name += to_string(random() % 1000);
+
+        body += i == 0 ? "\n\t\t\t{\n\t\t\t\t\"steamid\": " : ",\n\t\t\t{\n\t\t\t\t\"steamid\": ";
+        AppendJsonString(body, steamId);
+        body += ",\n\t\t\t\t\"communityvisibilitystate\": 3,\n\t\t\t\t\"profilestate\": 1,\n\t\t\t\t\"personaname\": ";
+        AppendJsonString(body, name);
+        body += ",\n\t\t\t\t\"profileurl\": \"https://steamcommunity.com/profiles/";
+        body += steamId;
+        body += "/\",\n\t\t\t\t\"avatar\": \"https://avatars.example.invalid/";
+        body += steamId;
+        body += ".jpg\",\n\t\t\t\t\"personastate\": 0\n\t\t\t}";
+    }
+    body += "\n\t\t]\n\t}\n}";
+    return body;
+}
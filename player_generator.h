@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct PlayerGeneratorSettings {
+    // players differ between seeds, the same seed and SteamID64 always give the same player
+    uint64_t seed = 0;
+    // made-up map and achievement stats every player has on top of the known ones, the same
+    // names for all players
+    unsigned extraStats = 0;
+    // every value is multiplied by this
+    int64_t valueScale = 1;
+};
+
+// synthetic Steam Web API responses for load tests without an API key, see tf-steam-api-mock.
+// Players have every stat named in stat_names.json that someone with their play time would
+// have: play time spread over a few favourite classes, some MvM, a list of maps and part of the
+// achievement stats. The responses are laid out like the real API's, stats in no particular order.
+class PlayerGenerator {
+public:
+    explicit PlayerGenerator(const PlayerGeneratorSettings &settings);
+
+    // a GetUserStatsForGame response body
+    std::string StatsResponse(std::string_view steamId) const;
+    // a GetPlayerSummaries response body listing these players
+    std::string SummariesResponse(const std::vector<std::string_view> &steamIds) const;
+
+private:
+    PlayerGeneratorSettings settings;
+    // the part after "Class." of every class stat, PvP and MvM
+    std::vector<std::string> pvpStats;
+    std::vector<std::string> mvmStats;
+    // TF_..._STAT and anything else the table knows that isn't per class or map
+    std::vector<std::string> achievementStats;
+    std::vector<std::string> otherStats;
+    std::vector<std::string> extraStats;
+};
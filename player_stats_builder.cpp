@@ -0,0 +1,38 @@
+#include "player_stats_builder.h"
+
+#include "main.h"
+
+using namespace std;
+
+PlayerStatsBuilder::Scratch::Scratch(PlayerStatsBuilder &builder, pmr::memory_resource *memory)
+        : parser([&builder](string_view name, int64_t value) {
+                     StatId id;
+                     StatSection section;
+                     if (InternStat(*builder.descriptions, name, value, id, section)) {
+                         ScratchColumns &target = builder.scratch->columns[(size_t) section];
+                         InsertOrdered(target.ids, target.values, id, value);
+                     }
+                 }, memory),
+          columns{ScratchColumns(memory), ScratchColumns(memory), ScratchColumns(memory), ScratchColumns(memory)} {}
+
+PlayerStatsBuilder::PlayerStatsBuilder(size_t arenaSize)
+        : buffer(arenaSize), arena(buffer.data(), buffer.size()) {}
+
+void PlayerStatsBuilder::Reset(const StatDescriptionIndex &newDescriptions) {
+    scratch.reset();
+    // back to the start of buffer, whatever spilled to the heap is freed
+    arena.release();
+    descriptions = &newDescriptions;
+    scratch.emplace(*this, &arena);
+}
+
+PlayerStats PlayerStatsBuilder::Build() const {
+    PlayerStats stats;
+    for (StatSection section: statSections) {
+        const ScratchColumns &from = scratch->columns[(size_t) section];
+        StatColumns &to = stats.section(section);
+        to.ids.assign(from.ids.begin(), from.ids.end());
+        to.values.assign(from.values.begin(), from.values.end());
+    }
+    return stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "data_classes.h"
+#include "stats_stream_parser.h"
+
+class StatDescriptionIndex;
+
+// collects one player's stats from a GetUserStatsForGame response, fed in chunks of any size.
+// Everything that grows while the response is parsed (the parser's buffers, the half-built
+// columns) lives in an arena that is rewound for the next player, so parsing a player doesn't
+// touch the heap at all; Build then allocates each column once, at its final size. Keep one per
+// thread or transfer and Reset it before every player.
+class PlayerStatsBuilder {
+public:
+    // enough for every stat the API knows about a few times over, larger players spill to the heap
+    static const size_t defaultArenaSize = 256 * 1024;
+
+    explicit PlayerStatsBuilder(size_t arenaSize = defaultArenaSize);
+
+    PlayerStatsBuilder(const PlayerStatsBuilder &) = delete;
+    PlayerStatsBuilder &operator=(const PlayerStatsBuilder &) = delete;
+
+    // starts on a new player, nothing of the last one is kept. descriptions has to outlive the
+    // builder's use for this player.
+    void Reset(const StatDescriptionIndex &descriptions);
+
+    // like StatsStreamParser's
+    bool Feed(const char *data, size_t size) { return scratch->parser.Feed(data, size); }
+    bool Finish() { return scratch->parser.Finish(); }
+    bool failed() const { return scratch->parser.failed(); }
+    const std::string &error() const { return scratch->parser.error(); }
+    size_t bytesParsed() const { return scratch->parser.bytesParsed(); }
+
+    // the stats fed since Reset
+    PlayerStats Build() const;
+
+private:
+    struct ScratchColumns {
+        std::pmr::vector<StatId> ids;
+        std::pmr::vector<int64_t> values;
+
+        explicit ScratchColumns(std::pmr::memory_resource *memory) : ids(memory), values(memory) {}
+    };
+
+    // everything that points into the arena, dropped before it is rewound
+    struct Scratch {
+        StatsStreamParser parser;
+        std::array<ScratchColumns, std::size(statSections)> columns;
+
+        Scratch(PlayerStatsBuilder &builder, std::pmr::memory_resource *memory);
+    };
+
+    std::vector<std::byte> buffer;
+    std::pmr::monotonic_buffer_resource arena;
+    const StatDescriptionIndex *descriptions = nullptr;
+    std::optional<Scratch> scratch;
+};
@@ -0,0 +1,274 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+struct AllocationCounter {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+static thread_local AllocationCounter threadAllocations;
+
+// counting every allocation is a thread-local increment, cheap enough to leave on
+void *operator new(size_t size) {
+    threadAllocations.count++;
+    threadAllocations.bytes += size;
+    if (void *ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// over-aligned types (alignas larger than new's default) come here instead, counted the same way.
+// The nothrow and array forms of both call one of these.
+void *operator new(size_t size, align_val_t alignment) {
+    threadAllocations.count++;
+    threadAllocations.bytes += size;
+    auto align = (size_t) alignment;
+#ifdef _WIN32
+    void *ptr = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    void *ptr = aligned_alloc(align, (max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+    if (ptr) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr, align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+void operator delete(void *ptr, size_t, align_val_t alignment) noexcept {
+    operator delete(ptr, alignment);
+}
+
+uint64_t ThreadAllocations() {
+    return threadAllocations.count;
+}
+
+uint64_t ThreadAllocatedBytes() {
+    return threadAllocations.bytes;
+}
+
+static const array<const char *, (size_t) Phase::Count> phaseNames = {
+        "fetch", "dns", "connect", "tls", "wait", "download", "parse", "classify", "describe",
+        "cache load", "cache store", "render", "write"
+};
+
+struct TraceEvent {
+    Phase phase;
+    string detail;
+    int tid;
+    int64_t start;
+    int64_t duration;
+    uint64_t bytes;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+
+struct PhaseTotals {
+    atomic<uint64_t> calls{0};
+    atomic<int64_t> duration{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> allocations{0};
+    atomic<uint64_t> allocatedBytes{0};
+};
+
+// transfer tracks are numbered from here so they never collide with threads
+static const int transferTrackBase = 1000;
+
+static bool profiling = false;
+static chrono::steady_clock::time_point profileStart;
+static array<PhaseTotals, (size_t) Phase::Count> totals;
+static mutex eventsMutex;
+static vector<TraceEvent> events;
+static vector<int> transferTracks;
+static atomic<int> nextTid{1};
+
+static int64_t NowMicros() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - profileStart).count();
+}
+
+static int ThreadId() {
+    thread_local int tid = nextTid++;
+    return tid;
+}
+
+static void Record(TraceEvent event) {
+    auto &phaseTotals = totals[(size_t) event.phase];
+    phaseTotals.calls++;
+    phaseTotals.duration += event.duration;
+    phaseTotals.bytes += event.bytes;
+    phaseTotals.allocations += event.allocations;
+    phaseTotals.allocatedBytes += event.allocatedBytes;
+
+    lock_guard lock(eventsMutex);
+    events.push_back(std::move(event));
+}
+
+void EnableProfiling() {
+    profileStart = chrono::steady_clock::now();
+    profiling = true;
+}
+
+bool ProfilingEnabled() {
+    return profiling;
+}
+
+ProfileScope::ProfileScope(Phase phase, string_view detail) : phase(phase), active(profiling) {
+    if (!active) {
+        return;
+    }
+    this->detail = detail;
+    allocations = threadAllocations.count;
+    allocatedBytes = threadAllocations.bytes;
+    start = NowMicros();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active) {
+        return;
+    }
+    int64_t end = NowMicros();
+    // the scope's own bookkeeping is left out
+    uint64_t scopeAllocations = threadAllocations.count - allocations;
+    uint64_t scopeBytes = threadAllocations.bytes - allocatedBytes;
+    Record({phase, std::move(detail), ThreadId(), start, end - start, bytes, scopeAllocations, scopeBytes});
+}
+
+void ProfileTransfer(CURL *handle, int track, string_view detail) {
+    if (!profiling) {
+        return;
+    }
+    // all in microseconds since the transfer started
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, firstByte = 0, total = 0, size = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &firstByte);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &size);
+
+    int tid = transferTrackBase + track;
+    {
+        lock_guard lock(eventsMutex);
+        if (find(transferTracks.begin(), transferTracks.end(), tid) == transferTracks.end()) {
+            transferTracks.push_back(tid);
+        }
+    }
+
+    int64_t start = NowMicros() - total;
+    auto record = [&](Phase phase, curl_off_t from, curl_off_t to, uint64_t bytes) {
+        // reused connections skip DNS, connect and TLS, curl reports those as 0
+        if (to > from) {
+            Record({phase, string(detail), tid, start + from, to - from, bytes, 0, 0});
+        }
+    };
+    record(Phase::Dns, 0, dns, 0);
+    record(Phase::Connect, dns, connect, 0);
+    record(Phase::Tls, connect, tls, 0);
+    record(Phase::Wait, max(pretransfer, tls), firstByte, 0);
+    record(Phase::Download, firstByte, total, size);
+}
+
+static void WriteJsonString(FILE *file, string_view str) {
+    fputc('"', file);
+    for (unsigned char c: str) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool WriteProfile(const string &path) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Error: could not open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    lock_guard lock(eventsMutex);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (int tid: transferTracks) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"transfer %d\"}}",
+                first ? "" : ",\n", tid, tid - transferTrackBase);
+        first = false;
+    }
+    for (auto &event: events) {
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,"
+                      "\"args\":{",
+                first ? "" : ",\n", phaseNames[(size_t) event.phase], event.tid, (long long) event.start,
+                (long long) event.duration);
+        if (!event.detail.empty()) {
+            fprintf(file, "\"detail\":");
+            WriteJsonString(file, event.detail);
+            fprintf(file, ",");
+        }
+        fprintf(file, "\"bytes\":%llu,\"allocations\":%llu,\"allocatedBytes\":%llu}}",
+                (unsigned long long) event.bytes, (unsigned long long) event.allocations,
+                (unsigned long long) event.allocatedBytes);
+        first = false;
+    }
+
+    fprintf(file, "\n],\"phases\":{");
+    first = true;
+    for (size_t i = 0; i < totals.size(); i++) {
+        auto &phaseTotals = totals[i];
+        if (phaseTotals.calls == 0) {
+            continue;
+        }
+        fprintf(file, "%s\n\"%s\":{\"calls\":%llu,\"totalUs\":%lld,\"bytes\":%llu,\"allocations\":%llu,"
+                      "\"allocatedBytes\":%llu}",
+                first ? "" : ",", phaseNames[i], (unsigned long long) phaseTotals.calls.load(),
+                (long long) phaseTotals.duration.load(), (unsigned long long) phaseTotals.bytes.load(),
+                (unsigned long long) phaseTotals.allocations.load(),
+                (unsigned long long) phaseTotals.allocatedBytes.load());
+        first = false;
+    }
+    fprintf(file, "\n}}\n");
+
+    bool ok = !ferror(file);
+    ok &= fclose(file) == 0;
+    if (!ok) {
+        fprintf(stderr, "Error: could not write %s\n", path.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <curl/curl.h>
+
+// phases of a run, scopes of one phase may nest inside another (classification happens while
+// parsing, which happens while fetching)
+enum class Phase {
+    // one request for a player's stats or name, from the API or the cache
+    Fetch = 0,
+    // from curl's timings of a finished transfer
+    Dns,
+    Connect,
+    Tls,
+    Wait,
+    Download,
+    // JSON, stats are parsed while they are downloaded
+    Parse,
+    // only the first time a stat name is seen, the StatCatalog remembers both afterwards
+    Classify,
+    Describe,
+    CacheLoad,
+    CacheStore,
+    Render,
+    Write,
+    Count
+};
+
+// has to be called before any other thread starts, profiling stays off otherwise
+void EnableProfiling();
+bool ProfilingEnabled();
+// Chrome trace-event JSON (chrome://tracing, Perfetto) with a per-phase summary in "phases"
+bool WriteProfile(const std::string &path);
+
+// heap allocations made by the calling thread so far, counted whether profiling is on or not
+uint64_t ThreadAllocations();
+uint64_t ThreadAllocatedBytes();
+
+// times a phase and counts the allocations the thread made during it, does nothing unless
+// profiling is enabled
+class ProfileScope {
+public:
+    explicit ProfileScope(Phase phase, std::string_view detail = {});
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    void AddBytes(uint64_t count) { bytes += count; }
+
+private:
+    Phase phase;
+    bool active;
+    std::string detail;
+    int64_t start = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t bytes = 0;
+};
+
+// records the DNS/connect/TLS/wait/download split of a transfer that just finished, track keeps
+// concurrent transfers on separate rows of the trace
+void ProfileTransfer(CURL *handle, int track, std::string_view detail = {});
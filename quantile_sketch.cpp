@@ -0,0 +1,124 @@
+#include "quantile_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// magnitudes below this count as zero, stats are whole numbers so nothing real gets lost
+static const double zeroThreshold = 1e-9;
+
+QuantileSketch::QuantileSketch(double relativeAccuracy)
+        : gamma((1 + relativeAccuracy) / (1 - relativeAccuracy)), logGamma(log(gamma)) {}
+
+int32_t QuantileSketch::Key(double magnitude) const {
+    return (int32_t) ceil(log(magnitude) / logGamma);
+}
+
+// the point of bucket key's range (gamma^(key-1), gamma^key] that is relatively closest to both ends
+double QuantileSketch::Value(int32_t key) const {
+    return 2 * exp(key * logGamma) / (gamma + 1);
+}
+
+void QuantileSketch::Buckets::Add(int32_t key, uint64_t count) {
+    if (counts.empty()) {
+        offset = key;
+        counts.assign(1, count);
+        return;
+    }
+    int32_t last = offset + (int32_t) counts.size() - 1;
+    if (key < offset) {
+        // folded into the lowest bucket that still fits
+        key = std::max(key, last - (int32_t) maxBuckets + 1);
+        if (key < offset) {
+            counts.insert(counts.begin(), (size_t) (offset - key), 0);
+            offset = key;
+        }
+    } else if (key > last) {
+        counts.resize((size_t) (key - offset) + 1, 0);
+        if (counts.size() > maxBuckets) {
+            size_t excess = counts.size() - maxBuckets;
+            uint64_t folded = 0;
+            for (size_t i = 0; i < excess; i++) {
+                folded += counts[i];
+            }
+            counts.erase(counts.begin(), counts.begin() + (ptrdiff_t) excess);
+            counts[0] += folded;
+            offset += (int32_t) excess;
+        }
+    }
+    counts[(size_t) (key - offset)] += count;
+}
+
+void QuantileSketch::Add(double value) {
+    if (total == 0) {
+        minValue = maxValue = value;
+    } else {
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+    total++;
+    if (value > zeroThreshold) {
+        positive.Add(Key(value), 1);
+    } else if (value < -zeroThreshold) {
+        negative.Add(Key(-value), 1);
+    } else {
+        zeros++;
+    }
+}
+
+void QuantileSketch::Merge(const QuantileSketch &other) {
+    if (other.total == 0) {
+        return;
+    }
+    if (total == 0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    } else {
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+    total += other.total;
+    zeros += other.zeros;
+    for (auto [from, into]: {pair{&other.positive, &positive}, pair{&other.negative, &negative}}) {
+        // lowest key first, so the range grows downwards at most once
+        for (size_t i = 0; i < from->counts.size(); i++) {
+            if (from->counts[i] != 0) {
+                into->Add(from->offset + (int32_t) i, from->counts[i]);
+            }
+        }
+    }
+}
+
+double QuantileSketch::Quantile(double q) const {
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = (uint64_t) (clamp(q, 0.0, 1.0) * (double) (total - 1));
+    uint64_t seen = 0;
+    double result = maxValue;
+    bool found = false;
+    // ascending by value: negatives from the largest magnitude down, zeros, then positives
+    for (size_t i = negative.counts.size(); i-- > 0 && !found;) {
+        seen += negative.counts[i];
+        if (seen > rank) {
+            result = -Value(negative.offset + (int32_t) i);
+            found = true;
+        }
+    }
+    if (!found) {
+        seen += zeros;
+        if (seen > rank) {
+            result = 0;
+            found = true;
+        }
+    }
+    for (size_t i = 0; i < positive.counts.size() && !found; i++) {
+        seen += positive.counts[i];
+        if (seen > rank) {
+            result = Value(positive.offset + (int32_t) i);
+            found = true;
+        }
+    }
+    return clamp(result, minValue, maxValue);
+}
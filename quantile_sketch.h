@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// approximate quantiles with a relative error bound, in the manner of DDSketch: values are counted
+// in logarithmically sized buckets, so every quantile is within relativeAccuracy of the true value.
+// Two sketches with the same accuracy merge by adding their buckets, which is what lets each thread
+// (or shard) keep its own and combine them at the end.
+class QuantileSketch {
+public:
+    static constexpr double defaultRelativeAccuracy = 0.01;
+    // buckets kept per sign, beyond that the smallest ones are folded together. At 1% that still
+    // covers values across 17 orders of magnitude at full accuracy
+    static const size_t maxBuckets = 2048;
+
+    explicit QuantileSketch(double relativeAccuracy = defaultRelativeAccuracy);
+
+    void Add(double value);
+    void Merge(const QuantileSketch &other);
+
+    // q in [0, 1], 0 when empty
+    double Quantile(double q) const;
+
+    uint64_t count() const { return total; }
+    double min() const { return minValue; }
+    double max() const { return maxValue; }
+
+private:
+    // counts of consecutive bucket keys starting at offset
+    struct Buckets {
+        int32_t offset = 0;
+        std::vector<uint64_t> counts;
+
+        void Add(int32_t key, uint64_t count);
+    };
+
+    int32_t Key(double magnitude) const;
+    double Value(int32_t key) const;
+
+    double gamma;
+    double logGamma;
+    Buckets positive;
+    // keyed by magnitude
+    Buckets negative;
+    uint64_t zeros = 0;
+    uint64_t total = 0;
+    double minValue = 0;
+    double maxValue = 0;
+};
@@ -0,0 +1,89 @@
+#include "report.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "data_classes.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "snapshot_log.h"
+#include "stat_format.h"
+#include "stats_renderer.h"
+
+using namespace std;
+
+// to - from for every stat that differs, both are sorted by id
+static StatColumns Difference(const StatColumns &from, const StatColumns &to) {
+    StatColumns changes;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < from.size() || j < to.size()) {
+        if (j == to.size() || (i < from.size() && from.ids[i] < to.ids[j])) {
+            changes.Add(from.ids[i], -from.values[i]);
+            i++;
+        } else if (i == from.size() || to.ids[j] < from.ids[i]) {
+            changes.Add(to.ids[j], to.values[j]);
+            j++;
+        } else {
+            if (to.values[j] != from.values[i]) {
+                changes.Add(to.ids[j], to.values[j] - from.values[i]);
+            }
+            i++;
+            j++;
+        }
+    }
+    return changes;
+}
+
+static string FormatTime(int64_t time) {
+    time_t seconds = (time_t) time;
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M UTC", gmtime(&seconds));
+    return text;
+}
+
+int RunChangesReport(const Options &options, const StatDescriptionIndex &descriptions) {
+    SnapshotLog log(filesystem::path(options.historyDir) / options.steamId);
+    if (!log.Open()) {
+        return EXIT_FAILURE;
+    }
+    optional<size_t> last = log.Before(*options.until);
+    if (!last) {
+        fprintf(stderr, "Error: there is no snapshot of %s from before %s\n", options.steamId.c_str(),
+                FormatTime(*options.until).c_str());
+        return EXIT_FAILURE;
+    }
+    // without an older snapshot the changes are counted from the first one
+    size_t first = log.Before(*options.since).value_or(0);
+
+    Snapshot from;
+    Snapshot to;
+    if (!log.Read(first, descriptions, from) || !log.Read(*last, descriptions, to)) {
+        fprintf(stderr, "Error: the snapshots of %s are damaged\n", options.steamId.c_str());
+        return EXIT_FAILURE;
+    }
+    PlayerStats changes;
+    changes.pvpStats = Difference(from.stats.pvpStats, to.stats.pvpStats);
+    changes.mvmStats = Difference(from.stats.mvmStats, to.stats.mvmStats);
+    changes.mapStats = Difference(from.stats.mapStats, to.stats.mapStats);
+    changes.achievementStats = Difference(from.stats.achievementStats, to.stats.achievementStats);
+
+    StatsRenderer renderer;
+    OutputBuffer output;
+    if (!output.Open(options.output)) {
+        fprintf(stderr, "Error: could not open %s for writing\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    string period = "From " + FormatTime(from.time) + " to " + FormatTime(to.time) + " (" +
+                    FormatToString(FormatHumanDuration, dseconds(to.time - from.time)) + ")";
+    renderer.RenderChanges(changes, options.steamId, period, output.stream());
+    if (!output.Close()) {
+        fprintf(stderr, "Error: could not write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
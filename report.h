@@ -0,0 +1,9 @@
+#pragma once
+
+struct Options;
+class StatDescriptionIndex;
+
+// --since: renders the stats of options.steamId that changed between the snapshots in
+// options.historyDir taken last before options.since and options.until to options.output.
+// Returns the process exit code.
+int RunChangesReport(const Options &options, const StatDescriptionIndex &descriptions);
@@ -0,0 +1,295 @@
+#include "request_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "logging.h"
+
+using namespace std;
+
+// queued requests that aren't first in line wake up at least this often to look again
+static const chrono::seconds queuePollInterval(1);
+
+// the key= parameter of a Steam Web API url, requests without one share a budget
+static string ApiKeyOf(const string &url) {
+    for (const char *param: {"?key=", "&key="}) {
+        size_t start = url.find(param);
+        if (start != string::npos) {
+            start += strlen(param);
+            return url.substr(start, url.find('&', start) - start);
+        }
+    }
+    return "";
+}
+
+static int64_t UtcDay(SchedulerClock::time_point time) {
+    auto seconds = chrono::duration_cast<chrono::seconds>(time.time_since_epoch()).count();
+    return seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+}
+
+// transfers that failed on the way, as opposed to ones that can't work (bad url, aborted by the
+// body sink, TLS problems)
+static bool IsTransientError(CURLcode code) {
+    switch (code) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+RequestScheduler &RequestScheduler::Get() {
+    static SystemClock systemClock;
+    static RequestScheduler scheduler(systemClock);
+    return scheduler;
+}
+
+RequestScheduler::RequestScheduler(SchedulerClock &clock, uint64_t seed) : clock(clock), random(seed) {}
+
+void RequestScheduler::Configure(const RateLimits &newLimits) {
+    lock_guard lock(mutex);
+    limits = newLimits;
+    budgets.clear();
+}
+
+RequestScheduler::Budget &RequestScheduler::BudgetFor(const string &url) {
+    return budgets[ApiKeyOf(url)];
+}
+
+bool RequestScheduler::OverBudget(Budget &budget, SchedulerClock::time_point now) {
+    int64_t day = UtcDay(now);
+    if (day != budget.day) {
+        budget.day = day;
+        budget.usedToday = 0;
+    }
+    return limits.perDay != 0 && budget.usedToday >= limits.perDay;
+}
+
+optional<SchedulerClock::time_point> RequestScheduler::Take(Budget &budget, SchedulerClock::time_point now) {
+    if (now < budget.pausedUntil) {
+        return budget.pausedUntil;
+    }
+    if (limits.perSecond > 0) {
+        double capacity = max(1.0, limits.perSecond);
+        if (budget.tokens < 0) {
+            budget.tokens = capacity;
+        } else {
+            double elapsed = chrono::duration<double>(now - budget.refilled).count();
+            budget.tokens = min(capacity, budget.tokens + max(0.0, elapsed) * limits.perSecond);
+        }
+        budget.refilled = now;
+        if (budget.tokens < 1) {
+            auto missing = chrono::duration<double>((1 - budget.tokens) / limits.perSecond);
+            return now + chrono::ceil<chrono::microseconds>(missing);
+        }
+        budget.tokens -= 1;
+    }
+    budget.usedToday++;
+    counters.sent++;
+    return nullopt;
+}
+
+// exponential, with a random half on top of the other half so retries of requests that failed
+// together spread out but still wait a while
+chrono::milliseconds RequestScheduler::Backoff(unsigned attempt) {
+    int64_t base = limits.backoffBase.count();
+    int64_t cap = limits.backoffCap.count();
+    int64_t ceiling = attempt >= 32 ? cap : min(cap, base << attempt);
+    uniform_int_distribution<int64_t> jitter(0, ceiling / 2);
+    return chrono::milliseconds(ceiling - ceiling / 2 + jitter(random));
+}
+
+optional<chrono::milliseconds> RequestScheduler::RetryDelay(const string &url, const HttpResult &result,
+                                                             unsigned attempt) {
+    bool throttled = result.status == 429;
+    counters.throttled += throttled;
+    // a body cut off after its status line has the status, but is as transient as no answer at all
+    bool retryable = throttled || result.status >= 500 || (result.status < 400 && IsTransientError(result.code));
+    if (result.ok() || !retryable || attempt >= limits.maxRetries) {
+        return nullopt;
+    }
+    counters.retried++;
+    chrono::milliseconds delay = max<chrono::milliseconds>(Backoff(attempt), result.retryAfter);
+    if (throttled) {
+        // Steam throttles the key, not the request
+        Budget &budget = BudgetFor(url);
+        budget.pausedUntil = max(budget.pausedUntil, clock.now() + delay);
+        changed.notify_all();
+    }
+    return delay;
+}
+
+optional<chrono::milliseconds> RequestScheduler::RetryAfter(const string &url, const HttpResult &result,
+                                                             unsigned attempt) {
+    lock_guard lock(mutex);
+    return RetryDelay(url, result, attempt);
+}
+
+optional<chrono::milliseconds> RequestScheduler::TryAcquire(const string &url, RequestPriority priority) {
+    lock_guard lock(mutex);
+    auto now = clock.now();
+    Budget &budget = BudgetFor(url);
+    if (OverBudget(budget, now)) {
+        counters.overBudget++;
+        return nullopt;
+    }
+    if (!queue.empty() && queue.begin()->first <= (int) priority) {
+        // the queued request will be woken and take the token, look again after its turn
+        return chrono::milliseconds(limits.perSecond > 0 ? (int64_t) ceil(1000 / limits.perSecond) : 1);
+    }
+    auto next = Take(budget, now);
+    if (!next) {
+        return chrono::milliseconds(0);
+    }
+    return max(chrono::milliseconds(1), chrono::ceil<chrono::milliseconds>(*next - now));
+}
+
+void RequestScheduler::RecordWait(SchedulerClock::duration waited) {
+    double seconds = max(0.0, chrono::duration<double>(waited).count());
+    counters.waits++;
+    counters.waitSeconds += seconds;
+    counters.maxWaitSeconds = max(counters.maxWaitSeconds, seconds);
+}
+
+// requests that would get different answers, e.g. one with If-None-Match and one without, don't
+// share a response
+static string RequestKey(const string &url, const curl_slist *headers) {
+    string key = url;
+    for (const curl_slist *header = headers; header; header = header->next) {
+        key += '\n';
+        key += header->data;
+    }
+    return key;
+}
+
+ScheduledResponse RequestScheduler::Shared::ResponseFor(size_t index) const {
+    ScheduledResponse result = response;
+    if (receivers[index].gaveUp && result.ok()) {
+        // the transfer went on for the others, to this caller it was aborted like its own would be
+        result.result.code = CURLE_WRITE_ERROR;
+    }
+    return result;
+}
+
+ScheduledResponse RequestScheduler::Fetch(const string &url, const curl_slist *headers, const ResponseSink &sink,
+                                          RequestPriority priority, string_view detail) {
+    string key = RequestKey(url, headers);
+    unique_lock lock(mutex);
+    auto existing = requests.find(key);
+    if (existing != requests.end() && !existing->second->sent) {
+        // nothing of the body has arrived yet, so this caller doesn't miss any of it
+        shared_ptr<Shared> shared = existing->second;
+        counters.deduplicated++;
+        size_t index = shared->receivers.size();
+        shared->receivers.push_back({&sink});
+        changed.wait(lock, [&] { return shared->done; });
+        return shared->ResponseFor(index);
+    }
+    auto shared = make_shared<Shared>();
+    shared->receivers.push_back({&sink});
+    // one that was sent already stays with the callers it has
+    requests[key] = shared;
+
+    // the body goes to every caller that still wants it, the transfer is aborted once none does
+    HttpClient::BodySink write = [&](const char *data, size_t size) {
+        bool wanted = false;
+        for (auto &receiver: shared->receivers) {
+            if (!receiver.gaveUp) {
+                receiver.gaveUp = !receiver.sink->write(data, size);
+                wanted = wanted || !receiver.gaveUp;
+            }
+        }
+        return wanted;
+    };
+
+    ScheduledResponse &response = shared->response;
+    auto queuedAt = clock.now();
+    for (unsigned attempt = 0;; attempt++) {
+        // stays valid, nothing is ever removed from budgets while requests are queued
+        Budget &budget = BudgetFor(url);
+        Ticket ticket{(int) priority, nextTicket++};
+        queue.insert(ticket);
+        changed.notify_all();
+        while (true) {
+            auto now = clock.now();
+            if (*queue.begin() != ticket) {
+                clock.WaitUntil(changed, lock, now + queuePollInterval);
+                continue;
+            }
+            if (OverBudget(budget, now)) {
+                counters.overBudget++;
+                response.overBudget = true;
+                break;
+            }
+            auto next = Take(budget, now);
+            if (!next) {
+                break;
+            }
+            clock.WaitUntil(changed, lock, *next);
+        }
+        queue.erase(ticket);
+        changed.notify_all();
+        RecordWait(clock.now() - queuedAt);
+        if (response.overBudget) {
+            break;
+        }
+
+        shared->sent = true;
+        lock.unlock();
+        response.result = HttpClient::Get().Fetch(url, headers, write, detail);
+        lock.lock();
+
+        auto delay = RetryDelay(url, response.result, attempt);
+        if (!delay) {
+            break;
+        }
+        const HttpResult &failed = response.result;
+        string reason = failed.status >= 400 ? "HTTP " + to_string(failed.status) : curl_easy_strerror(failed.code);
+        Log(Verbosity::Normal, "Request for %.*s failed (%s), retrying in %.1fs\n", (int) detail.size(),
+            detail.data(), reason.c_str(), delay->count() / 1000.0);
+        for (auto &receiver: shared->receivers) {
+            receiver.gaveUp = false;
+            if (receiver.sink->restart) {
+                receiver.sink->restart();
+            }
+        }
+        queuedAt = clock.now();
+        auto retryAt = queuedAt + *delay;
+        while (clock.now() < retryAt) {
+            clock.WaitUntil(changed, lock, retryAt);
+        }
+    }
+
+    shared->done = true;
+    existing = requests.find(key);
+    if (existing != requests.end() && existing->second == shared) {
+        requests.erase(existing);
+    }
+    changed.notify_all();
+    return shared->ResponseFor(0);
+}
+
+SchedulerMetrics RequestScheduler::metrics() const {
+    lock_guard lock(mutex);
+    SchedulerMetrics result = counters;
+    for (auto &ticket: queue) {
+        result.queued[ticket.first]++;
+    }
+    int64_t today = UtcDay(clock.now());
+    result.usedToday = 0;
+    for (auto &[key, budget]: budgets) {
+        if (budget.day == today) {
+            result.usedToday += budget.usedToday;
+        }
+    }
+    result.dailyBudget = limits.perDay * max<size_t>(1, budgets.size());
+    return result;
+}
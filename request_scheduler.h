@@ -0,0 +1,208 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "http_client.h"
+
+// what the scheduler waits on. The daily budget resets at midnight UTC, so this is wall-clock time.
+class SchedulerClock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+    using duration = std::chrono::system_clock::duration;
+
+    virtual ~SchedulerClock() = default;
+    virtual time_point now() const = 0;
+    // returns by deadline at the latest, or earlier when cv is notified
+    virtual void WaitUntil(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, time_point deadline) = 0;
+};
+
+class SystemClock : public SchedulerClock {
+public:
+    time_point now() const override { return std::chrono::system_clock::now(); }
+    void WaitUntil(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, time_point deadline) override {
+        cv.wait_until(lock, deadline);
+    }
+};
+
+// time only moves when Advance is called, so every decision the scheduler makes (which request
+// goes next, how long a backoff lasts, when the daily budget resets) can be replayed exactly
+class ManualClock : public SchedulerClock {
+public:
+    explicit ManualClock(time_point start = time_point()) : current(start) {}
+
+    time_point now() const override {
+        std::lock_guard lock(mutex);
+        return current;
+    }
+    void WaitUntil(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, time_point deadline) override {
+        // a short real wait, the caller checks the time again and waits once more if it has to
+        if (now() < deadline) {
+            cv.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+    void Advance(std::chrono::system_clock::duration by) {
+        std::lock_guard lock(mutex);
+        current += by;
+    }
+
+private:
+    mutable std::mutex mutex;
+    time_point current;
+};
+
+enum class RequestPriority {
+    // someone is waiting for the answer: single player mode, service requests
+    Interactive = 0,
+    // batches and refreshes, they go when no interactive request is waiting
+    Background = 1
+};
+
+struct RateLimits {
+    // requests per second and API key, bursts of up to this many go out at once. 0 is unlimited
+    double perSecond = 0;
+    // requests per API key and UTC day, Steam's documented limit by default
+    uint64_t perDay = 100000;
+    // attempts after the first for 429s, 5xx responses and failed transfers
+    unsigned maxRetries = 5;
+    // the nth retry waits a random time between half and all of min(backoffBase * 2^n, backoffCap)
+    std::chrono::milliseconds backoffBase{500};
+    std::chrono::milliseconds backoffCap{30000};
+};
+
+struct SchedulerMetrics {
+    // requests waiting for their turn right now, by RequestPriority
+    size_t queued[2] = {0, 0};
+    uint64_t sent = 0;
+    uint64_t retried = 0;
+    // 429 responses
+    uint64_t throttled = 0;
+    // callers that were handed the response of an identical request that was still queued
+    uint64_t deduplicated = 0;
+    // requests refused because the daily budget was spent
+    uint64_t overBudget = 0;
+    // time requests spent queued, backoffs included
+    uint64_t waits = 0;
+    double waitSeconds = 0;
+    double maxWaitSeconds = 0;
+    // summed over API keys, for the current UTC day
+    uint64_t usedToday = 0;
+    uint64_t dailyBudget = 0;
+};
+
+// where the body of a scheduled request goes, as it arrives. write returning false gives up on
+// the rest of it. restart is called before a failed request is sent again, whatever write got of
+// the failed attempt is to be dropped; it may be empty when nothing has to be dropped.
+struct ResponseSink {
+    HttpClient::BodySink write;
+    std::function<void()> restart;
+};
+
+struct ScheduledResponse {
+    HttpResult result;
+    // the daily budget was spent, nothing was sent
+    bool overBudget = false;
+
+    bool ok() const { return !overBudget && result.ok(); }
+};
+
+// sits in front of every call to the Steam Web API: a token bucket per API key (a per-second rate
+// and a daily budget), a priority queue so interactive lookups overtake background work, retries
+// with exponential backoff and jitter, and deduplication of identical requests. Like
+// HttpClient there is one per process, tests can make their own with a ManualClock.
+class RequestScheduler {
+public:
+    static RequestScheduler &Get();
+
+    explicit RequestScheduler(SchedulerClock &clock, uint64_t seed = std::random_device{}());
+
+    RequestScheduler(const RequestScheduler &) = delete;
+    RequestScheduler &operator=(const RequestScheduler &) = delete;
+
+    void Configure(const RateLimits &limits);
+
+    // fetches url through HttpClient once its turn has come, the body streams into sink. A caller
+    // asking for the same url with the same headers (conditional ones included) while such a
+    // request is still queued doesn't send its own: its sink is fed the same body, on the thread
+    // that sends the request, and it gets the same result. headers may be null.
+    ScheduledResponse Fetch(const std::string &url, const curl_slist *headers, const ResponseSink &sink,
+                            RequestPriority priority, std::string_view detail = {});
+
+    // for callers that drive their own transfers (batch mode's multi handle): takes a token for
+    // url's API key if one is free and no request of the same or a higher priority is queued.
+    // Returns 0 if the request may go now, otherwise how long to wait before asking again, nullopt
+    // once the daily budget is spent.
+    std::optional<std::chrono::milliseconds> TryAcquire(const std::string &url, RequestPriority priority);
+    // whether a response should be retried, after how long (Retry-After is honoured), and for a
+    // 429 keeps every request with the same API key back for that long too. attempt counts from 0.
+    std::optional<std::chrono::milliseconds> RetryAfter(const std::string &url, const HttpResult &result,
+                                                        unsigned attempt);
+
+    SchedulerMetrics metrics() const;
+
+private:
+    struct Budget {
+        // starts out full
+        double tokens = -1;
+        SchedulerClock::time_point refilled{};
+        int64_t day = -1;
+        uint64_t usedToday = 0;
+        // set by 429s, nothing with this API key goes out before
+        SchedulerClock::time_point pausedUntil{};
+    };
+
+    // (priority, arrival), the smallest goes first
+    using Ticket = std::pair<int, uint64_t>;
+
+    struct Receiver {
+        const ResponseSink *sink;
+        // its write returned false, it isn't fed the rest of this attempt
+        bool gaveUp = false;
+    };
+
+    // one request and every caller waiting for it, the first one sends it
+    struct Shared {
+        // only added to while queued, so the sending thread can feed them without the lock
+        std::vector<Receiver> receivers;
+        bool sent = false;
+        bool done = false;
+        ScheduledResponse response;
+
+        // the response as receiver index sees it
+        ScheduledResponse ResponseFor(size_t index) const;
+    };
+
+    Budget &BudgetFor(const std::string &url);
+    // takes a token if one is available at now, otherwise returns when the next one will be
+    std::optional<SchedulerClock::time_point> Take(Budget &budget, SchedulerClock::time_point now);
+    bool OverBudget(Budget &budget, SchedulerClock::time_point now);
+    std::chrono::milliseconds Backoff(unsigned attempt);
+    std::optional<std::chrono::milliseconds> RetryDelay(const std::string &url, const HttpResult &result,
+                                                        unsigned attempt);
+    void RecordWait(SchedulerClock::duration waited);
+
+    SchedulerClock &clock;
+    RateLimits limits;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::mt19937_64 random;
+    std::unordered_map<std::string, Budget> budgets;
+    std::set<Ticket> queue;
+    uint64_t nextTicket = 0;
+    // by url and headers, until the request is done
+    std::unordered_map<std::string, std::shared_ptr<Shared>> requests;
+    SchedulerMetrics counters;
+};
@@ -0,0 +1,169 @@
+#include "response_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "binary_io.h"
+#include "profiler.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static int64_t UnixNow() {
+    return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// two differently seeded FNV-1a hashes, 128 bits is plenty to address a few million objects
+static string HashHex(string_view data) {
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long) HashBytes(data),
+             (unsigned long long) HashBytes(data, 0x84222325cbf29ce4ULL));
+    return hex;
+}
+
+static bool ReadFile(const fs::path &path, string &contents) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return false;
+    }
+    stringstream buf;
+    buf << in.rdbuf();
+    contents = buf.str();
+    return true;
+}
+
+// write to a uniquely named temporary file first so readers (and other writers of the same
+// object) never see a half-written file
+static bool WriteFileAtomically(const fs::path &path, string_view contents) {
+    fs::path temp = path;
+    temp += ".tmp" + to_string(random_device{}());
+    error_code ec;
+    {
+        // a short write, e.g. on a full disk, may only show when the buffer is flushed or closed
+        ofstream out(temp, ios::binary | ios::trunc);
+        out.write(contents.data(), (streamsize) contents.size());
+        out.flush();
+        out.close();
+        if (!out) {
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+ResponseCache::ResponseCache(fs::path directory, chrono::seconds ttl, bool offline)
+        : directory(std::move(directory)), ttl(ttl), isOffline(offline) {
+    error_code ec;
+    fs::create_directories(this->directory / "entries", ec);
+    fs::create_directories(this->directory / "objects", ec);
+}
+
+fs::path ResponseCache::EntryPath(string_view endpoint, string_view steamId) const {
+    string key(endpoint);
+    key += '/';
+    key += steamId;
+    return directory / "entries" / HashHex(key);
+}
+
+fs::path ResponseCache::ObjectPath(string_view payload) const {
+    return directory / "objects" / HashHex(payload);
+}
+
+optional<CacheEntry> ResponseCache::Load(string_view endpoint, string_view steamId) const {
+    ProfileScope load(Phase::CacheLoad, steamId);
+    string contents;
+    if (!ReadFile(EntryPath(endpoint, steamId), contents)) {
+        return nullopt;
+    }
+
+    CacheEntry entry;
+    ByteReader reader(contents);
+    uint64_t fetchedAt;
+    string objectHash;
+    if (!reader.U64(fetchedAt) || !reader.String(entry.etag) || !reader.String(entry.lastModified) ||
+        !reader.String(objectHash)) {
+        return nullopt;
+    }
+    entry.fetchedAt = (int64_t) fetchedAt;
+
+    // a missing or damaged object is just a miss
+    if (!ReadFile(directory / "objects" / objectHash, entry.payload) || HashHex(entry.payload) != objectHash) {
+        return nullopt;
+    }
+    load.AddBytes(contents.size() + entry.payload.size());
+    return entry;
+}
+
+bool ResponseCache::IsFresh(const CacheEntry &entry) const {
+    return isOffline || UnixNow() - entry.fetchedAt < ttl.count();
+}
+
+bool ResponseCache::Store(string_view endpoint, string_view steamId, CacheEntry &entry) const {
+    ProfileScope store(Phase::CacheStore, steamId);
+    store.AddBytes(entry.payload.size());
+    entry.fetchedAt = UnixNow();
+
+    fs::path object = ObjectPath(entry.payload);
+    if (!fs::exists(object) && !WriteFileAtomically(object, entry.payload)) {
+        return false;
+    }
+
+    string contents;
+    ByteWriter writer(contents);
+    writer.U64((uint64_t) entry.fetchedAt);
+    writer.String(entry.etag);
+    writer.String(entry.lastModified);
+    writer.String(object.filename().string());
+    return WriteFileAtomically(EntryPath(endpoint, steamId), contents);
+}
+
+static bool HeaderIs(string_view line, string_view name) {
+    if (line.size() <= name.size() || line[name.size()] != ':') {
+        return false;
+    }
+    for (size_t i = 0; i < name.size(); i++) {
+        if (tolower((unsigned char) line[i]) != tolower((unsigned char) name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static string HeaderValue(string_view line, size_t nameLength) {
+    string_view value = line.substr(nameLength + 1);
+    auto begin = value.find_first_not_of(" \t");
+    auto end = value.find_last_not_of(" \t\r\n");
+    return begin == string_view::npos ? "" : string(value.substr(begin, end - begin + 1));
+}
+
+size_t CaptureValidators(char *buffer, size_t size, size_t nitems, void *userp) {
+    size_t real_size = size * nitems;
+    auto validators = static_cast<HttpValidators *>(userp);
+    string_view line(buffer, real_size);
+
+    if (HeaderIs(line, "ETag")) {
+        validators->etag = HeaderValue(line, 4);
+    } else if (HeaderIs(line, "Last-Modified")) {
+        validators->lastModified = HeaderValue(line, 13);
+    }
+    return real_size;
+}
+
+curl_slist *ConditionalRequestHeaders(const CacheEntry &entry) {
+    curl_slist *headers = nullptr;
+    if (!entry.etag.empty()) {
+        headers = curl_slist_append(headers, ("If-None-Match: " + entry.etag).c_str());
+    }
+    if (!entry.lastModified.empty()) {
+        headers = curl_slist_append(headers, ("If-Modified-Since: " + entry.lastModified).c_str());
+    }
+    return headers;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <curl/curl.h>
+
+// names the cached endpoints, never derived from a URL so the API key can't end up in a key
+const std::string statsCacheEndpoint = "GetUserStatsForGame";
+const std::string personaCacheEndpoint = "GetPlayerSummaries";
+
+struct CacheEntry {
+    // unix time of the last download or successful revalidation
+    int64_t fetchedAt = 0;
+    std::string etag;
+    std::string lastModified;
+    // what the response was turned into (serialized PlayerStats, a persona name), not the body
+    std::string payload;
+};
+
+// on-disk cache keyed by (endpoint, SteamID64). Entries are small metadata files pointing at
+// content-addressed payload objects:
+//   <dir>/entries/<hash of endpoint and steamid>
+//   <dir>/objects/<hash of payload>
+class ResponseCache {
+public:
+    ResponseCache(std::filesystem::path directory, std::chrono::seconds ttl, bool offline);
+
+    std::optional<CacheEntry> Load(std::string_view endpoint, std::string_view steamId) const;
+    // offline caches treat everything they have as fresh
+    bool IsFresh(const CacheEntry &entry) const;
+    // stamps entry.fetchedAt with the current time before writing it
+    bool Store(std::string_view endpoint, std::string_view steamId, CacheEntry &entry) const;
+
+    bool offline() const { return isOffline; }
+
+private:
+    std::filesystem::path EntryPath(std::string_view endpoint, std::string_view steamId) const;
+    std::filesystem::path ObjectPath(std::string_view payload) const;
+
+    std::filesystem::path directory;
+    std::chrono::seconds ttl;
+    bool isOffline;
+};
+
+// ETag/Last-Modified of a response, filled by CaptureValidators used as CURLOPT_HEADERFUNCTION
+struct HttpValidators {
+    std::string etag;
+    std::string lastModified;
+};
+
+size_t CaptureValidators(char *buffer, size_t size, size_t nitems, void *userp);
+// If-None-Match/If-Modified-Since for revalidating entry, nullptr if it has no validators
+curl_slist *ConditionalRequestHeaders(const CacheEntry &entry);
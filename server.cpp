@@ -0,0 +1,444 @@
+#include "server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/URI.h>
+
+#ifdef _WIN32
+#include <Poco/Event.h>
+#include <windows.h>
+#endif
+
+#include "main.h"
+#include "data_classes.h"
+#include "http_client.h"
+#include "leaderboard.h"
+#include "logging.h"
+#include "options.h"
+#include "player_cache.h"
+#include "profiler.h"
+#include "request_scheduler.h"
+#include "snapshot_log.h"
+#include "stat_catalog.h"
+#include "stat_index.h"
+#include "stats_renderer.h"
+#include "stats_writer.h"
+
+using namespace std;
+using Poco::Net::HTTPResponse;
+using Poco::Net::HTTPServerRequest;
+using Poco::Net::HTTPServerResponse;
+
+// requests spend most of their time waiting for the API, so there are more of them than cores
+static const unsigned defaultServerThreads = 16;
+// latency percentiles are taken over this many of the most recent requests
+static const size_t latencyWindow = 8192;
+// players listed by GET /top at most, and without ?k=
+static const size_t maxTop = 1000;
+static const size_t defaultTop = 10;
+
+// the last latencyWindow request durations
+class LatencyWindow {
+public:
+    void Record(chrono::microseconds duration) {
+        lock_guard lock(samplesMutex);
+        if (samples.size() < latencyWindow) {
+            samples.push_back(duration.count());
+        } else {
+            samples[next] = duration.count();
+        }
+        next = (next + 1) % latencyWindow;
+    }
+
+    // p in [0, 1], in milliseconds, 0 before the first request
+    vector<double> Percentiles(const vector<double> &ps, size_t &count) const {
+        vector<int64_t> sorted;
+        {
+            lock_guard lock(samplesMutex);
+            sorted = samples;
+        }
+        count = sorted.size();
+        sort(sorted.begin(), sorted.end());
+        vector<double> result;
+        for (double p: ps) {
+            result.push_back(sorted.empty() ? 0.0 : sorted[(size_t) (p * (double) (sorted.size() - 1))] / 1000.0);
+        }
+        return result;
+    }
+
+private:
+    mutable mutex samplesMutex;
+    vector<int64_t> samples;
+    size_t next = 0;
+};
+
+class StatsService {
+public:
+    StatsService(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache)
+            : options(options), descriptions(descriptions), cache(cache),
+              players(options.maxPlayers, chrono::seconds(options.cacheTtl)) {}
+
+    void Handle(HTTPServerRequest &request, HTTPServerResponse &response) {
+        auto start = chrono::steady_clock::now();
+        Poco::URI uri(request.getURI());
+        const string &path = uri.getPath();
+        const string statsPrefix = "/stats/";
+        const string topPrefix = "/top/";
+        const string rankPrefix = "/rank/";
+
+        if (request.getMethod() != "GET") {
+            SendText(response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "only GET is supported\n");
+        } else if (path == "/metrics") {
+            ServeMetrics(response);
+        } else if (path.compare(0, topPrefix.size(), topPrefix) == 0) {
+            ServeTop(response, uri, path.substr(topPrefix.size()));
+        } else if (path.compare(0, rankPrefix.size(), rankPrefix) == 0) {
+            ServeRank(response, path.substr(rankPrefix.size()));
+        } else if (path.compare(0, statsPrefix.size(), statsPrefix) == 0) {
+            ServeStats(request, response, uri, path.substr(statsPrefix.size()));
+            auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+            latency.Record(elapsed);
+            Log(Verbosity::Verbose, "GET %s %d %.1fms\n", request.getURI().c_str(), (int) response.getStatus(),
+                elapsed.count() / 1000.0);
+        } else {
+            SendText(response, HTTPResponse::HTTP_NOT_FOUND, "not found\n");
+        }
+    }
+
+    bool LoadLeaderboard() {
+        error_code ec;
+        if (options.leaderboardFile.empty() || !filesystem::exists(options.leaderboardFile, ec)) {
+            return true;
+        }
+        if (!leaderboard.Load(options.leaderboardFile, descriptions)) {
+            return false;
+        }
+        Log(Verbosity::Normal, "Loaded the ranks of %zu players from %s\n", leaderboard.players(),
+            options.leaderboardFile.c_str());
+        return true;
+    }
+
+    bool SaveLeaderboard() const {
+        return options.leaderboardFile.empty() || leaderboard.Save(options.leaderboardFile);
+    }
+
+    void LogSummary() const {
+        size_t count;
+        auto ms = latency.Percentiles({0.5, 0.99}, count);
+        PlayerCacheCounters counters = players.counters();
+        Log(Verbosity::Normal, "%llu requests, %llu failed, %llu players fetched, latency p50 %.1fms p99 %.1fms\n",
+            (unsigned long long) requests.load(), (unsigned long long) errors.load(),
+            (unsigned long long) (counters.misses - counters.coalesced), ms[0], ms[1]);
+    }
+
+private:
+    void ServeStats(HTTPServerRequest &request, HTTPServerResponse &response, const Poco::URI &uri,
+                    const string &steamId) {
+        requests++;
+        if (steamId.empty() || !all_of(steamId.begin(), steamId.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            errors++;
+            SendText(response, HTTPResponse::HTTP_BAD_REQUEST, "not a SteamID64\n");
+            return;
+        }
+
+        string accept = request.get("Accept", "");
+        OutputFormat format = OutputFormat::Markdown;
+        if (accept.find("application/json") != string::npos) {
+            format = OutputFormat::Json;
+        } else if (accept.find("text/csv") != string::npos) {
+            format = OutputFormat::Csv;
+        }
+        for (auto &[name, value]: uri.getQueryParameters()) {
+            if (name != "format") {
+                continue;
+            }
+            optional<OutputFormat> parsed = ParseOutputFormat(value);
+            if (!parsed || *parsed == OutputFormat::Ndjson) {
+                errors++;
+                SendText(response, HTTPResponse::HTTP_BAD_REQUEST, "format is either md, json or csv\n");
+                return;
+            }
+            format = *parsed;
+        }
+
+        shared_ptr<const CachedPlayer> player;
+        try {
+            player = players.Get(steamId, [this](const string &id) { return Load(id); });
+        } catch (const exception &e) {
+            errors++;
+            SendText(response, HTTPResponse::HTTP_BAD_GATEWAY, string(e.what()) + "\n");
+            return;
+        }
+
+        ostringstream body;
+        {
+            ProfileScope render(Phase::Render, steamId);
+            if (format == OutputFormat::Json) {
+                WriteStatsJson(player->stats, steamId, player->personaName, body);
+            } else if (format == OutputFormat::Csv) {
+                WriteCsvHeader(body);
+                WriteStatsCsv(player->stats, steamId, player->personaName, body);
+            } else {
+                renderer.Render(player->stats, player->personaName, body);
+            }
+        }
+        string result = body.str();
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType(format == OutputFormat::Json  ? "application/json"
+                                : format == OutputFormat::Csv ? "text/csv; charset=utf-8"
+                                                              : "text/markdown; charset=utf-8");
+        response.sendBuffer(result.data(), result.size());
+    }
+
+    // GET /top/<stat>?k=<n>, the n players with the highest value of a stat
+    void ServeTop(HTTPServerResponse &response, const Poco::URI &uri, const string &statName) const {
+        size_t k = defaultTop;
+        for (auto &[name, value]: uri.getQueryParameters()) {
+            if (name == "k") {
+                auto [end, error] = from_chars(value.data(), value.data() + value.size(), k);
+                if (error != errc() || end != value.data() + value.size() || k == 0 || k > maxTop) {
+                    SendText(response, HTTPResponse::HTTP_BAD_REQUEST, "k is a number from 1 to 1000\n");
+                    return;
+                }
+            }
+        }
+        optional<StatId> stat = leaderboard.Find(statName);
+        if (!stat) {
+            SendText(response, HTTPResponse::HTTP_NOT_FOUND, "no player has that stat\n");
+            return;
+        }
+
+        vector<LeaderboardEntry> top = leaderboard.Top(*stat, k);
+        ostringstream body;
+        body << "{\"stat\":";
+        WriteJsonString(body, StatCatalog::Get()[*stat].fullName);
+        body << ",\"top\":[";
+        size_t rank = 0;
+        for (size_t i = 0; i < top.size(); i++) {
+            // tied players share a rank, like GET /rank reports it
+            if (i == 0 || top[i].value != top[i - 1].value) {
+                rank = i + 1;
+            }
+            body << (i == 0 ? "" : ",") << "{\"rank\":" << rank << ",\"steamId\":\"" << top[i].steamId
+                 << "\",\"value\":" << top[i].value << "}";
+        }
+        body << "]}\n";
+        SendJson(response, body.str());
+    }
+
+    // GET /rank/<stat>/<steamid64>, where a player ranks among everyone the index has seen
+    void ServeRank(HTTPServerResponse &response, const string &rest) const {
+        size_t slash = rest.rfind('/');
+        uint64_t steamId = 0;
+        if (slash != string::npos) {
+            auto [end, error] = from_chars(rest.data() + slash + 1, rest.data() + rest.size(), steamId);
+            if (error != errc() || end != rest.data() + rest.size()) {
+                slash = string::npos;
+            }
+        }
+        if (slash == string::npos) {
+            SendText(response, HTTPResponse::HTTP_BAD_REQUEST, "expected /rank/<stat>/<steamid64>\n");
+            return;
+        }
+        optional<StatId> stat = leaderboard.Find(string_view(rest).substr(0, slash));
+        optional<PlayerRank> rank = stat ? leaderboard.Rank(*stat, steamId) : nullopt;
+        if (!rank) {
+            SendText(response, HTTPResponse::HTTP_NOT_FOUND, "the player isn't ranked on that stat\n");
+            return;
+        }
+
+        ostringstream body;
+        body << "{\"stat\":";
+        WriteJsonString(body, StatCatalog::Get()[*stat].fullName);
+        body << ",\"steamId\":\"" << steamId << "\",\"value\":" << rank->value << ",\"rank\":" << rank->rank
+             << ",\"players\":" << rank->players << ",\"percentile\":" << rank->percentile << "}\n";
+        SendJson(response, body.str());
+    }
+
+    void ServeMetrics(HTTPServerResponse &response) const {
+        size_t count;
+        auto ms = latency.Percentiles({0.5, 0.99}, count);
+        PlayerCacheCounters counters = players.counters();
+        SchedulerMetrics scheduler = RequestScheduler::Get().metrics();
+        char body[1024];
+        int length = snprintf(
+                body, sizeof(body),
+                "{\"requests\":%llu,\"errors\":%llu,\"latency\":{\"samples\":%zu,\"p50Ms\":%.3f,\"p99Ms\":%.3f},"
+                "\"players\":{\"cached\":%zu,\"capacity\":%u,\"hits\":%llu,\"misses\":%llu,\"coalesced\":%llu,"
+                "\"fetches\":%llu,\"failures\":%llu},\"upstream\":{\"requests\":%llu,\"connections\":%llu},"
+                "\"scheduler\":{\"queuedInteractive\":%zu,\"queuedBackground\":%zu,\"sent\":%llu,\"retried\":%llu,"
+                "\"throttled\":%llu,\"deduplicated\":%llu,\"overBudget\":%llu,\"meanWaitMs\":%.3f,\"maxWaitMs\":%.3f,"
+                "\"usedToday\":%llu,\"dailyBudget\":%llu}}\n",
+                (unsigned long long) requests.load(), (unsigned long long) errors.load(), count, ms[0], ms[1],
+                counters.size, options.maxPlayers, (unsigned long long) counters.hits,
+                (unsigned long long) counters.misses, (unsigned long long) counters.coalesced,
+                (unsigned long long) (counters.misses - counters.coalesced),
+                (unsigned long long) counters.loadFailures, (unsigned long long) HttpClient::Get().requests(),
+                (unsigned long long) HttpClient::Get().connections(), scheduler.queued[0], scheduler.queued[1],
+                (unsigned long long) scheduler.sent, (unsigned long long) scheduler.retried,
+                (unsigned long long) scheduler.throttled, (unsigned long long) scheduler.deduplicated,
+                (unsigned long long) scheduler.overBudget,
+                scheduler.waits > 0 ? scheduler.waitSeconds * 1000 / (double) scheduler.waits : 0.0,
+                scheduler.maxWaitSeconds * 1000, (unsigned long long) scheduler.usedToday,
+                (unsigned long long) scheduler.dailyBudget);
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType("application/json");
+        response.sendBuffer(body, (size_t) length);
+    }
+
+    static void SendJson(HTTPServerResponse &response, const string &body) {
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType("application/json");
+        response.sendBuffer(body.data(), body.size());
+    }
+
+    static void SendText(HTTPServerResponse &response, HTTPResponse::HTTPStatus status, const string &text) {
+        response.setStatus(status);
+        response.setContentType("text/plain; charset=utf-8");
+        response.sendBuffer(text.data(), text.size());
+    }
+
+    // runs once per player and cache miss, however many requests are waiting for it
+    shared_ptr<const CachedPlayer> Load(const string &steamId) {
+        string statsUrl = BuildApiUrl(options.apiBase, statsEndpoint, options.apiKey, steamId);
+        optional<PlayerStats> stats = FetchResults(statsUrl, descriptions, cache, steamId);
+        if (!stats) {
+            throw runtime_error("could not fetch the stats of " + steamId);
+        }
+        if (!options.historyDir.empty() && !options.offline) {
+            RecordSnapshot(options.historyDir, steamId, *stats);
+        }
+        uint64_t id = 0;
+        auto [end, error] = from_chars(steamId.data(), steamId.data() + steamId.size(), id);
+        if (error == errc() && end == steamId.data() + steamId.size()) {
+            leaderboard.Update(id, *stats);
+        }
+        auto player = make_shared<CachedPlayer>();
+        player->stats = std::move(*stats);
+        string playerUrl = BuildApiUrl(options.apiBase, playerSummariesEndpoint, options.apiKey, steamId);
+        player->personaName = getPersonaName(playerUrl, cache, steamId);
+        player->fetchedAt = chrono::steady_clock::now();
+        return player;
+    }
+
+    const Options &options;
+    const StatDescriptionIndex &descriptions;
+    const ResponseCache *cache;
+    StatsRenderer renderer;
+    PlayerCache players;
+    LeaderboardIndex leaderboard;
+    LatencyWindow latency;
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> errors{0};
+};
+
+class StatsRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit StatsRequestHandler(StatsService &service) : service(service) {}
+
+    void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override {
+        service.Handle(request, response);
+    }
+
+private:
+    StatsService &service;
+};
+
+class StatsRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    explicit StatsRequestHandlerFactory(StatsService &service) : service(service) {}
+
+    Poco::Net::HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override {
+        return new StatsRequestHandler(service);
+    }
+
+private:
+    StatsService &service;
+};
+
+#ifdef _WIN32
+static Poco::Event terminationRequested;
+
+static BOOL WINAPI ConsoleHandler(DWORD) {
+    terminationRequested.set();
+    return TRUE;
+}
+#endif
+
+void BlockTerminationSignals() {
+#ifndef _WIN32
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+}
+
+void WaitForTermination() {
+#ifdef _WIN32
+    SetConsoleCtrlHandler(ConsoleHandler, TRUE);
+    terminationRequested.wait();
+#else
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    int signal;
+    sigwait(&signals, &signal);
+#endif
+}
+
+int RunServer(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache) {
+    BlockTerminationSignals();
+    // initializes curl before any request thread is started
+    HttpClient::Get();
+    {
+        StatsService service(options, descriptions, cache);
+        if (!service.LoadLeaderboard()) {
+            return EXIT_FAILURE;
+        }
+        unsigned threads = options.workers ? options.workers : defaultServerThreads;
+        Poco::ThreadPool pool(2, (int) threads);
+        Poco::Net::HTTPServerParams::Ptr params = new Poco::Net::HTTPServerParams;
+        params->setMaxThreads((int) threads);
+
+        try {
+            Poco::Net::ServerSocket socket((Poco::UInt16) options.servePort);
+            Poco::Net::HTTPServer server(new StatsRequestHandlerFactory(service), pool, socket, params);
+            server.start();
+            Log(Verbosity::Normal, "Serving on port %u\n", options.servePort);
+            WaitForTermination();
+            server.stopAll();
+            pool.joinAll();
+        } catch (const exception &e) {
+            fprintf(stderr, "Error: could not serve on port %u: %s\n", options.servePort, e.what());
+            return EXIT_FAILURE;
+        }
+        service.LogSummary();
+        if (!service.SaveLeaderboard()) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+struct Options;
+class StatDescriptionIndex;
+class ResponseCache;
+
+// serves GET /stats/<steamid64> (Markdown, or JSON or CSV with ?format= or the matching Accept),
+// GET /top/<stat>, GET /rank/<stat>/<steamid64> and GET /metrics on options.servePort until
+// SIGINT/SIGTERM. Descriptions and templates stay loaded, recently requested players are kept in
+// memory and concurrent requests for the same player share one fetch. cache may be null. Returns
+// the process exit code.
+int RunServer(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache);
+
+// has to run before any thread is started, so that SIGINT and SIGTERM are blocked in all of them
+void BlockTerminationSignals();
+// until Ctrl+C, SIGINT or SIGTERM
+void WaitForTermination();
@@ -0,0 +1,359 @@
+#include "snapshot_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#include "main.h"
+#include "binary_io.h"
+#include "logging.h"
+#include "stat_catalog.h"
+
+using namespace std;
+
+// a keyframe every this many records bounds how much a read has to decode
+static const size_t snapshotsPerKeyframe = 64;
+static const size_t indexEntrySize = 16;
+static const uint8_t keyframeRecord = 'K';
+static const uint8_t deltaRecord = 'D';
+
+static bool ReadRange(const filesystem::path &path, uint64_t offset, uint64_t size, string &data) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.resize(size);
+    in.seekg((streamoff) offset);
+    in.read(data.data(), (streamsize) size);
+    return (uint64_t) in.gcount() == size;
+}
+
+static bool AppendTo(const filesystem::path &path, const string &data) {
+    ofstream out(path, ios::binary | ios::app);
+    out.write(data.data(), (streamsize) data.size());
+    out.flush();
+    return (bool) out;
+}
+
+static uint64_t FileSize(const filesystem::path &path) {
+    error_code ec;
+    uint64_t size = filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+// kind, VarInt time, VarUInt payload size, payload, U32 checksum of everything before it
+static bool ParseRecord(ByteReader &reader, uint8_t &kind, int64_t &time, string_view &payload) {
+    size_t start = reader.position();
+    uint64_t size;
+    uint32_t checksum;
+    if (!reader.U8(kind) || !reader.VarInt(time) || !reader.VarUInt(size) || !reader.Bytes(size, payload)) {
+        return false;
+    }
+    size_t end = reader.position();
+    if (!reader.U32(checksum)) {
+        return false;
+    }
+    // the reader only hands out views of its input, so the record's bytes end right before payload's end
+    string_view record(payload.data() + payload.size() - (end - start), end - start);
+    return (kind == keyframeRecord || kind == deltaRecord) && checksum == (uint32_t) HashBytes(record);
+}
+
+SnapshotLog::SnapshotLog(filesystem::path directory)
+        : directory(std::move(directory)), logPath(this->directory / "snapshots.log"),
+          indexPath(this->directory / "snapshots.idx"), namesPath(this->directory / "stat_names") {}
+
+bool SnapshotLog::Open() {
+    error_code ec;
+    filesystem::create_directories(directory, ec);
+    if (ec) {
+        fprintf(stderr, "Error: could not create %s: %s\n", directory.string().c_str(), ec.message().c_str());
+        return false;
+    }
+
+    names.clear();
+    nameIndex.clear();
+    string data;
+    uint64_t namesSize = FileSize(namesPath);
+    if (namesSize > 0 && ReadRange(namesPath, 0, namesSize, data)) {
+        ByteReader reader(data);
+        string_view name;
+        size_t valid = 0;
+        while (reader.String(name)) {
+            nameIndex.emplace(name, (uint32_t) names.size());
+            names.emplace_back(name);
+            valid = reader.position();
+        }
+        if (valid != data.size()) {
+            // a name cut short by a crash, no record refers to it yet
+            filesystem::resize_file(namesPath, valid, ec);
+        }
+    }
+
+    logSize = FileSize(logPath);
+    size_t entries = FileSize(indexPath) / indexEntrySize;
+    // index entries are written after their record, the index can only lag behind the log
+    IndexEntry entry{};
+    while (entries > 0 && (!ReadEntry(entries - 1, entry) || entry.offset >= logSize)) {
+        entries--;
+    }
+    // the last indexed record is checked again along with anything written after it
+    uint64_t indexed = 0;
+    if (entries > 0) {
+        entries--;
+        indexed = entry.offset;
+    }
+    if (!RebuildIndex(entries, indexed, logSize)) {
+        return false;
+    }
+
+    last = State();
+    lastTime = 0;
+    return count == 0 || Decode(count - 1, last, lastTime);
+}
+
+bool SnapshotLog::RebuildIndex(size_t validEntries, uint64_t from, uint64_t size) {
+    error_code ec;
+    if (FileSize(indexPath) != validEntries * indexEntrySize) {
+        if (filesystem::exists(indexPath)) {
+            filesystem::resize_file(indexPath, validEntries * indexEntrySize, ec);
+        }
+        if (ec) {
+            fprintf(stderr, "Error: could not repair %s: %s\n", indexPath.string().c_str(), ec.message().c_str());
+            return false;
+        }
+    }
+    count = validEntries;
+    logSize = from;
+    if (from == size) {
+        return true;
+    }
+
+    // records nobody indexed, normally none, one if the process died between the two writes
+    string tail;
+    if (!ReadRange(logPath, from, size - from, tail)) {
+        return false;
+    }
+    ByteReader reader(tail);
+    string index;
+    ByteWriter writer(index);
+    size_t start = 0;
+    uint8_t kind;
+    int64_t time;
+    string_view payload;
+    while (ParseRecord(reader, kind, time, payload) &&
+           (kind == keyframeRecord) == (count % snapshotsPerKeyframe == 0)) {
+        writer.U64((uint64_t) time);
+        writer.U64(from + start);
+        start = reader.position();
+        count++;
+    }
+    logSize = from + start;
+    if (logSize != size) {
+        Log(Verbosity::Normal, "Dropping a damaged snapshot at the end of %s\n", logPath.string().c_str());
+        filesystem::resize_file(logPath, logSize, ec);
+    }
+    return index.empty() || AppendTo(indexPath, index);
+}
+
+bool SnapshotLog::ReadEntry(size_t index, IndexEntry &entry) const {
+    string data;
+    if (!ReadRange(indexPath, index * indexEntrySize, indexEntrySize, data)) {
+        return false;
+    }
+    ByteReader reader(data);
+    uint64_t time = 0;
+    if (!reader.U64(time) || !reader.U64(entry.offset)) {
+        return false;
+    }
+    entry.time = (int64_t) time;
+    return true;
+}
+
+optional<size_t> SnapshotLog::Before(int64_t time) const {
+    // first entry after time, the index is in time order
+    size_t low = 0;
+    size_t high = count;
+    IndexEntry entry{};
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (!ReadEntry(middle, entry)) {
+            return nullopt;
+        }
+        if (entry.time <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return nullopt;
+    }
+    return low - 1;
+}
+
+// replays the keyframe at or before index and every delta up to it
+bool SnapshotLog::Decode(size_t index, State &state, int64_t &time) const {
+    size_t keyframe = index - index % snapshotsPerKeyframe;
+    IndexEntry first{};
+    IndexEntry next{};
+    if (!ReadEntry(keyframe, first)) {
+        return false;
+    }
+    uint64_t end = logSize;
+    if (index + 1 < count) {
+        if (!ReadEntry(index + 1, next)) {
+            return false;
+        }
+        end = next.offset;
+    }
+    string data;
+    if (end < first.offset || !ReadRange(logPath, first.offset, end - first.offset, data)) {
+        return false;
+    }
+
+    state.values.assign(names.size(), 0);
+    state.present.assign(names.size(), 0);
+    ByteReader reader(data);
+    for (size_t i = keyframe; i <= index; i++) {
+        uint8_t kind;
+        string_view payload;
+        if (!ParseRecord(reader, kind, time, payload)) {
+            return false;
+        }
+        ByteReader entries(payload);
+        uint64_t entryCount;
+        if (!entries.VarUInt(entryCount)) {
+            return false;
+        }
+        uint64_t id = 0;
+        for (uint64_t j = 0; j < entryCount; j++) {
+            uint64_t gap;
+            int64_t value;
+            if (!entries.VarUInt(gap) || !entries.VarInt(value)) {
+                return false;
+            }
+            id += gap;
+            if (id >= names.size()) {
+                return false;
+            }
+            state.values[id] = kind == keyframeRecord ? value : state.values[id] + value;
+            state.present[id] = 1;
+            id++;
+        }
+    }
+    return true;
+}
+
+uint32_t SnapshotLog::StatIndex(const string &name) {
+    auto it = nameIndex.find(name);
+    if (it != nameIndex.end()) {
+        return it->second;
+    }
+    auto index = (uint32_t) names.size();
+    names.push_back(name);
+    nameIndex.emplace(name, index);
+    return index;
+}
+
+bool SnapshotLog::Append(int64_t time, const PlayerStats &stats) {
+    time = max(time, lastTime);
+    size_t knownNames = names.size();
+
+    const StatCatalog &catalog = StatCatalog::Get();
+    State current;
+    for (const StatColumns *columns: {&stats.pvpStats, &stats.mvmStats, &stats.mapStats, &stats.achievementStats}) {
+        for (auto [stat, value]: catalog.View(*columns)) {
+            uint32_t index = StatIndex(stat.fullName);
+            if (index >= current.values.size()) {
+                current.values.resize(names.size(), 0);
+                current.present.resize(names.size(), 0);
+            }
+            current.values[index] = value;
+            current.present[index] = 1;
+        }
+    }
+    current.values.resize(names.size(), 0);
+    current.present.resize(names.size(), 0);
+    last.values.resize(names.size(), 0);
+    last.present.resize(names.size(), 0);
+
+    bool keyframe = count % snapshotsPerKeyframe == 0;
+    string payload;
+    ByteWriter payloadWriter(payload);
+    uint64_t entryCount = 0;
+    string entries;
+    ByteWriter entryWriter(entries);
+    uint64_t next = 0;
+    for (uint64_t id = 0; id < names.size(); id++) {
+        if (last.present[id] && !current.present[id]) {
+            // a stat that disappeared reads back as 0, replays have no way to remove one
+            current.present[id] = 1;
+        }
+        if (!current.present[id]) {
+            continue;
+        }
+        if (!keyframe && last.present[id] && current.values[id] == last.values[id]) {
+            continue;
+        }
+        entryWriter.VarUInt(id - next);
+        entryWriter.VarInt(keyframe ? current.values[id] : current.values[id] - last.values[id]);
+        next = id + 1;
+        entryCount++;
+    }
+    payloadWriter.VarUInt(entryCount);
+    payloadWriter.Bytes(entries);
+
+    string record;
+    ByteWriter writer(record);
+    writer.U8(keyframe ? keyframeRecord : deltaRecord);
+    writer.VarInt(time);
+    writer.String(payload);
+    writer.U32((uint32_t) HashBytes(record));
+
+    string newNames;
+    ByteWriter namesWriter(newNames);
+    for (size_t i = knownNames; i < names.size(); i++) {
+        namesWriter.String(names[i]);
+    }
+    string index;
+    ByteWriter indexWriter(index);
+    indexWriter.U64((uint64_t) time);
+    indexWriter.U64(logSize);
+
+    // names before the record that uses them, the record before its index entry, so a crash at
+    // any point leaves at most an unindexed record that Open picks up again
+    if ((!newNames.empty() && !AppendTo(namesPath, newNames)) || !AppendTo(logPath, record) ||
+        !AppendTo(indexPath, index)) {
+        return false;
+    }
+    logSize += record.size();
+    count++;
+    lastTime = time;
+    last = std::move(current);
+    return true;
+}
+
+bool SnapshotLog::Read(size_t index, const StatDescriptionIndex &descriptions, Snapshot &snapshot) const {
+    State state;
+    if (index >= count || !Decode(index, state, snapshot.time)) {
+        return false;
+    }
+    snapshot.stats = PlayerStats();
+    for (size_t id = 0; id < state.values.size(); id++) {
+        if (state.present[id]) {
+            AddStat(snapshot.stats, descriptions, names[id], state.values[id]);
+        }
+    }
+    return true;
+}
+
+void RecordSnapshot(const string &historyDir, const string &steamId, const PlayerStats &stats) {
+    SnapshotLog log(filesystem::path(historyDir) / steamId);
+    int64_t now = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    if (!log.Open() || !log.Append(now, stats)) {
+        fprintf(stderr, "Error: could not record a snapshot of %s in %s\n", steamId.c_str(), historyDir.c_str());
+        return;
+    }
+    Log(Verbosity::Verbose, "Recorded snapshot %zu of %s\n", log.size(), steamId.c_str());
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "data_classes.h"
+
+class StatDescriptionIndex;
+
+struct Snapshot {
+    // unix time it was taken
+    int64_t time = 0;
+    PlayerStats stats;
+};
+
+// append-only history of one player's stats, kept in one directory:
+//   stat_names      the player's stat dictionary, records refer to stats by their position in it
+//   snapshots.log   one record per snapshot, every 64th a keyframe with every stat, the others
+//                   only the stats that changed since the previous one, as value deltas
+//   snapshots.idx   time and log offset of every record, fixed width so it can be binary searched
+// Reading a snapshot decodes at most one keyframe and the deltas after it, appending needs only
+// the latest state, which Open restores the same way.
+class SnapshotLog {
+public:
+    explicit SnapshotLog(std::filesystem::path directory);
+
+    // creates the directory if needed, drops a record torn by a crash and rebuilds a stale index
+    bool Open();
+
+    // times earlier than the latest snapshot's are moved up to it, the log stays in order
+    bool Append(int64_t time, const PlayerStats &stats);
+
+    size_t size() const { return count; }
+    // the latest snapshot taken at or before time
+    std::optional<size_t> Before(int64_t time) const;
+    bool Read(size_t index, const StatDescriptionIndex &descriptions, Snapshot &snapshot) const;
+
+private:
+    struct IndexEntry {
+        int64_t time;
+        uint64_t offset;
+    };
+
+    // values by dictionary position, present marks the stats the snapshot has
+    struct State {
+        std::vector<int64_t> values;
+        std::vector<uint8_t> present;
+    };
+
+    bool ReadEntry(size_t index, IndexEntry &entry) const;
+    bool Decode(size_t index, State &state, int64_t &time) const;
+    bool RebuildIndex(size_t validEntries, uint64_t from, uint64_t logSize);
+    uint32_t StatIndex(const std::string &name);
+
+    std::filesystem::path directory;
+    std::filesystem::path logPath;
+    std::filesystem::path indexPath;
+    std::filesystem::path namesPath;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameIndex;
+    size_t count = 0;
+    uint64_t logSize = 0;
+    int64_t lastTime = 0;
+    State last;
+};
+
+// --history-dir: appends stats that were just fetched to <historyDir>/<steamid64>/, failures are
+// reported but never fail the fetch
+void RecordSnapshot(const std::string &historyDir, const std::string &steamId, const PlayerStats &stats);
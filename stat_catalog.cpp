@@ -0,0 +1,78 @@
+#include "stat_catalog.h"
+
+#include <mutex>
+#include <stdexcept>
+
+#include "profiler.h"
+
+using namespace std;
+
+StatCatalog &StatCatalog::Get() {
+    static StatCatalog catalog;
+    return catalog;
+}
+
+StatId StatCatalog::Intern(string_view statName, const StatDescriptionIndex &descriptions) {
+    {
+        shared_lock lock(mutex);
+        auto it = ids.find(statName);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+
+    // classified outside the lock, losing a race only wastes the work
+    StatName parsed;
+    {
+        ProfileScope classify(Phase::Classify);
+        parsed = ClassifyStat(statName);
+    }
+    StatInfo info;
+    info.category = parsed.category;
+    info.fullName = statName;
+    uint32_t group = 0;
+    if (parsed.category == StatCategory::Class) {
+        // the templates from stat_names.json ("Class.accum.iX") never show up in responses
+        if (parsed.isClassTemplate) {
+            info.category = StatCategory::Unknown;
+        } else {
+            info.className = tfClassNames[(int) parsed.tfClass];
+            info.tfClass = parsed.tfClass;
+            info.gameType = parsed.gameType;
+            info.statType = parsed.statType;
+            info.shortName = parsed.shortName;
+            group = (uint32_t) parsed.tfClass;
+        }
+    } else if (parsed.category == StatCategory::Map) {
+        info.mapName = parsed.mapName;
+        info.gamemode = parsed.gamemode;
+    }
+    {
+        ProfileScope describe(Phase::Describe);
+        info.description = descriptions.Describe(parsed);
+    }
+
+    unique_lock lock(mutex);
+    auto it = ids.find(statName);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    if (count > indexMask) {
+        throw length_error("too many distinct stat names");
+    }
+    uint32_t index = count++;
+    auto &chunk = chunks[index >> chunkBits];
+    if (!chunk) {
+        chunk = make_unique<StatInfo[]>(chunkSize);
+    }
+    chunk[index & (chunkSize - 1)] = std::move(info);
+
+    StatId id = (group << indexBits) | index;
+    ids.emplace(string(statName), id);
+    return id;
+}
+
+size_t StatCatalog::size() const {
+    shared_lock lock(mutex);
+    return count;
+}
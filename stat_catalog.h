@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "data_classes.h"
+#include "stat_classifier.h"
+#include "stat_index.h"
+
+// everything about a stat that is the same for every player, stored once per process
+struct StatInfo {
+    StatCategory category = StatCategory::Unknown;
+    std::string fullName;
+    // class stats
+    std::string_view className;
+    TfClass tfClass = TfClass::Scout;
+    GameType gameType = GameType::pvp;
+    StatType statType = StatType::accum;
+    std::string shortName;
+    // map stats
+    std::string mapName;
+    std::string gamemode;
+    // class and achievement stats
+    std::string description;
+};
+
+// (stat, value) pairs of a StatColumns, looked up in the catalog while iterating
+class StatColumnsView;
+
+// interns every stat name seen in a response into a StatId. Class stats get their TfClass in the
+// top bits of the id, so ordering ids groups them by class and within a class by first appearance.
+// Interning and lookups are safe from any thread, a StatInfo never moves once it was added.
+class StatCatalog {
+public:
+    static StatCatalog &Get();
+
+    // classifies and describes statName the first time it is seen, descriptions are taken from
+    // the index that was passed then
+    StatId Intern(std::string_view statName, const StatDescriptionIndex &descriptions);
+
+    const StatInfo &operator[](StatId id) const {
+        uint32_t index = id & indexMask;
+        return chunks[index >> chunkBits][index & (chunkSize - 1)];
+    }
+
+    StatColumnsView View(const StatColumns &columns) const;
+
+    size_t size() const;
+
+private:
+    static const uint32_t indexBits = 24;
+    static const uint32_t indexMask = (1u << indexBits) - 1;
+    static const uint32_t chunkBits = 12;
+    static const uint32_t chunkSize = 1u << chunkBits;
+
+    StatCatalog() = default;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, StatId, StringHash, std::equal_to<>> ids;
+    uint32_t count = 0;
+    // fixed array of chunks so readers never race with a reallocation
+    std::array<std::unique_ptr<StatInfo[]>, (1u << (indexBits - chunkBits))> chunks;
+};
+
+struct StatEntry {
+    const StatInfo &info;
+    int64_t value;
+};
+
+class StatColumnsView {
+public:
+    class iterator {
+    public:
+        iterator(const StatCatalog &catalog, const StatColumns &columns, size_t pos)
+                : catalog(&catalog), columns(&columns), pos(pos) {}
+
+        StatEntry operator*() const { return {(*catalog)[columns->ids[pos]], columns->values[pos]}; }
+        iterator &operator++() {
+            pos++;
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return pos != other.pos; }
+
+    private:
+        const StatCatalog *catalog;
+        const StatColumns *columns;
+        size_t pos;
+    };
+
+    StatColumnsView(const StatCatalog &catalog, const StatColumns &columns) : catalog(catalog), columns(columns) {}
+
+    iterator begin() const { return {catalog, columns, 0}; }
+    iterator end() const { return {catalog, columns, columns.size()}; }
+
+private:
+    const StatCatalog &catalog;
+    const StatColumns &columns;
+};
+
+inline StatColumnsView StatCatalog::View(const StatColumns &columns) const {
+    return {*this, columns};
+}
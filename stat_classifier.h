@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string_view>
+
+#include "data_classes.h"
+
+enum class StatCategory {
+    Unknown = 0,
+    Class = 1,
+    Map = 2,
+    Achievement = 3
+};
+
+// result of classifying a raw stat name, every string_view points into the name that was
+// classified
+struct StatName {
+    StatCategory category = StatCategory::Unknown;
+    std::string_view fullName;
+    // class stats: "Scout", "Soldier", ... or "Class" for the templates in stat_names.json
+    std::string_view className;
+    bool isClassTemplate = false;
+    TfClass tfClass = TfClass::Scout;
+    GameType gameType = GameType::pvp;
+    StatType statType = StatType::accum;
+    std::string_view shortName;
+    // map stats: "cp_dustbowl" and "cp"
+    std::string_view mapName;
+    std::string_view gamemode;
+};
+
+namespace stat_classifier {
+
+constexpr bool IsAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr bool IsMapChar(char c) {
+    return IsAlpha(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+constexpr bool ConsumePrefix(std::string_view &str, std::string_view prefix) {
+    if (str.substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    str.remove_prefix(prefix.size());
+    return true;
+}
+
+// Class.accum.iX, Scout.accum.iX, Scout.max.iX, Scout.mvm.accum.iX, Scout.mvm.max.iX
+constexpr bool ClassifyClassStat(std::string_view name, StatName &result) {
+    size_t dot = name.find('.');
+    if (dot == std::string_view::npos) {
+        return false;
+    }
+    std::string_view className = name.substr(0, dot);
+    std::string_view rest = name.substr(dot + 1);
+
+    size_t classIndex = 0;
+    while (classIndex < tfClassNames.size() && tfClassNames[classIndex] != className) {
+        classIndex++;
+    }
+    bool isClassTemplate = className == "Class";
+    if (classIndex == tfClassNames.size() && !isClassTemplate) {
+        return false;
+    }
+
+    GameType gameType = ConsumePrefix(rest, "mvm.") ? GameType::coop : GameType::pvp;
+    StatType statType;
+    if (ConsumePrefix(rest, "accum.i")) {
+        statType = StatType::accum;
+    } else if (ConsumePrefix(rest, "max.i")) {
+        statType = StatType::max;
+    } else {
+        return false;
+    }
+
+    if (rest.empty()) {
+        return false;
+    }
+    for (char c: rest) {
+        if (!IsAlpha(c)) {
+            return false;
+        }
+    }
+
+    result.className = className;
+    result.isClassTemplate = isClassTemplate;
+    result.tfClass = isClassTemplate ? TfClass::Scout : static_cast<TfClass>(classIndex);
+    result.gameType = gameType;
+    result.statType = statType;
+    result.shortName = rest;
+    return true;
+}
+
+// cp_dustbowl.accum.iPlayTime
+constexpr bool ClassifyMapStat(std::string_view name, StatName &result) {
+    size_t underscore = name.find('_');
+    if (underscore == std::string_view::npos) {
+        return false;
+    }
+    std::string_view gamemode = name.substr(0, underscore);
+    if (gamemode != "arena" && gamemode != "cp" && gamemode != "ctf" && gamemode != "koth" &&
+        gamemode != "pl" && gamemode != "plr" && gamemode != "sd") {
+        return false;
+    }
+
+    size_t end = underscore + 1;
+    while (end < name.size() && IsMapChar(name[end])) {
+        end++;
+    }
+    if (end == underscore + 1 || name.substr(end) != ".accum.iPlayTime") {
+        return false;
+    }
+
+    result.mapName = name.substr(0, end);
+    result.gamemode = gamemode;
+    return true;
+}
+
+// TF_..._STAT, the middle part may be anything but a line break
+constexpr bool ClassifyAchievementStat(std::string_view name) {
+    if (name.size() < 8 || name.substr(0, 3) != "TF_" || name.substr(name.size() - 5) != "_STAT") {
+        return false;
+    }
+    for (char c: name.substr(3, name.size() - 8)) {
+        if (c == '\n' || c == '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace stat_classifier
+
+// classifies a stat name from the GetUserStatsForGame response without allocating, the first
+// character alone decides which of the three grammars is tried
+constexpr StatName ClassifyStat(std::string_view name) {
+    using namespace stat_classifier;
+
+    StatName result;
+    result.fullName = name;
+    if (name.empty()) {
+        return result;
+    }
+
+    char first = name.front();
+    if (first == 'T') {
+        if (ClassifyAchievementStat(name)) {
+            result.category = StatCategory::Achievement;
+        }
+    } else if (first >= 'A' && first <= 'Z') {
+        if (ClassifyClassStat(name, result)) {
+            result.category = StatCategory::Class;
+        }
+    } else if (ClassifyMapStat(name, result)) {
+        result.category = StatCategory::Map;
+    }
+    return result;
+}
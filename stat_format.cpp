@@ -0,0 +1,103 @@
+#include "stat_format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+
+using namespace std;
+
+static char *WriteUnsigned(char *out, uint64_t value) {
+    return to_chars(out, out + 20, value).ptr;
+}
+
+static char *WriteTwoDigits(char *out, unsigned value) {
+    out[0] = (char) ('0' + value / 10);
+    out[1] = (char) ('0' + value % 10);
+    return out + 2;
+}
+
+static uint64_t Magnitude(int64_t value) {
+    return value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+}
+
+char *FormatHhMmSs(char *out, int64_t seconds) {
+    if (seconds < 0) {
+        *out++ = '-';
+    }
+    uint64_t magnitude = Magnitude(seconds);
+    uint64_t hours = magnitude / 3600;
+    auto rest = (unsigned) (magnitude % 3600);
+    if (hours != 0) {
+        out = WriteUnsigned(out, hours);
+        *out++ = ':';
+    }
+    out = WriteTwoDigits(out, rest / 60);
+    *out++ = ':';
+    return WriteTwoDigits(out, rest % 60);
+}
+
+char *FormatThousands(char *out, int64_t value, char separator) {
+    if (value < 0) {
+        *out++ = '-';
+    }
+    char digits[20];
+    char *end = WriteUnsigned(digits, Magnitude(value));
+    auto count = (size_t) (end - digits);
+    for (size_t i = 0; i < count; i++) {
+        if (i != 0 && (count - i) % 3 == 0) {
+            *out++ = separator;
+        }
+        *out++ = digits[i];
+    }
+    return out;
+}
+
+char *FormatHumanDuration(char *out, dseconds duration) {
+    struct Unit {
+        double seconds;
+        string_view singular;
+        string_view plural;
+    };
+    static const Unit units[] = {
+            {dseconds(dyears(1)).count(), "year", "years"},
+            {dseconds(dmonths(1)).count(), "month", "months"},
+            {dseconds(dweeks(1)).count(), "week", "weeks"},
+            {dseconds(ddays(1)).count(), "day", "days"},
+            {dseconds(dhours(1)).count(), "hour", "hours"},
+            {dseconds(dminutes(1)).count(), "minute", "minutes"},
+            {1, "second", "seconds"},
+    };
+
+    // billions of years, far past any stat, and keeps llround in range. NaN is no duration at all.
+    double magnitude = abs(duration.count());
+    if (isnan(magnitude)) {
+        magnitude = 0;
+    } else if (!(magnitude < 1e17)) {
+        magnitude = 1e17;
+    }
+    // the largest unit it is at least one of, or would round up to in the unit below, so 59.97
+    // minutes are 1 hour rather than 60 minutes but 57.6 minutes stay minutes
+    const Unit *unit = &units[size(units) - 1];
+    for (size_t i = 0; i + 1 < size(units); i++) {
+        const Unit &below = units[i + 1];
+        if (magnitude >= units[i].seconds ||
+            (double) llround(magnitude / below.seconds * 10) >= units[i].seconds / below.seconds * 10) {
+            unit = &units[i];
+            break;
+        }
+    }
+    auto tenths = (uint64_t) llround(magnitude / unit->seconds * 10);
+
+    if (duration.count() < 0 && tenths != 0) {
+        *out++ = '-';
+    }
+    out = WriteUnsigned(out, tenths / 10);
+    if (tenths % 10 != 0) {
+        *out++ = '.';
+        *out++ = (char) ('0' + tenths % 10);
+    }
+    *out++ = ' ';
+    string_view name = tenths == 10 ? unit->singular : unit->plural;
+    return copy(name.begin(), name.end(), out);
+}
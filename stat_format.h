@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "data_classes.h"
+
+// the Format functions write into out like std::to_chars, at most this many characters, and
+// return the end of what they wrote. Nothing is allocated, so they can write straight into an
+// output buffer.
+const size_t maxFormattedSize = 32;
+
+// play time as H:MM:SS, or MM:SS under an hour
+char *FormatHhMmSs(char *out, int64_t seconds);
+// 1,234,567
+char *FormatThousands(char *out, int64_t value, char separator);
+// in the largest unit from seconds to years it is at least one of, to a tenth: "45 seconds",
+// "3.5 hours", "1 day", "2.1 years"
+char *FormatHumanDuration(char *out, dseconds duration);
+
+// for the template data, short results fit std::string's own buffer and don't allocate either
+template<typename Format, typename... Args>
+std::string FormatToString(Format format, Args... args) {
+    char buffer[maxFormattedSize];
+    return std::string(buffer, format(buffer, args...));
+}
@@ -0,0 +1,67 @@
+#include "stat_index.h"
+
+#include <algorithm>
+
+#include "stat_names.h"
+
+using namespace std;
+
+static_assert(is_sorted(embeddedStatNames.begin(), embeddedStatNames.end(),
+                        [](const StatNameEntry &a, const StatNameEntry &b) { return a.name < b.name; }),
+              "stat-names-gen has to emit the table sorted by name");
+
+static const string_view classPlaceholder = "Class";
+
+static constexpr const StatNameEntry *FindEmbedded(string_view name) {
+    auto it = lower_bound(embeddedStatNames.begin(), embeddedStatNames.end(), name,
+                          [](const StatNameEntry &entry, string_view key) { return entry.name < key; });
+    return it != embeddedStatNames.end() && it->name == name ? &*it : nullptr;
+}
+
+void StatDescriptionIndex::Add(string_view name, string_view description) {
+    overrideStats.insert_or_assign(string(name), string(description));
+}
+
+optional<string_view> StatDescriptionIndex::Find(string_view name) const {
+    if (!overrideStats.empty()) {
+        auto it = overrideStats.find(name);
+        if (it != overrideStats.end()) {
+            return it->second;
+        }
+    }
+    if (auto entry = FindEmbedded(name)) {
+        return entry->description;
+    }
+    return nullopt;
+}
+
+string StatDescriptionIndex::Describe(const StatName &stat) const {
+    if (stat.category == StatCategory::Class) {
+        // Scout.mvm.max.iPlayTime is described by Class.mvm.max.iPlayTime
+        string key(classPlaceholder);
+        key += stat.gameType == GameType::coop ? ".mvm." : ".";
+        key += stat.statType == StatType::accum ? "accum.i" : "max.i";
+        key += stat.shortName;
+        auto description = Find(key);
+        if (!description) {
+            return "null";
+        }
+
+        string result;
+        size_t start = 0;
+        size_t pos = description->find(classPlaceholder);
+        while (pos != string_view::npos) {
+            result += description->substr(start, pos - start);
+            result += stat.className;
+            start = pos + classPlaceholder.size();
+            pos = description->find(classPlaceholder, start);
+        }
+        result += description->substr(start);
+        return result;
+    }
+    if (stat.category == StatCategory::Achievement) {
+        auto description = Find(stat.fullName);
+        return description ? string(*description) : "null";
+    }
+    return "";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "data_classes.h"
+#include "stat_classifier.h"
+
+// one name -> description pair of the table generated from stat_names.json
+struct StatNameEntry {
+    std::string_view name;
+    std::string_view description;
+};
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const noexcept {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+// stat descriptions: the stat_names.json table compiled into the binary, plus optional overrides
+// loaded at runtime that take precedence over it. Class stats are described by templates like
+// "Class.accum.iX" / "Class.mvm.max.iX" with "Class" standing in for the class name.
+class StatDescriptionIndex {
+public:
+    // adds or replaces a description on top of the embedded table
+    void Add(std::string_view name, std::string_view description);
+
+    std::optional<std::string_view> Find(std::string_view name) const;
+
+    // description of a classified class or achievement stat, "null" if there is none
+    std::string Describe(const StatName& stat) const;
+
+    size_t overrides() const { return overrideStats.size(); }
+
+private:
+    std::unordered_map<std::string, std::string, StringHash, std::equal_to<>> overrideStats;
+};
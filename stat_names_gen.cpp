@@ -0,0 +1,93 @@
+// build tool: turns stat_names.json into a header with a sorted constexpr name -> description table
+// usage: stat-names-gen <stat_names.json> <output header>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Poco/JSON/Parser.h>
+
+using namespace std;
+
+// octal escapes for everything outside printable ASCII, so the table doesn't depend on the
+// compiler's source character set
+static string CppStringLiteral(const string &str) {
+    string literal = "\"";
+    for (unsigned char c: str) {
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += (char) c;
+        } else if (c < 0x20 || c > 0x7e) {
+            char escape[5];
+            snprintf(escape, sizeof(escape), "\\%03o", c);
+            literal += escape;
+        } else {
+            literal += (char) c;
+        }
+    }
+    return literal + "\"";
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <stat_names.json> <output header>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ifstream stream(argv[1]);
+    if (!stream) {
+        fprintf(stderr, "Error: could not open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    stringstream buf;
+    buf << stream.rdbuf();
+
+    vector<pair<string, string>> entries;
+    try {
+        Poco::JSON::Parser parser;
+        Poco::Dynamic::Var parseResult = parser.parse(buf.str());
+        auto stats = parseResult.extract<Poco::JSON::Object::Ptr>()->getArray("stats");
+        for (int i = 0; i < stats->size(); i++) {
+            auto stat = stats->getObject(i);
+            entries.emplace_back(stat->getValue<string>("name"), stat->getValue<string>("description"));
+        }
+    } catch (const exception &e) {
+        fprintf(stderr, "Error: could not parse %s: %s\n", argv[1], e.what());
+        return EXIT_FAILURE;
+    }
+
+    // like loading the file at runtime did, a later duplicate replaces an earlier one
+    stable_sort(entries.begin(), entries.end(), [](auto &a, auto &b) { return a.first < b.first; });
+    vector<pair<string, string>> unique;
+    for (auto &entry: entries) {
+        if (!unique.empty() && unique.back().first == entry.first) {
+            fprintf(stderr, "Warning: %s is listed more than once\n", entry.first.c_str());
+            unique.back() = std::move(entry);
+        } else {
+            unique.push_back(std::move(entry));
+        }
+    }
+
+    ofstream out(argv[2], ios::binary);
+    out << "#pragma once\n\n"
+        << "// generated from stat_names.json by stat-names-gen, do not edit\n\n"
+        << "#include <array>\n\n"
+        << "#include \"stat_index.h\"\n\n"
+        << "// sorted by name\n"
+        << "inline constexpr std::array<StatNameEntry, " << unique.size() << "> embeddedStatNames = {{\n";
+    for (auto &[name, description]: unique) {
+        out << "        {" << CppStringLiteral(name) << ", " << CppStringLiteral(description) << "},\n";
+    }
+    out << "}};\n";
+
+    out.close();
+    if (!out) {
+        fprintf(stderr, "Error: could not write %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
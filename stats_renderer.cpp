@@ -0,0 +1,268 @@
+#include "stats_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "main.h"
+#include "aggregate.h"
+#include "data_classes.h"
+#include "logging.h"
+#include "stat_catalog.h"
+#include "stat_format.h"
+
+using namespace std;
+
+StatsRenderer::StatsRenderer(const string &templateDir) : env(templateDir) {
+    pvpClassStatTemp = env.parse_template("class_stats_pvp.md");
+    mvmClassStatTemp = env.parse_template("class_stats_mvm.md");
+    mapStatTemp = env.parse_template("map_stats.md");
+    achievementStatTemp = env.parse_template("achievement_stats.md");
+    pvpClassHeaderTemp = env.parse("- {{ pvpClass }}");
+    mvmClassHeaderTemp = env.parse("- {{ mvmClass }}");
+    aggregateStatTemp = env.parse_template("aggregate_stats.md");
+    aggregateHeaderTemp = env.parse("- {{ group }}");
+    rankingTemp = env.parse("{{ rank }}. [{{ steamId }}](https://steamcommunity.com/profiles/{{ steamId }}): {{ value }}");
+
+    // for templates that want a number shown differently, e.g. {{ thousands(achievementStatValue) }}.
+    // Values that are text already, like play times, are left as they are.
+    env.add_callback("thousands", 1, [](inja::Arguments &args) -> inja::json {
+        const inja::json &value = *args.at(0);
+        if (!value.is_number()) {
+            return value;
+        }
+        return FormatToString(FormatThousands, value.get<int64_t>(), ',');
+    });
+    env.add_callback("hhmmss", 1, [](inja::Arguments &args) -> inja::json {
+        const inja::json &value = *args.at(0);
+        if (!value.is_number()) {
+            return value;
+        }
+        return FormatToString(FormatHhMmSs, value.get<int64_t>());
+    });
+    env.add_callback("duration", 1, [](inja::Arguments &args) -> inja::json {
+        const inja::json &value = *args.at(0);
+        if (!value.is_number()) {
+            return value;
+        }
+        return FormatToString(FormatHumanDuration, dseconds(value.get<double>()));
+    });
+}
+
+void StatsRenderer::Render(const PlayerStats &stats, const string &user, ostream &result) const {
+    RenderTitle(user, result);
+    RenderSections(stats, result);
+}
+
+void StatsRenderer::RenderTitle(const string &user, ostream &result) const {
+    result << "## TF2 Statistics for " << user << "\n\n---\n";
+}
+
+void StatsRenderer::RenderChanges(const PlayerStats &changes, const string &user, const string &period,
+                                  ostream &result) const {
+    result << "## Changes in the TF2 Statistics for " << user << "\n\n" << period << "\n\n---\n";
+    RenderSections(changes, result);
+}
+
+void StatsRenderer::RenderSections(const PlayerStats &stats, ostream &result) const {
+    for (StatSection section: statSections) {
+        RenderSection(section, stats, result);
+    }
+}
+
+void StatsRenderer::RenderSection(StatSection section, const PlayerStats &stats, ostream &result) const {
+    using inja::json;
+
+    const StatCatalog &catalog = StatCatalog::Get();
+    switch (section) {
+        case StatSection::Pvp: {
+            json pvpData;
+            result << "### PvP\n\n";
+
+            // class stats are ordered by class, a header goes before the first stat of each one
+            const StatInfo *previous = nullptr;
+            for (auto [pvpstat, value]: catalog.View(stats.pvpStats)) {
+                pvpData["pvpClass"] = pvpstat.className;
+                pvpData["pvpClassStatDescription"] = pvpstat.description;
+                if (pvpstat.shortName == "PlayTime") {
+                    pvpData["pvpClassStatValue"] = FormatToString(FormatHhMmSs, value);
+                } else {
+                    pvpData["pvpClassStatValue"] = value;
+                }
+
+                Log(Verbosity::Verbose, "Parsing %s...\n", pvpstat.fullName.c_str());
+
+                if (!previous || previous->tfClass != pvpstat.tfClass) {
+                    env.render_to(result, pvpClassHeaderTemp, pvpData) << "\n";
+                }
+                env.render_to(result, pvpClassStatTemp, pvpData) << "\n";
+                previous = &pvpstat;
+            }
+            break;
+        }
+        case StatSection::Mvm: {
+            json mvmData;
+            result << "---\n\n## MvM\n\n";
+
+            const StatInfo *previous = nullptr;
+            for (auto [mvmstat, value]: catalog.View(stats.mvmStats)) {
+                mvmData["mvmClass"] = mvmstat.className;
+                mvmData["mvmClassStatDescription"] = mvmstat.description;
+                if (mvmstat.shortName == "PlayTime") {
+                    mvmData["mvmClassStatValue"] = FormatToString(FormatHhMmSs, value);
+                } else {
+                    mvmData["mvmClassStatValue"] = value;
+                }
+
+                Log(Verbosity::Verbose, "Parsing %s...\n", mvmstat.fullName.c_str());
+
+                if (!previous || previous->tfClass != mvmstat.tfClass) {
+                    env.render_to(result, mvmClassHeaderTemp, mvmData) << "\n";
+                }
+                env.render_to(result, mvmClassStatTemp, mvmData) << "\n";
+                previous = &mvmstat;
+            }
+            break;
+        }
+        case StatSection::Maps: {
+            json mapData;
+            result << "---\n\n## Maps\n\n";
+
+            for (auto [mapstat, playTime]: catalog.View(stats.mapStats)) {
+                mapData["mapName"] = mapstat.mapName;
+                mapData["playTime"] = FormatToString(FormatHhMmSs, playTime);
+
+                Log(Verbosity::Verbose, "Parsing %s...\n", mapstat.mapName.c_str());
+                env.render_to(result, mapStatTemp, mapData) << "\n";
+            }
+            break;
+        }
+        case StatSection::Achievements: {
+            json achData;
+            result << "---\n\n## Achievements\n\n";
+
+            for (auto [achievementstat, value]: catalog.View(stats.achievementStats)) {
+                achData["achievementStatDescription"] = achievementstat.description;
+                achData["achievementStatValue"] = value;
+
+                Log(Verbosity::Verbose, "Parsing %s...\n", achievementstat.fullName.c_str());
+                env.render_to(result, achievementStatTemp, achData) << "\n";
+            }
+            break;
+        }
+    }
+}
+
+void StatsRenderer::RenderAggregates(const vector<StatAggregate> &aggregates, size_t players, ostream &result) const {
+    using inja::json;
+
+    struct Row {
+        const StatAggregate *aggregate;
+        StatName parsed;
+    };
+    vector<Row> pvpRows;
+    vector<Row> mvmRows;
+    vector<Row> mapRows;
+    for (auto &aggregate: aggregates) {
+        Row row{&aggregate, ClassifyStat(aggregate.name)};
+        if (row.parsed.category == StatCategory::Map) {
+            mapRows.push_back(row);
+        } else {
+            (row.parsed.gameType == GameType::pvp ? pvpRows : mvmRows).push_back(row);
+        }
+    }
+    // by class, and within a class in the order the export first saw them, like a single player's
+    auto byClass = [](const Row &a, const Row &b) { return a.parsed.tfClass < b.parsed.tfClass; };
+    stable_sort(pvpRows.begin(), pvpRows.end(), byClass);
+    stable_sort(mvmRows.begin(), mvmRows.end(), byClass);
+    auto gamemodeName = [](const Row &row) {
+        auto it = gamemodes.find(string(row.parsed.gamemode));
+        return it != gamemodes.end() ? it->second : string(row.parsed.gamemode);
+    };
+    stable_sort(mapRows.begin(), mapRows.end(), [&](const Row &a, const Row &b) {
+        return make_pair(gamemodeName(a), a.parsed.mapName) < make_pair(gamemodeName(b), b.parsed.mapName);
+    });
+
+    auto isTime = [](const Row &row) {
+        return row.parsed.category == StatCategory::Map || row.parsed.shortName == "PlayTime";
+    };
+    auto format = [](bool time, double value) -> json {
+        if (time) {
+            // fractions of a second are cut off
+            return FormatToString(FormatHhMmSs, (int64_t) value);
+        }
+        return llround(value);
+    };
+    auto describe = [](const Row &row) {
+        return row.aggregate->description.empty() ? row.aggregate->name : row.aggregate->description;
+    };
+
+    json data;
+    auto renderRow = [&](const Row &row, const string &description) {
+        const StatAggregate &aggregate = *row.aggregate;
+        const QuantileSketch &sketch = aggregate.sketch;
+        bool time = isTime(row);
+        data["statDescription"] = description;
+        data["players"] = sketch.count();
+        // exact, unlike the quantiles
+        data["sum"] = time ? json(FormatToString(FormatHhMmSs, aggregate.sum)) : json(aggregate.sum);
+        if (time || sketch.count() == 0) {
+            data["mean"] = format(time, sketch.count() ? (double) aggregate.sum / (double) sketch.count() : 0.0);
+        } else {
+            char mean[32];
+            snprintf(mean, sizeof(mean), "%.1f", (double) aggregate.sum / (double) sketch.count());
+            data["mean"] = mean;
+        }
+        data["median"] = format(time, sketch.Quantile(0.5));
+        data["p90"] = format(time, sketch.Quantile(0.9));
+        data["p99"] = format(time, sketch.Quantile(0.99));
+        data["min"] = format(time, sketch.min());
+        data["max"] = format(time, sketch.max());
+        env.render_to(result, aggregateStatTemp, data) << "\n";
+    };
+    auto renderClassRows = [&](const vector<Row> &rows) {
+        const Row *previous = nullptr;
+        for (auto &row: rows) {
+            if (!previous || previous->parsed.tfClass != row.parsed.tfClass) {
+                data["group"] = row.parsed.className;
+                env.render_to(result, aggregateHeaderTemp, data) << "\n";
+            }
+            renderRow(row, describe(row));
+            previous = &row;
+        }
+    };
+
+    result << "## TF2 Statistics across " << players << " players\n\n---\n### PvP\n\n";
+    renderClassRows(pvpRows);
+    result << "---\n\n## MvM\n\n";
+    renderClassRows(mvmRows);
+
+    result << "---\n\n## Maps\n\n";
+    string previousGamemode;
+    for (auto &row: mapRows) {
+        string gamemode = gamemodeName(row);
+        if (gamemode != previousGamemode) {
+            data["group"] = gamemode;
+            env.render_to(result, aggregateHeaderTemp, data) << "\n";
+            previousGamemode = gamemode;
+        }
+        renderRow(row, "Play time on " + string(row.parsed.mapName));
+    }
+
+    result << "---\n\n## Rankings\n";
+    for (auto rows: {&pvpRows, &mvmRows, &mapRows}) {
+        for (auto &row: *rows) {
+            const StatAggregate &aggregate = *row.aggregate;
+            if (aggregate.top.empty()) {
+                continue;
+            }
+            result << "\n### " << (row.parsed.category == StatCategory::Map
+                                     ? "Play time on " + string(row.parsed.mapName) : describe(row)) << "\n\n";
+            for (size_t i = 0; i < aggregate.top.size(); i++) {
+                data["rank"] = i + 1;
+                data["steamId"] = to_string(aggregate.top[i].steamId);
+                data["value"] = format(isTime(row), (double) aggregate.top[i].value);
+                env.render_to(result, rankingTemp, data) << "\n";
+            }
+        }
+    }
+}
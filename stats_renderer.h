@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+#include "data_classes.h"
+
+struct StatAggregate;
+
+// the Markdown templates in templates/, parsed once and shared by every player (and thread)
+// rendered in this process
+class StatsRenderer {
+public:
+    explicit StatsRenderer(const std::string &templateDir = "templates/");
+
+    void Render(const PlayerStats &stats, const std::string &user, std::ostream &result) const;
+    // Render is RenderTitle followed by every section. Each section starts with its own heading, so
+    // pages can be put together from sections rendered at different times.
+    void RenderTitle(const std::string &user, std::ostream &result) const;
+    void RenderSection(StatSection section, const PlayerStats &stats, std::ostream &result) const;
+    // what changed over period, changes holds the differences of the stats that did
+    void RenderChanges(const PlayerStats &changes, const std::string &user, const std::string &period,
+                       std::ostream &result) const;
+
+    // the class and map stats of many players, see aggregate.h
+    void RenderAggregates(const std::vector<StatAggregate> &aggregates, size_t players, std::ostream &result) const;
+
+private:
+    void RenderSections(const PlayerStats &stats, std::ostream &result) const;
+
+    // inja only reads the environment and templates while rendering, it just isn't declared const
+    mutable inja::Environment env;
+    inja::Template pvpClassStatTemp;
+    inja::Template mvmClassStatTemp;
+    inja::Template mapStatTemp;
+    inja::Template achievementStatTemp;
+    inja::Template pvpClassHeaderTemp;
+    inja::Template mvmClassHeaderTemp;
+    inja::Template aggregateStatTemp;
+    inja::Template aggregateHeaderTemp;
+    inja::Template rankingTemp;
+};
@@ -0,0 +1,65 @@
+#include "stats_serialization.h"
+
+#include "binary_io.h"
+#include "data_classes.h"
+#include "stat_catalog.h"
+
+using namespace std;
+
+static const uint32_t statsMagic = 0x53504654; // "TFPS"
+// 2: stat names and 64-bit values, descriptions come from the catalog
+static const uint8_t statsVersion = 2;
+
+static void WriteColumns(ByteWriter &writer, const StatColumns &columns) {
+    const StatCatalog &catalog = StatCatalog::Get();
+    writer.VarUInt(columns.size());
+    for (auto [stat, value]: catalog.View(columns)) {
+        writer.String(stat.fullName);
+        writer.VarInt(value);
+    }
+}
+
+static bool ReadColumns(ByteReader &reader, const StatDescriptionIndex &descriptions, StatColumns &columns) {
+    StatCatalog &catalog = StatCatalog::Get();
+    uint64_t count;
+    if (!reader.VarUInt(count)) return false;
+    columns = StatColumns();
+    for (uint64_t i = 0; i < count; i++) {
+        string_view name;
+        int64_t value;
+        if (!reader.String(name) || !reader.VarInt(value)) return false;
+        columns.Add(catalog.Intern(name, descriptions), value);
+    }
+    return true;
+}
+
+string SerializePlayerStats(const PlayerStats &stats) {
+    string data;
+    ByteWriter writer(data);
+    writer.U32(statsMagic);
+    writer.U8(statsVersion);
+
+    WriteColumns(writer, stats.pvpStats);
+    WriteColumns(writer, stats.mvmStats);
+    WriteColumns(writer, stats.mapStats);
+    WriteColumns(writer, stats.achievementStats);
+    return data;
+}
+
+static bool ReadHeader(ByteReader &reader) {
+    uint32_t magic;
+    uint8_t version;
+    return reader.U32(magic) && magic == statsMagic && reader.U8(version) && version == statsVersion;
+}
+
+bool IsCurrentStatsPayload(string_view data) {
+    ByteReader reader(data);
+    return ReadHeader(reader);
+}
+
+bool DeserializePlayerStats(string_view data, const StatDescriptionIndex &descriptions, PlayerStats &stats) {
+    ByteReader reader(data);
+    return ReadHeader(reader) && ReadColumns(reader, descriptions, stats.pvpStats) &&
+           ReadColumns(reader, descriptions, stats.mvmStats) && ReadColumns(reader, descriptions, stats.mapStats) &&
+           ReadColumns(reader, descriptions, stats.achievementStats) && reader.atEnd();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+class PlayerStats;
+class StatDescriptionIndex;
+
+// compact binary form of a player's stats: the name and value of every stat, reading it back needs
+// no JSON parsing, and stats already in the StatCatalog are not classified or described again
+std::string SerializePlayerStats(const PlayerStats &stats);
+// returns false if data is truncated or was written by an incompatible version
+bool DeserializePlayerStats(std::string_view data, const StatDescriptionIndex &descriptions, PlayerStats &stats);
+// cheap check of the header only, entries from older versions are not worth revalidating
+bool IsCurrentStatsPayload(std::string_view data);
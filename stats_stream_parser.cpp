@@ -0,0 +1,341 @@
+#include "stats_stream_parser.h"
+
+#include <charconv>
+#include <cstdlib>
+
+using namespace std;
+
+// deeper documents are rejected instead of growing the stack without bound
+static const size_t maxDepth = 256;
+
+static bool IsWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+StatsStreamParser::StatsStreamParser(StatSink sink, pmr::memory_resource *memory)
+        : sink(std::move(sink)), stack(memory), token(memory), statName(memory) {}
+
+bool StatsStreamParser::Feed(const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (state == State::Error) {
+            return false;
+        }
+        Step(data[i]);
+        offset++;
+    }
+    return state != State::Error;
+}
+
+bool StatsStreamParser::Finish() {
+    if (state == State::Number) {
+        EndNumber();
+    } else if (state == State::Literal) {
+        EndLiteral();
+    }
+    if (state == State::Error) {
+        return false;
+    }
+    if (state != State::Done) {
+        return Fail("unexpected end of input");
+    }
+    return true;
+}
+
+bool StatsStreamParser::Step(char c) {
+    while (true) {
+        switch (state) {
+            case State::Value:
+                if (IsWhitespace(c)) return true;
+                return BeginValue(c);
+
+            case State::ArrayValueOrEnd:
+                if (IsWhitespace(c)) return true;
+                if (c == ']') return CloseContainer(false);
+                return BeginValue(c);
+
+            case State::KeyOrEnd:
+                if (IsWhitespace(c)) return true;
+                if (c == '}') return CloseContainer(true);
+                [[fallthrough]];
+            case State::Key:
+                if (IsWhitespace(c)) return true;
+                if (c != '"') return Fail("expected object key");
+                stringIsKey = true;
+                bufferToken = stack.back().role != Role::Other;
+                token.clear();
+                highSurrogate = 0;
+                state = State::String;
+                return true;
+
+            case State::Colon:
+                if (IsWhitespace(c)) return true;
+                if (c != ':') return Fail("expected ':'");
+                state = State::Value;
+                return true;
+
+            case State::AfterValue:
+                if (IsWhitespace(c)) return true;
+                if (c == ',') {
+                    state = stack.back().isObject ? State::Key : State::Value;
+                    return true;
+                }
+                if (c == '}' || c == ']') return CloseContainer(c == '}');
+                return Fail("expected ',' or closing bracket");
+
+            case State::String:
+                if (c == '"') {
+                    EndString();
+                    return true;
+                }
+                if (c == '\\') {
+                    state = State::Escape;
+                    return true;
+                }
+                if ((unsigned char) c < 0x20) return Fail("control character in string");
+                if (bufferToken) token += c;
+                return true;
+
+            case State::Escape:
+                state = State::String;
+                switch (c) {
+                    case '"': case '\\': case '/':
+                        if (bufferToken) token += c;
+                        return true;
+                    case 'b': if (bufferToken) token += '\b'; return true;
+                    case 'f': if (bufferToken) token += '\f'; return true;
+                    case 'n': if (bufferToken) token += '\n'; return true;
+                    case 'r': if (bufferToken) token += '\r'; return true;
+                    case 't': if (bufferToken) token += '\t'; return true;
+                    case 'u':
+                        unicodeValue = 0;
+                        unicodeDigits = 0;
+                        state = State::Unicode;
+                        return true;
+                    default:
+                        return Fail("invalid escape sequence");
+                }
+
+            case State::Unicode: {
+                int digit = HexValue(c);
+                if (digit < 0) return Fail("invalid \\u escape");
+                unicodeValue = (unicodeValue << 4) | (uint32_t) digit;
+                if (++unicodeDigits == 4) {
+                    state = State::String;
+                    if (bufferToken) AppendCodePoint(unicodeValue);
+                }
+                return true;
+            }
+
+            case State::Number:
+                if (IsNumberChar(c)) {
+                    if (bufferToken) token += c;
+                    return true;
+                }
+                if (!EndNumber()) return false;
+                continue;
+
+            case State::Literal:
+                if (c >= 'a' && c <= 'z') {
+                    token += c;
+                    if (token.size() > 5) return Fail("invalid literal");
+                    return true;
+                }
+                if (!EndLiteral()) return false;
+                continue;
+
+            case State::Done:
+                if (IsWhitespace(c)) return true;
+                return Fail("trailing data after document");
+
+            case State::Error:
+                return false;
+        }
+    }
+}
+
+bool StatsStreamParser::BeginValue(char c) {
+    const Frame *top = stack.empty() ? nullptr : &stack.back();
+    // only the name and value of a stat are ever looked at
+    bool wanted = top && top->role == Role::Stat && (top->key == Key::Name || top->key == Key::Value);
+
+    if (c == '{' || c == '[') {
+        if (stack.size() >= maxDepth) return Fail("document nested too deeply");
+        OpenContainer(c == '{');
+        return true;
+    }
+    if (c == '"') {
+        stringIsKey = false;
+        bufferToken = wanted;
+        token.clear();
+        highSurrogate = 0;
+        state = State::String;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        bufferToken = wanted;
+        token.clear();
+        if (bufferToken) token += c;
+        state = State::Number;
+        return true;
+    }
+    if (c >= 'a' && c <= 'z') {
+        token.clear();
+        token += c;
+        state = State::Literal;
+        return true;
+    }
+    return Fail("unexpected character");
+}
+
+void StatsStreamParser::OpenContainer(bool isObject) {
+    Role role = Role::Other;
+    if (stack.empty()) {
+        role = isObject ? Role::Root : Role::Other;
+    } else {
+        const Frame &parent = stack.back();
+        if (parent.role == Role::Root && parent.key == Key::PlayerStats && isObject) {
+            role = Role::PlayerStats;
+        } else if (parent.role == Role::PlayerStats && parent.key == Key::Stats && !isObject) {
+            role = Role::StatsArray;
+        } else if (parent.role == Role::StatsArray && isObject) {
+            role = Role::Stat;
+        }
+    }
+
+    if (role == Role::Stat) {
+        hasName = false;
+        hasValue = false;
+    }
+    stack.push_back({isObject, role, Key::Other});
+    state = isObject ? State::KeyOrEnd : State::ArrayValueOrEnd;
+}
+
+bool StatsStreamParser::CloseContainer(bool isObject) {
+    if (stack.empty() || stack.back().isObject != isObject) {
+        return Fail("mismatched closing bracket");
+    }
+    if (stack.back().role == Role::Stat && hasName && hasValue) {
+        sink(statName, statValue);
+    }
+    stack.pop_back();
+    ValueDone();
+    return true;
+}
+
+void StatsStreamParser::EndString() {
+    if (stringIsKey) {
+        Frame &top = stack.back();
+        top.key = Key::Other;
+        if (bufferToken) {
+            if (top.role == Role::Root && token == "playerstats") {
+                top.key = Key::PlayerStats;
+            } else if (top.role == Role::PlayerStats && token == "stats") {
+                top.key = Key::Stats;
+            } else if (top.role == Role::Stat && token == "name") {
+                top.key = Key::Name;
+            } else if (top.role == Role::Stat && token == "value") {
+                top.key = Key::Value;
+            }
+        }
+        state = State::Colon;
+        return;
+    }
+
+    if (bufferToken) {
+        if (stack.back().key == Key::Name) {
+            statName.swap(token);
+            hasName = true;
+        } else {
+            // a value sent as a string, e.g. "123"
+            auto result = from_chars(token.data(), token.data() + token.size(), statValue);
+            hasValue = result.ec == errc() && result.ptr == token.data() + token.size();
+        }
+    }
+    ValueDone();
+}
+
+bool StatsStreamParser::EndNumber() {
+    if (bufferToken) {
+        if (stack.back().key == Key::Value) {
+            auto result = from_chars(token.data(), token.data() + token.size(), statValue);
+            if (result.ec != errc() || result.ptr != token.data() + token.size()) {
+                // fractions and exponents are truncated like an int conversion would
+                char *end = nullptr;
+                double value = strtod(token.c_str(), &end);
+                if (end != token.c_str() + token.size()) return Fail("invalid number");
+                // 2^63 and beyond (or below -2^63) has no int64_t to convert to
+                if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) {
+                    return Fail("number out of range");
+                }
+                statValue = (int64_t) value;
+            }
+            hasValue = true;
+        } else {
+            // a number where the stat name should be
+            hasName = false;
+        }
+    }
+    ValueDone();
+    return true;
+}
+
+bool StatsStreamParser::EndLiteral() {
+    if (token != "true" && token != "false" && token != "null") {
+        return Fail("invalid literal");
+    }
+    ValueDone();
+    return true;
+}
+
+void StatsStreamParser::ValueDone() {
+    state = stack.empty() ? State::Done : State::AfterValue;
+}
+
+void StatsStreamParser::AppendCodePoint(uint32_t codePoint) {
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+        highSurrogate = codePoint;
+        return;
+    }
+    if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+        if (!highSurrogate) {
+            return;
+        }
+        codePoint = 0x10000 + ((highSurrogate - 0xD800) << 10) + (codePoint - 0xDC00);
+    }
+    highSurrogate = 0;
+
+    if (codePoint < 0x80) {
+        token += (char) codePoint;
+    } else if (codePoint < 0x800) {
+        token += (char) (0xC0 | (codePoint >> 6));
+        token += (char) (0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        token += (char) (0xE0 | (codePoint >> 12));
+        token += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        token += (char) (0x80 | (codePoint & 0x3F));
+    } else {
+        token += (char) (0xF0 | (codePoint >> 18));
+        token += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+        token += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        token += (char) (0x80 | (codePoint & 0x3F));
+    }
+}
+
+bool StatsStreamParser::Fail(const char *message) {
+    if (state != State::Error) {
+        errorMessage = string(message) + " at byte " + to_string(offset);
+        state = State::Error;
+    }
+    return false;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// incremental JSON parser for GetUserStatsForGame responses. The body can be fed in chunks of any
+// size (e.g. straight from a curl write callback) and every {"name", "value"} object in
+// playerstats.stats is handed to the sink as soon as its closing brace is seen. Nothing else in
+// the document is kept, so memory use does not grow with the size of the response.
+class StatsStreamParser {
+public:
+    using StatSink = std::function<void(std::string_view name, int64_t value)>;
+
+    // the buffers for tokens and nesting come from memory, which has to outlive the parser
+    explicit StatsStreamParser(StatSink sink, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+    // returns false once the input is known to be malformed
+    bool Feed(const char *data, size_t size);
+    // returns true if a complete JSON document was fed
+    bool Finish();
+
+    bool failed() const { return state == State::Error; }
+    const std::string &error() const { return errorMessage; }
+    size_t bytesParsed() const { return offset; }
+
+private:
+    // where a container sits in the response, only these need their keys looked at
+    enum class Role : uint8_t { Other, Root, PlayerStats, StatsArray, Stat };
+    enum class Key : uint8_t { Other, PlayerStats, Stats, Name, Value };
+    enum class State : uint8_t {
+        Value, ArrayValueOrEnd, KeyOrEnd, Key, Colon, AfterValue,
+        String, Escape, Unicode, Number, Literal, Done, Error
+    };
+
+    struct Frame {
+        bool isObject;
+        Role role;
+        Key key;
+    };
+
+    bool Step(char c);
+    bool BeginValue(char c);
+    void OpenContainer(bool isObject);
+    bool CloseContainer(bool isObject);
+    void EndString();
+    bool EndNumber();
+    bool EndLiteral();
+    void ValueDone();
+    void AppendCodePoint(uint32_t codePoint);
+    bool Fail(const char *message);
+
+    StatSink sink;
+    State state = State::Value;
+    std::pmr::vector<Frame> stack;
+
+    // current string/number/literal token, only filled when it matters
+    std::pmr::string token;
+    bool bufferToken = false;
+    bool stringIsKey = false;
+    uint32_t unicodeValue = 0;
+    int unicodeDigits = 0;
+    uint32_t highSurrogate = 0;
+
+    // the stat object currently being parsed
+    std::pmr::string statName;
+    int64_t statValue = 0;
+    bool hasName = false;
+    bool hasValue = false;
+
+    size_t offset = 0;
+    std::string errorMessage;
+};
@@ -0,0 +1,187 @@
+#include "stats_writer.h"
+
+#include <charconv>
+#include <cstdint>
+#include <sstream>
+
+#include "data_classes.h"
+#include "stat_catalog.h"
+
+using namespace std;
+
+static void WriteRaw(ostream &out, string_view text) {
+    out.write(text.data(), (streamsize) text.size());
+}
+
+static void WriteNumber(ostream &out, int64_t value) {
+    char buffer[24];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.write(buffer, result.ptr - buffer);
+}
+
+void WriteJsonString(ostream &out, string_view text) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out.put('"');
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        auto c = (unsigned char) text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        WriteRaw(out, text.substr(start, i - start));
+        switch (c) {
+            case '"': WriteRaw(out, "\\\""); break;
+            case '\\': WriteRaw(out, "\\\\"); break;
+            case '\b': WriteRaw(out, "\\b"); break;
+            case '\f': WriteRaw(out, "\\f"); break;
+            case '\n': WriteRaw(out, "\\n"); break;
+            case '\r': WriteRaw(out, "\\r"); break;
+            case '\t': WriteRaw(out, "\\t"); break;
+            default: {
+                char escape[] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF]};
+                out.write(escape, sizeof(escape));
+            }
+        }
+        start = i + 1;
+    }
+    WriteRaw(out, text.substr(start));
+    out.put('"');
+}
+
+// quoted only when it has to be, quotes inside doubled (RFC 4180)
+static void WriteCsvField(ostream &out, string_view text) {
+    if (text.find_first_of(",\"\r\n") == string_view::npos) {
+        WriteRaw(out, text);
+        return;
+    }
+    out.put('"');
+    for (size_t start = 0;;) {
+        size_t quote = text.find('"', start);
+        WriteRaw(out, text.substr(start, quote - start));
+        if (quote == string_view::npos) {
+            break;
+        }
+        WriteRaw(out, "\"\"");
+        start = quote + 1;
+    }
+    out.put('"');
+}
+
+optional<OutputFormat> ParseOutputFormat(string_view name) {
+    for (OutputFormat format: {OutputFormat::Markdown, OutputFormat::Json, OutputFormat::Csv, OutputFormat::Ndjson}) {
+        if (name == FormatName(format)) {
+            return format;
+        }
+    }
+    return nullopt;
+}
+
+const char *FormatName(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::Json:
+            return "json";
+        case OutputFormat::Csv:
+            return "csv";
+        case OutputFormat::Ndjson:
+            return "ndjson";
+        default:
+            return "md";
+    }
+}
+
+// the elements of a "pvp" or "mvm" array
+static void WriteClassStatsJson(const StatColumns &columns, ostream &out) {
+    bool first = true;
+    for (auto [stat, value]: StatCatalog::Get().View(columns)) {
+        WriteRaw(out, first ? "{\"class\":" : ",{\"class\":");
+        WriteJsonString(out, stat.className);
+        WriteRaw(out, ",\"description\":");
+        WriteJsonString(out, stat.description);
+        WriteRaw(out, ",\"name\":");
+        WriteJsonString(out, stat.fullName);
+        WriteRaw(out, ",\"stat\":");
+        WriteJsonString(out, stat.shortName);
+        WriteRaw(out, ",\"value\":");
+        WriteNumber(out, value);
+        out.put('}');
+        first = false;
+    }
+}
+
+void WriteStatsJson(const PlayerStats &stats, string_view steamId, string_view user, ostream &out) {
+    const StatCatalog &catalog = StatCatalog::Get();
+    WriteRaw(out, "{\"achievements\":[");
+    bool first = true;
+    for (auto [stat, value]: catalog.View(stats.achievementStats)) {
+        WriteRaw(out, first ? "{\"description\":" : ",{\"description\":");
+        WriteJsonString(out, stat.description);
+        WriteRaw(out, ",\"name\":");
+        WriteJsonString(out, stat.fullName);
+        WriteRaw(out, ",\"value\":");
+        WriteNumber(out, value);
+        out.put('}');
+        first = false;
+    }
+
+    WriteRaw(out, "],\"maps\":[");
+    first = true;
+    for (auto [stat, playTime]: catalog.View(stats.mapStats)) {
+        WriteRaw(out, first ? "{\"gamemode\":" : ",{\"gamemode\":");
+        WriteJsonString(out, stat.gamemode);
+        WriteRaw(out, ",\"map\":");
+        WriteJsonString(out, stat.mapName);
+        WriteRaw(out, ",\"name\":");
+        WriteJsonString(out, stat.fullName);
+        WriteRaw(out, ",\"playTime\":");
+        WriteNumber(out, playTime);
+        out.put('}');
+        first = false;
+    }
+
+    WriteRaw(out, "],\"mvm\":[");
+    WriteClassStatsJson(stats.mvmStats, out);
+    WriteRaw(out, "],\"pvp\":[");
+    WriteClassStatsJson(stats.pvpStats, out);
+    WriteRaw(out, "],\"steamId\":");
+    WriteJsonString(out, steamId);
+    WriteRaw(out, ",\"user\":");
+    WriteJsonString(out, user);
+    out.put('}');
+}
+
+void WriteCsvHeader(ostream &out) {
+    WriteRaw(out, "steamid,user,section,name,class,stat,map,gamemode,description,value\n");
+}
+
+void WriteStatsCsv(const PlayerStats &stats, string_view steamId, string_view user, ostream &out) {
+    static const char *sectionNames[] = {"pvp", "mvm", "map", "achievement"};
+    const StatCatalog &catalog = StatCatalog::Get();
+    // the same at the start of every row, quoted once
+    ostringstream player;
+    WriteCsvField(player, steamId);
+    player.put(',');
+    WriteCsvField(player, user);
+    player.put(',');
+    string prefix = std::move(player).str();
+    for (StatSection section: statSections) {
+        for (auto [stat, value]: catalog.View(stats.section(section))) {
+            WriteRaw(out, prefix);
+            WriteRaw(out, sectionNames[(size_t) section]);
+            out.put(',');
+            WriteCsvField(out, stat.fullName);
+            out.put(',');
+            WriteCsvField(out, stat.className);
+            out.put(',');
+            WriteCsvField(out, stat.category == StatCategory::Class ? string_view(stat.shortName) : "");
+            out.put(',');
+            WriteCsvField(out, stat.mapName);
+            out.put(',');
+            WriteCsvField(out, stat.gamemode);
+            out.put(',');
+            WriteCsvField(out, section == StatSection::Maps ? "" : string_view(stat.description));
+            out.put(',');
+            WriteNumber(out, value);
+            out.put('\n');
+        }
+    }
+}
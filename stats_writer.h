@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+class PlayerStats;
+
+enum class OutputFormat {
+    // the templates in templates/, see StatsRenderer
+    Markdown,
+    // one object per player
+    Json,
+    // one row per stat, under a header row
+    Csv,
+    // one JSON object per player and line, so players can be consumed while a batch is running
+    Ndjson
+};
+
+// "md", "json", "csv" or "ndjson"
+std::optional<OutputFormat> ParseOutputFormat(std::string_view name);
+// the same names, used as file extensions
+const char *FormatName(OutputFormat format);
+
+// the machine-readable formats are written straight from PlayerStats, numbers with std::to_chars and
+// strings escaped by hand, without a DOM or the template engine in between. Keys come out sorted.
+void WriteStatsJson(const PlayerStats &stats, std::string_view steamId, std::string_view user, std::ostream &out);
+void WriteCsvHeader(std::ostream &out);
+void WriteStatsCsv(const PlayerStats &stats, std::string_view steamId, std::string_view user, std::ostream &out);
+
+// quoted, with the escapes JSON requires and nothing more, UTF-8 passes through as it is
+void WriteJsonString(std::ostream &out, std::string_view text);
@@ -0,0 +1,254 @@
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include <curl/curl.h>
+#include <Poco/JSON/Parser.h>
+
+#include "main.h"
+#include "http_client.h"
+#include "logging.h"
+#include "player_stats_builder.h"
+#include "profiler.h"
+#include "request_scheduler.h"
+#include "response_cache.h"
+#include "data_classes.h"
+#include "stat_catalog.h"
+#include "stat_index.h"
+#include "stats_serialization.h"
+#include "stats_stream_parser.h"
+
+using namespace std;
+
+static void PrintRequestError(const ScheduledResponse &response, const string &steamId) {
+    if (response.overBudget) {
+        fprintf(stderr, "Error: the daily API budget is spent, no request was made for %s\n", steamId.c_str());
+    } else if (response.result.status >= 400) {
+        fprintf(stderr, "Error: request for %s failed with HTTP %ld\n", steamId.c_str(), response.result.status);
+    } else {
+        fprintf(stderr, "Error: request for %s failed: %s\n", steamId.c_str(),
+                curl_easy_strerror(response.result.code));
+    }
+}
+
+bool LoadStatNames(const string &path, StatDescriptionIndex &descriptions) {
+    ifstream stream(path);
+    stringstream buf;
+    Poco::JSON::Parser parser;
+    Poco::Dynamic::Var parseResult;
+    string json;
+
+    if (!stream) {
+        fprintf(stderr, "Error: could not open %s\n", path.c_str());
+        return false;
+    }
+    buf << stream.rdbuf();
+    json = buf.str();
+    ProfileScope parse(Phase::Parse, path);
+    parse.AddBytes(json.size());
+    try {
+        parseResult = parser.parse(json);
+        auto stats = parseResult.extract<Poco::JSON::Object::Ptr>()->getArray("stats");
+
+        for (int i = 0; i < stats->size(); i++) {
+            auto stat = stats->getObject(i);
+            auto name = stat->getValue<string>("name");
+            auto desc = stat->getValue<string>("description");
+            descriptions.Add(name, desc);
+        }
+    } catch (const exception &e) {
+        fprintf(stderr, "Error: could not parse %s: %s\n", path.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool InternStat(const StatDescriptionIndex &descriptions, string_view statName, int64_t value, StatId &id,
+                StatSection &section) {
+    Log(Verbosity::Verbose, "Stat: %.*s\n", (int) statName.size(), statName.data());
+    StatCatalog &catalog = StatCatalog::Get();
+    id = catalog.Intern(statName, descriptions);
+    const StatInfo &stat = catalog[id];
+    if (stat.category == StatCategory::Class) {
+        const char *gameTypeName = stat.gameType == GameType::pvp ? "pvp" : "mvm";
+        Log(Verbosity::Verbose, "Got %.*s %s %s stat with value %lld\nDescription: %s\n\n",
+            (int) stat.className.size(), stat.className.data(), stat.shortName.c_str(), gameTypeName,
+            (long long) value, stat.description.c_str());
+        section = stat.gameType == GameType::pvp ? StatSection::Pvp : StatSection::Mvm;
+        return true;
+    } else if (stat.category == StatCategory::Map) {
+        Log(Verbosity::Verbose, "Got %s stat for gamemode %s with time %lld\n\n", stat.mapName.c_str(),
+            stat.gamemode.c_str(), (long long) value);
+        section = StatSection::Maps;
+        return true;
+    } else if (stat.category == StatCategory::Achievement) {
+        Log(Verbosity::Verbose, "Got %s achievement stat with value %lld\nDescription: %s\n\n",
+            stat.fullName.c_str(), (long long) value, stat.description.c_str());
+        section = StatSection::Achievements;
+        return true;
+    }
+    return false;
+}
+
+void AddStat(PlayerStats &playerStats, const StatDescriptionIndex &descriptions, string_view statName,
+             int64_t value) {
+    StatId id;
+    StatSection section;
+    if (InternStat(descriptions, statName, value, id, section)) {
+        playerStats.section(section).Add(id, value);
+    }
+}
+
+// its arena is reused by every player the thread parses
+static PlayerStatsBuilder &ThreadBuilder() {
+    thread_local PlayerStatsBuilder builder;
+    return builder;
+}
+
+PlayerStats ParsePlayerStats(const string &json, const StatDescriptionIndex &descriptions) {
+    PlayerStatsBuilder &builder = ThreadBuilder();
+    builder.Reset(descriptions);
+    if (!builder.Feed(json.data(), json.size()) || !builder.Finish()) {
+        throw runtime_error("malformed stats response: " + builder.error());
+    }
+    return builder.Build();
+}
+
+optional<PlayerStats> FetchResults(const string &apiUrl, const StatDescriptionIndex &descriptions,
+                                   const ResponseCache *cache, const string &steamId) {
+    ProfileScope fetch(Phase::Fetch, steamId);
+    PlayerStats playerStats;
+    optional<CacheEntry> cached;
+    if (cache) {
+        cached = cache->Load(statsCacheEndpoint, steamId);
+        if (cached && !IsCurrentStatsPayload(cached->payload)) {
+            // written by an older version, a 304 would leave nothing to use
+            cached.reset();
+        }
+        if (cached && cache->IsFresh(*cached)) {
+            if (DeserializePlayerStats(cached->payload, descriptions, playerStats)) {
+                Log(Verbosity::Normal, "Using cached stats for %s\n\n", steamId.c_str());
+                return playerStats;
+            }
+            playerStats = PlayerStats();
+        }
+        if (cache->offline()) {
+            fprintf(stderr, "Error: stats for %s are not in the cache\n", steamId.c_str());
+            return nullopt;
+        }
+    }
+
+    // the body is parsed while it is being received, error pages never reach the parser. When an
+    // identical request shares this one, the sending thread feeds this thread's builder.
+    PlayerStatsBuilder &builder = ThreadBuilder();
+    builder.Reset(descriptions);
+    ResponseSink sink{
+            [&](const char *data, size_t size) {
+                ProfileScope parse(Phase::Parse);
+                parse.AddBytes(size);
+                return builder.Feed(data, size);
+            },
+            [&] { builder.Reset(descriptions); }};
+    curl_slist *headers = cached ? ConditionalRequestHeaders(*cached) : nullptr;
+    ScheduledResponse response = RequestScheduler::Get().Fetch(apiUrl, headers, sink, RequestPriority::Interactive,
+                                                               steamId);
+    curl_slist_free_all(headers);
+    const HttpResult &result = response.result;
+    if (builder.failed()) {
+        fprintf(stderr, "Error: malformed stats response: %s\n", builder.error().c_str());
+        return nullopt;
+    }
+    if (!response.ok()) {
+        PrintRequestError(response, steamId);
+        return nullopt;
+    }
+    if (result.status == 304 && cached && DeserializePlayerStats(cached->payload, descriptions, playerStats)) {
+        Log(Verbosity::Normal, "Cached stats for %s are still current\n\n", steamId.c_str());
+        cache->Store(statsCacheEndpoint, steamId, *cached);
+        return playerStats;
+    }
+    Log(Verbosity::Normal, "%lu bytes retrieved from request\n\n", (unsigned long) builder.bytesParsed());
+    if (!builder.Finish()) {
+        fprintf(stderr, "Error: malformed stats response: %s\n", builder.error().c_str());
+        return nullopt;
+    }
+    playerStats = builder.Build();
+    if (cache) {
+        CacheEntry entry{0, result.validators.etag, result.validators.lastModified, SerializePlayerStats(playerStats)};
+        cache->Store(statsCacheEndpoint, steamId, entry);
+    }
+    return playerStats;
+}
+
+string getPersonaName(const string &apiUrl, const ResponseCache *cache, const string &steamId) {
+    ProfileScope fetch(Phase::Fetch, steamId);
+    optional<CacheEntry> cached;
+    if (cache) {
+        cached = cache->Load(personaCacheEndpoint, steamId);
+        if (cached && cache->IsFresh(*cached)) {
+            return cached->payload;
+        }
+        if (cache->offline()) {
+            return "User";
+        }
+    }
+
+    Poco::JSON::Parser parser;
+    Poco::Dynamic::Var parseResult;
+    // reused by every request the thread makes, it only ever grows to the largest response
+    thread_local string threadBody;
+    string &body = threadBody;
+    body.clear();
+    ResponseSink sink{
+            [&](const char *data, size_t size) {
+                body.append(data, size);
+                return true;
+            },
+            [&] { body.clear(); }};
+    curl_slist *headers = cached ? ConditionalRequestHeaders(*cached) : nullptr;
+    ScheduledResponse response = RequestScheduler::Get().Fetch(apiUrl, headers, sink, RequestPriority::Interactive,
+                                                               steamId);
+    curl_slist_free_all(headers);
+    const HttpResult &result = response.result;
+    if (!response.ok()) {
+        PrintRequestError(response, steamId);
+        return "User";
+    }
+    if (result.status == 304 && cached) {
+        cache->Store(personaCacheEndpoint, steamId, *cached);
+        return cached->payload;
+    }
+    Log(Verbosity::Normal, "%lu bytes retrieved from request\n\n", (unsigned long) body.size());
+
+    string name;
+    {
+        ProfileScope parse(Phase::Parse);
+        parse.AddBytes(body.size());
+        parseResult = parser.parse(body);
+
+        name = parseResult.extract<Poco::JSON::Object::Ptr>()->getObject("response")->getArray("players")->getObject(
+                0)->getValue<string>("personaname");
+    }
+    if (cache) {
+        CacheEntry entry{0, result.validators.etag, result.validators.lastModified, name};
+        cache->Store(personaCacheEndpoint, steamId, entry);
+    }
+    return name;
+}
+
+map<string, string> ParsePersonaNames(const string &json) {
+    ProfileScope parse(Phase::Parse);
+    parse.AddBytes(json.size());
+    map<string, string> names;
+    Poco::JSON::Parser parser;
+    Poco::Dynamic::Var parseResult;
+
+    parseResult = parser.parse(json);
+    auto players = parseResult.extract<Poco::JSON::Object::Ptr>()->getObject("response")->getArray("players");
+    for (int i = 0; i < players->size(); i++) {
+        auto player = players->getObject(i);
+        names.insert({player->getValue<string>("steamid"), player->getValue<string>("personaname")});
+    }
+    return names;
+}
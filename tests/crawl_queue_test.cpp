@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <csignal>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "crawl_queue.h"
+
+using namespace std;
+
+class CrawlQueueTest : public testing::Test {
+protected:
+    ~CrawlQueueTest() override {
+        error_code ec;
+        filesystem::remove(path, ec);
+    }
+
+    size_t Done(unsigned shard = 0, unsigned shards = 1) {
+        CrawlQueue queue;
+        EXPECT_TRUE(queue.Open(path, shard, shards));
+        return queue.resume().done;
+    }
+
+    const string path =
+            (filesystem::temp_directory_path() / ("crawl_queue_test" + to_string(random_device{}()))).string();
+    const vector<string> ids = {"76561197960287930", "76561197960287931", "76561197960287932", "76561197960287933"};
+};
+
+TEST_F(CrawlQueueTest, ResumesWhereItStopped) {
+    ASSERT_TRUE(CrawlQueue::Create(path, ids));
+    {
+        CrawlQueue queue;
+        ASSERT_TRUE(queue.Open(path, 0, 1));
+        EXPECT_EQ(queue.steamIds(), ids);
+        queue.Set(0, CrawlState::Done);
+        queue.Set(1, CrawlState::InFlight);
+        EXPECT_TRUE(queue.Checkpoint());
+    }
+    CrawlQueue queue;
+    ASSERT_TRUE(queue.Open(path, 0, 1));
+    EXPECT_EQ(queue.resume().done, 1u);
+    EXPECT_EQ(queue.resume().interrupted, 1u);
+    EXPECT_EQ(queue.steamIds().size(), 3u);
+}
+
+// what the checkpoint writes is saved elsewhere first, and if that fails the changes wait for the next one
+TEST_F(CrawlQueueTest, RunsBeforeWriteFirst) {
+    ASSERT_TRUE(CrawlQueue::Create(path, ids));
+    CrawlQueue queue;
+    ASSERT_TRUE(queue.Open(path, 0, 1));
+    queue.Set(0, CrawlState::Done);
+    EXPECT_FALSE(queue.Checkpoint([] { return false; }));
+    EXPECT_EQ(Done(), 0u);
+
+    size_t doneBefore = 1;
+    EXPECT_TRUE(queue.Checkpoint([&] {
+        doneBefore = Done();
+        return true;
+    }));
+    EXPECT_EQ(doneBefore, 0u);
+    EXPECT_EQ(Done(), 1u);
+
+    // nothing changed, nothing to save
+    bool called = false;
+    EXPECT_TRUE(queue.Checkpoint([&] { return called = true; }));
+    EXPECT_FALSE(called);
+}
+
+// the changes of a checkpoint that couldn't be written are written by the next one
+TEST_F(CrawlQueueTest, KeepsChangesAFailedCheckpointCouldNotWrite) {
+#ifdef _WIN32
+    GTEST_SKIP() << "needs a file size limit to make the write fail";
+#else
+    ASSERT_TRUE(CrawlQueue::Create(path, ids));
+    CrawlQueue queue;
+    ASSERT_TRUE(queue.Open(path, 0, 1));
+    queue.Set(0, CrawlState::Done);
+    queue.Set(2, CrawlState::Done);
+
+    // writes past the first bytes of any file fail with EFBIG until the limit is lifted again
+    rlimit limit{};
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &limit), 0);
+    rlimit small = limit;
+    small.rlim_cur = 8;
+    auto handler = signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &small), 0);
+    bool ok = queue.Checkpoint();
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, handler);
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(Done(), 0u);
+
+    EXPECT_TRUE(queue.Checkpoint());
+    EXPECT_EQ(Done(), 2u);
+#endif
+}
+
+// a second Create fails and leaves the checkpoints of the first queue alone
+TEST_F(CrawlQueueTest, NeverReplacesAnExistingQueue) {
+    ASSERT_TRUE(CrawlQueue::Create(path, ids));
+    {
+        CrawlQueue queue;
+        ASSERT_TRUE(queue.Open(path, 0, 1));
+        queue.Set(0, CrawlState::Done);
+    }
+    EXPECT_FALSE(CrawlQueue::Create(path, ids));
+    EXPECT_EQ(Done(), 1u);
+}
+
+// workers started at once race to create the queue, exactly one of them does
+TEST_F(CrawlQueueTest, OnlyOneConcurrentCreateSucceeds) {
+    for (int round = 0; round < 20; round++) {
+        vector<thread> threads;
+        vector<char> created(4);
+        for (size_t i = 0; i < created.size(); i++) {
+            threads.emplace_back([&, i] { created[i] = CrawlQueue::Create(path, ids); });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        EXPECT_EQ(count(created.begin(), created.end(), true), 1);
+        EXPECT_EQ(Done(), 0u);
+        filesystem::remove(path);
+    }
+}
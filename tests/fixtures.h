@@ -0,0 +1,36 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stats_stream_parser.h"
+
+#ifndef TEST_SOURCE_DIR
+#define TEST_SOURCE_DIR "."
+#endif
+
+// a path relative to the root of the repository
+inline std::string TestPath(const std::string &path) {
+    return TEST_SOURCE_DIR "/" + path;
+}
+
+// a file from fixtures/, empty if it can't be read
+inline std::string ReadFixture(const std::string &name) {
+    std::ifstream stream(TestPath("fixtures/" + name), std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+// the stat names in a GetUserStatsForGame fixture, in the order they appear
+inline std::vector<std::string> FixtureStatNames(const std::string &json) {
+    std::vector<std::string> names;
+    StatsStreamParser parser([&](std::string_view name, int64_t) { names.emplace_back(name); });
+    if (!parser.Feed(json.data(), json.size()) || !parser.Finish()) {
+        names.clear();
+    }
+    return names;
+}
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <openssl/ssl.h>
+
+#include "fixtures.h"
+#include "http_client.h"
+#include "stand_in_server.h"
+
+using namespace std;
+using Poco::Net::HTTPServerRequest;
+using Poco::Net::HTTPServerResponse;
+
+// an HTTPS stand-in that answers every request with a small body, and counts the TLS handshakes it
+// completed and how many of those resumed an earlier session
+class HttpClientTest : public testing::Test {
+protected:
+    void Respond(HTTPServerRequest &request, HTTPServerResponse &response) {
+        if (request.getURI() == "/together") {
+            // holds every request until `together` of them are in, so each is on its own connection
+            unique_lock lock(requestMutex);
+            arrived++;
+            changed.notify_all();
+            changed.wait_for(lock, chrono::seconds(10), [&] { return arrived >= together; });
+        }
+        {
+            lock_guard lock(requestMutex);
+            acceptEncoding = request.get("Accept-Encoding", "");
+        }
+        response.setKeepAlive(keepAlive);
+        response.setContentType("application/json");
+        response.sendBuffer(body.data(), body.size());
+    }
+
+    long handshakes() const { return SSL_CTX_sess_accept_good(tls->sslContext()); }
+    long resumed() const { return SSL_CTX_sess_hits(tls->sslContext()); }
+
+    void ExpectBody(HttpClient &client, const string &path) {
+        string received;
+        HttpResult result = client.Fetch(server.url(path), nullptr, received);
+        ASSERT_TRUE(result.ok()) << curl_easy_strerror(result.code);
+        EXPECT_EQ(result.status, 200);
+        EXPECT_EQ(received, body);
+    }
+
+    const string body = R"({"playerstats":{"steamID":"76561197960287930","gameName":"Team Fortress 2"}})";
+    bool keepAlive = true;
+    mutex requestMutex;
+    condition_variable changed;
+    int arrived = 0;
+    int together = 0;
+    string acceptEncoding;
+    Poco::Net::Context::Ptr tls = StandInServer::Tls();
+    StandInServer server{[this](auto &request, auto &response) { Respond(request, response); }, tls};
+};
+
+TEST_F(HttpClientTest, ReusesTheConnectionForSequentialRequests) {
+    HttpClient client(TestPath("tests/localhost.pem"));
+    for (int i = 0; i < 20; i++) {
+        ExpectBody(client, "/stats");
+    }
+    EXPECT_EQ(client.requests(), 20u);
+    EXPECT_EQ(client.connections(), 1u);
+    EXPECT_EQ(handshakes(), 1);
+}
+
+TEST_F(HttpClientTest, ResumesTheSessionWhenTheServerClosesTheConnection) {
+    keepAlive = false;
+    HttpClient client(TestPath("tests/localhost.pem"));
+    for (int i = 0; i < 10; i++) {
+        ExpectBody(client, "/stats");
+    }
+    EXPECT_EQ(client.connections(), 10u);
+    EXPECT_EQ(handshakes(), 10);
+    // only the first connection paid for a full handshake
+    EXPECT_EQ(resumed(), 9);
+}
+
+// threads don't share connections, but a new connection on any thread resumes the shared session.
+// Three threads: the server hands out two session tickets per handshake and newer curls use a
+// TLS 1.3 ticket only once
+TEST_F(HttpClientTest, SharesTlsSessionsButNotConnectionsAcrossThreads) {
+    HttpClient client(TestPath("tests/localhost.pem"));
+    ExpectBody(client, "/stats");
+    together = 3;
+    vector<thread> threads;
+    for (int i = 0; i < together; i++) {
+        threads.emplace_back([&] { ExpectBody(client, "/together"); });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    // the first connection was free again for one of the threads, the others opened their own
+    EXPECT_EQ(client.connections(), 3u);
+    EXPECT_EQ(handshakes(), 3);
+    EXPECT_EQ(handshakes() - resumed(), 1);
+
+    // and kept them open for the next requests
+    for (int i = 0; i < 8; i++) {
+        ExpectBody(client, "/stats");
+    }
+    EXPECT_EQ(client.connections(), 3u);
+    EXPECT_EQ(handshakes(), 3);
+}
+
+TEST_F(HttpClientTest, OffersCompression) {
+    HttpClient client(TestPath("tests/localhost.pem"));
+    ExpectBody(client, "/stats");
+    lock_guard lock(requestMutex);
+    EXPECT_NE(acceptEncoding.find("gzip"), string::npos) << acceptEncoding;
+}
+
+TEST_F(HttpClientTest, RejectsAnUntrustedCertificate) {
+    // no CA file: the system's certificates don't know tests/localhost.pem
+    HttpClient client;
+    string received;
+    HttpResult result = client.Fetch(server.url("/stats"), nullptr, received);
+#ifdef _WIN32
+    GTEST_SKIP() << "certificates aren't verified on Windows";
+#endif
+    EXPECT_FALSE(result.ok());
+    EXPECT_TRUE(received.empty());
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "leaderboard.h"
+#include "main.h"
+#include "stat_index.h"
+
+using namespace std;
+
+static bool Precedes(LeaderboardEntry a, LeaderboardEntry b) {
+    return a.value > b.value || (a.value == b.value && a.steamId < b.steamId);
+}
+
+static bool SameEntry(LeaderboardEntry a, LeaderboardEntry b) {
+    return a.steamId == b.steamId && a.value == b.value;
+}
+
+// against a sorted vector, through inserts and erases of players with many tied values
+TEST(RankTreeTest, AgreesWithASortedVector) {
+    mt19937_64 random(1);
+    RankTree tree;
+    vector<LeaderboardEntry> expected;
+    vector<LeaderboardEntry> top;
+    for (uint64_t round = 0; round < 20000; round++) {
+        if (expected.empty() || random() % 3 != 0) {
+            LeaderboardEntry entry{round, (int64_t) (random() % 200) - 100};
+            tree.Insert(entry);
+            expected.insert(upper_bound(expected.begin(), expected.end(), entry, Precedes), entry);
+        } else {
+            auto erased = expected.begin() + (ptrdiff_t) (random() % expected.size());
+            ASSERT_TRUE(tree.Erase(*erased)) << "lost player " << erased->steamId;
+            expected.erase(erased);
+        }
+
+        LeaderboardEntry probe{random() % (round + 1), (int64_t) (random() % 220) - 110};
+        auto before = (size_t) (lower_bound(expected.begin(), expected.end(), probe, Precedes) - expected.begin());
+        top.clear();
+        tree.Top(round % 50, top);
+        ASSERT_EQ(tree.size(), expected.size()) << "after " << round + 1 << " changes";
+        ASSERT_EQ(tree.Before(probe), before) << "after " << round + 1 << " changes";
+        ASSERT_EQ(top.size(), min(expected.size(), (size_t) (round % 50)));
+        ASSERT_TRUE(equal(top.begin(), top.end(), expected.begin(), SameEntry)) << "after " << round + 1 << " changes";
+    }
+}
+
+TEST(RankTreeTest, BuildsFromOrderedEntries) {
+    vector<LeaderboardEntry> ordered;
+    for (uint64_t i = 0; i < 1000; i++) {
+        ordered.push_back({i, 500 - (int64_t) (i / 3)});
+    }
+    RankTree tree;
+    tree.Build(ordered);
+    EXPECT_EQ(tree.size(), ordered.size());
+    vector<LeaderboardEntry> top;
+    tree.Top(ordered.size(), top);
+    EXPECT_TRUE(equal(top.begin(), top.end(), ordered.begin(), ordered.end(), SameEntry));
+    EXPECT_FALSE(tree.Erase({1000, 0}));
+    EXPECT_TRUE(tree.Erase(ordered[10]));
+    EXPECT_EQ(tree.Before(ordered[11]), 10u);
+}
+
+class LeaderboardIndexTest : public testing::Test {
+protected:
+    ~LeaderboardIndexTest() override {
+        error_code ec;
+        filesystem::remove_all(directory, ec);
+    }
+
+    // what is in directory besides the snapshot, e.g. a temporary file a save left behind
+    size_t Leftovers() const {
+        size_t count = 0;
+        for (auto &entry: filesystem::directory_iterator(directory)) {
+            count += entry.path() != path;
+        }
+        return count;
+    }
+
+    StatDescriptionIndex descriptions;
+    const filesystem::path directory =
+            filesystem::temp_directory_path() / ("leaderboard_test" + to_string(random_device{}()));
+    const filesystem::path path = directory / "ranks.tfranks";
+};
+
+TEST_F(LeaderboardIndexTest, LoadsWhatItSaved) {
+    filesystem::create_directories(directory);
+    LeaderboardIndex index;
+    for (uint64_t steamId = 1; steamId <= 3; steamId++) {
+        PlayerStats stats;
+        AddStat(stats, descriptions, "Scout.accum.iPlayTime", (int64_t) steamId * 100);
+        index.Update(steamId, stats);
+    }
+    ASSERT_TRUE(index.Save(path.string()));
+    EXPECT_EQ(Leftovers(), 0u);
+
+    LeaderboardIndex loaded;
+    ASSERT_TRUE(loaded.Load(path.string(), descriptions));
+    EXPECT_EQ(loaded.players(), 3u);
+    auto stat = loaded.Find("Scout.accum.iPlayTime");
+    ASSERT_TRUE(stat);
+    auto rank = loaded.Rank(*stat, 2);
+    ASSERT_TRUE(rank);
+    EXPECT_EQ(rank->rank, 2u);
+    EXPECT_EQ(rank->value, 200);
+}
+
+// a save that fails keeps the last snapshot and leaves nothing else behind
+TEST_F(LeaderboardIndexTest, CleansUpAfterAFailedSave) {
+    // a directory where the snapshot should be, so the rename fails
+    filesystem::create_directories(path / "in the way");
+    LeaderboardIndex index;
+    EXPECT_FALSE(index.Save(path.string()));
+    EXPECT_TRUE(filesystem::is_directory(path));
+    EXPECT_EQ(Leftovers(), 0u);
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fixtures.h"
+#include "main.h"
+#include "player_stats_builder.h"
+#include "profiler.h"
+#include "stat_index.h"
+
+using namespace std;
+
+// heap allocations a parsed player may cost: one per column of PlayerStats, however many stats
+static const uint64_t maxParseAllocations = 2 * size(statSections);
+
+static const char *const statsFixtures[] = {"stats_small.json", "stats_typical.json", "stats_inflated.json"};
+
+static void ExpectSameStats(const PlayerStats &actual, const PlayerStats &expected) {
+    for (StatSection section: statSections) {
+        EXPECT_EQ(actual.section(section).ids, expected.section(section).ids);
+        EXPECT_EQ(actual.section(section).values, expected.section(section).values);
+    }
+}
+
+class PlayerStatsBuilderTest : public testing::Test {
+protected:
+    StatDescriptionIndex descriptions;
+};
+
+// the arena keeps a player's parse off the heap, only the finished columns are allocated
+TEST_F(PlayerStatsBuilderTest, ParsesAPlayerWithOneAllocationPerColumn) {
+    for (const char *fixture: statsFixtures) {
+        SCOPED_TRACE(fixture);
+        string json = ReadFixture(fixture);
+        ASSERT_FALSE(json.empty());
+        // sets up the thread's builder and interns every stat name the fixture has
+        ParsePlayerStats(json, descriptions);
+
+        uint64_t before = ThreadAllocations();
+        PlayerStats stats = ParsePlayerStats(json, descriptions);
+        EXPECT_LE(ThreadAllocations() - before, maxParseAllocations);
+        EXPECT_GT(stats.pvpStats.size(), 0u);
+    }
+}
+
+// however the response is cut into chunks, feeding it doesn't touch the heap and gives the same stats
+TEST_F(PlayerStatsBuilderTest, FeedsChunksWithoutAllocating) {
+    PlayerStatsBuilder builder;
+    for (const char *fixture: statsFixtures) {
+        SCOPED_TRACE(fixture);
+        string json = ReadFixture(fixture);
+        PlayerStats expected = ParsePlayerStats(json, descriptions);
+        for (size_t chunk: {1, 7, 4096, 1 << 20}) {
+            builder.Reset(descriptions);
+            uint64_t before = ThreadAllocations();
+            for (size_t offset = 0; offset < json.size(); offset += chunk) {
+                ASSERT_TRUE(builder.Feed(json.data() + offset, min(chunk, json.size() - offset)));
+            }
+            ASSERT_TRUE(builder.Finish());
+            EXPECT_EQ(ThreadAllocations() - before, 0u) << chunk << " byte chunks";
+            EXPECT_EQ(builder.bytesParsed(), json.size());
+            ExpectSameStats(builder.Build(), expected);
+        }
+    }
+}
+
+// a player larger than the arena spills to the heap but parses all the same
+TEST_F(PlayerStatsBuilderTest, SpillsPastItsArena) {
+    string json = ReadFixture("stats_inflated.json");
+    PlayerStatsBuilder builder(1024);
+    builder.Reset(descriptions);
+    ASSERT_TRUE(builder.Feed(json.data(), json.size()));
+    ASSERT_TRUE(builder.Finish());
+    ExpectSameStats(builder.Build(), ParsePlayerStats(json, descriptions));
+}
+
+TEST_F(PlayerStatsBuilderTest, KeepsNothingOfThePreviousPlayer) {
+    PlayerStatsBuilder builder;
+    string typical = ReadFixture("stats_typical.json");
+    string small = ReadFixture("stats_small.json");
+    builder.Reset(descriptions);
+    ASSERT_TRUE(builder.Feed(typical.data(), typical.size() / 2));
+    builder.Reset(descriptions);
+    ASSERT_TRUE(builder.Feed(small.data(), small.size()));
+    ASSERT_TRUE(builder.Finish());
+    ExpectSameStats(builder.Build(), ParsePlayerStats(small, descriptions));
+}
+
+TEST_F(PlayerStatsBuilderTest, RejectsMalformedResponses) {
+    string json = ReadFixture("stats_small.json");
+    PlayerStatsBuilder builder;
+    builder.Reset(descriptions);
+    // cut off, the parser only notices at the end
+    ASSERT_TRUE(builder.Feed(json.data(), json.size() / 2));
+    EXPECT_FALSE(builder.Finish());
+    EXPECT_TRUE(builder.failed());
+    EXPECT_FALSE(builder.error().empty());
+
+    builder.Reset(descriptions);
+    EXPECT_FALSE(builder.failed());
+    EXPECT_FALSE(builder.Feed("<html>", 6));
+    EXPECT_TRUE(builder.failed());
+    EXPECT_THROW(ParsePlayerStats("<html>", descriptions), runtime_error);
+}
@@ -0,0 +1,41 @@
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include <gtest/gtest.h>
+
+#include "profiler.h"
+
+using namespace std;
+
+// where the allocations escape to, so the compiler can't leave them out
+static void *volatile escaped;
+
+TEST(Profiler, CountsAllocations) {
+    uint64_t before = ThreadAllocations();
+    uint64_t bytesBefore = ThreadAllocatedBytes();
+    auto value = make_unique<int64_t>(1);
+    escaped = value.get();
+    EXPECT_EQ(ThreadAllocations() - before, 1u);
+    EXPECT_EQ(ThreadAllocatedBytes() - bytesBefore, sizeof(int64_t));
+}
+
+TEST(Profiler, CountsOverAlignedAllocations) {
+    struct alignas(256) Page {
+        char bytes[100];
+    };
+    uint64_t before = ThreadAllocations();
+    uint64_t bytesBefore = ThreadAllocatedBytes();
+    auto page = make_unique<Page>();
+    auto pages = make_unique<Page[]>(3);
+    auto unchecked = unique_ptr<Page>(new(nothrow) Page);
+    escaped = page.get();
+    escaped = pages.get();
+    escaped = unchecked.get();
+    EXPECT_EQ(ThreadAllocations() - before, 3u);
+    EXPECT_GE(ThreadAllocatedBytes() - bytesBefore, 5 * sizeof(Page));
+    for (void *ptr: {(void *) page.get(), (void *) pages.get(), (void *) unchecked.get()}) {
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ((uintptr_t) ptr % alignof(Page), 0u);
+    }
+}
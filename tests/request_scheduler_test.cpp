@@ -0,0 +1,369 @@
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "request_scheduler.h"
+#include "stand_in_server.h"
+
+using namespace std;
+using namespace std::chrono_literals;
+using Poco::Net::HTTPResponse;
+using Poco::Net::HTTPServerRequest;
+using Poco::Net::HTTPServerResponse;
+
+// a day boundary in the clock's terms, 0:00 UTC
+static const SchedulerClock::time_point midnight{chrono::hours(24 * 20000)};
+
+// a ManualClock and a local stand-in for the Steam Web API that answers with whatever the test
+// says, and records what was asked for
+class RequestSchedulerTest : public testing::Test {
+protected:
+    struct Request {
+        string uri;
+        string ifNoneMatch;
+    };
+
+    RequestSchedulerTest() {
+        scheduler.Configure(limits);
+    }
+
+    void Handle(HTTPServerRequest &request, HTTPServerResponse &response) {
+        size_t index;
+        {
+            lock_guard lock(requestMutex);
+            index = requests.size();
+            requests.push_back({request.getURI(), request.get("If-None-Match", "")});
+        }
+        arrived.notify_all();
+        respond(index, request, response);
+    }
+
+    size_t requestCount() {
+        lock_guard lock(requestMutex);
+        return requests.size();
+    }
+
+    // requests arrive in real time, however far the clock is advanced
+    bool WaitForRequests(size_t count) {
+        unique_lock lock(requestMutex);
+        return arrived.wait_for(lock, 10s, [&] { return requests.size() >= count; });
+    }
+
+    static bool WaitUntil(const function<bool()> &condition) {
+        auto deadline = chrono::steady_clock::now() + 10s;
+        while (!condition()) {
+            if (chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    // nothing more arrives for a while, the scheduler is still holding the request back
+    void ExpectNoRequestAfter(size_t count) {
+        this_thread::sleep_for(50ms);
+        EXPECT_EQ(requestCount(), count);
+    }
+
+    string Url(const string &path) const { return server.url(path + "?key=test"); }
+
+    // collects the body as it arrives, and how often it was told to start over
+    struct Collector {
+        string body;
+        int restarts = 0;
+        // gives up on the body after this many chunks
+        int chunksWanted = -1;
+        ResponseSink sink{
+                [this](const char *data, size_t size) {
+                    body.append(data, size);
+                    return chunksWanted < 0 || --chunksWanted > 0;
+                },
+                [this] {
+                    body.clear();
+                    restarts++;
+                }};
+    };
+
+    future<ScheduledResponse> FetchAsync(const string &url, Collector &collector, RequestPriority priority,
+                                         const vector<string> &headers = {}) {
+        return async(launch::async, [=, this, &collector] {
+            curl_slist *list = nullptr;
+            for (auto &header: headers) {
+                list = curl_slist_append(list, header.c_str());
+            }
+            ScheduledResponse response = scheduler.Fetch(url, list, collector.sink, priority, "test");
+            curl_slist_free_all(list);
+            return response;
+        });
+    }
+
+    // takes the one token the bucket starts with, so the next requests have to queue
+    void DrainBucket(const string &url) {
+        ASSERT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    }
+
+    static void Send(HTTPServerResponse &response, const string &body) {
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType("application/json");
+        response.sendBuffer(body.data(), body.size());
+    }
+
+    static void SendStatus(HTTPServerResponse &response, HTTPResponse::HTTPStatus status) {
+        response.setStatus(status);
+        response.setContentType("text/html");
+        response.sendBuffer("", 0);
+    }
+
+    const string body = R"({"playerstats":{"steamID":"76561197960287930","stats":[]}})";
+    RateLimits limits{1, 1000, 5, 100ms, 400ms};
+    ManualClock clock{midnight + 12h};
+    RequestScheduler scheduler{clock, 7};
+    function<void(size_t, HTTPServerRequest &, HTTPServerResponse &)> respond =
+            [this](size_t, HTTPServerRequest &, HTTPServerResponse &response) { Send(response, body); };
+    mutex requestMutex;
+    condition_variable arrived;
+    vector<Request> requests;
+    StandInServer server{[this](auto &request, auto &response) { Handle(request, response); }};
+};
+
+TEST_F(RequestSchedulerTest, RefillsTheTokenBucket) {
+    limits.perSecond = 2;
+    scheduler.Configure(limits);
+    string url = Url("/stats");
+    // a full bucket lets a burst of perSecond requests through
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 500ms);
+    clock.Advance(200ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 300ms);
+    clock.Advance(300ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    // a long quiet spell refills it up to its capacity, not beyond
+    clock.Advance(10s);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 500ms);
+    // every API key has its own bucket
+    EXPECT_EQ(scheduler.TryAcquire(server.url("/stats?key=other"), RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.metrics().sent, 6u);
+}
+
+TEST_F(RequestSchedulerTest, RefillsFractionalRates) {
+    limits.perSecond = 0.5;
+    scheduler.Configure(limits);
+    string url = Url("/stats");
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 2000ms);
+    clock.Advance(2s);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Background), 0ms);
+}
+
+TEST_F(RequestSchedulerTest, ResetsTheDailyBudgetAtMidnight) {
+    limits.perSecond = 0;
+    limits.perDay = 3;
+    scheduler.Configure(limits);
+    clock.Advance(11h + 59min + 59s);
+    string url = Url("/stats");
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Interactive), 0ms);
+    }
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Interactive), nullopt);
+
+    Collector collector;
+    ScheduledResponse response = FetchAsync(url, collector, RequestPriority::Interactive).get();
+    EXPECT_TRUE(response.overBudget);
+    EXPECT_FALSE(response.ok());
+    EXPECT_EQ(requestCount(), 0u);
+    EXPECT_EQ(scheduler.metrics().overBudget, 2u);
+    EXPECT_EQ(scheduler.metrics().usedToday, 3u);
+
+    clock.Advance(1s);
+    EXPECT_EQ(scheduler.TryAcquire(url, RequestPriority::Interactive), 0ms);
+    EXPECT_EQ(scheduler.metrics().usedToday, 1u);
+}
+
+TEST_F(RequestSchedulerTest, SendsInteractiveRequestsFirst) {
+    DrainBucket(Url("/stats"));
+    Collector background;
+    Collector interactive;
+    auto first = FetchAsync(Url("/background"), background, RequestPriority::Background);
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().queued[1] == 1; }));
+    auto second = FetchAsync(Url("/interactive"), interactive, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().queued[0] == 1; }));
+    // batch mode's own transfers wait for queued requests of the same or a higher priority too
+    EXPECT_NE(scheduler.TryAcquire(Url("/stats"), RequestPriority::Background), 0ms);
+
+    clock.Advance(1s);
+    ASSERT_TRUE(WaitForRequests(1));
+    EXPECT_TRUE(second.get().ok());
+    ExpectNoRequestAfter(1);
+    clock.Advance(1s);
+    EXPECT_TRUE(first.get().ok());
+    ASSERT_EQ(requestCount(), 2u);
+    EXPECT_EQ(requests[0].uri, "/interactive?key=test");
+    EXPECT_EQ(requests[1].uri, "/background?key=test");
+    EXPECT_EQ(interactive.body, body);
+    EXPECT_EQ(background.body, body);
+}
+
+TEST_F(RequestSchedulerTest, HonoursRetryAfter) {
+    limits.perSecond = 0;
+    scheduler.Configure(limits);
+    respond = [this](size_t index, HTTPServerRequest &, HTTPServerResponse &response) {
+        if (index == 0) {
+            response.set("Retry-After", "3");
+            SendStatus(response, HTTPResponse::HTTP_TOO_MANY_REQUESTS);
+        } else {
+            Send(response, body);
+        }
+    };
+    Collector collector;
+    auto fetched = FetchAsync(Url("/stats"), collector, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitForRequests(1));
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().throttled == 1; }));
+    // Steam throttles the key: other requests with it are held back as long
+    EXPECT_EQ(scheduler.TryAcquire(Url("/other"), RequestPriority::Interactive), 3000ms);
+    EXPECT_EQ(scheduler.TryAcquire(server.url("/other?key=another"), RequestPriority::Interactive), 0ms);
+
+    // the backoff alone would be over after at most 100ms
+    clock.Advance(2999ms);
+    ExpectNoRequestAfter(1);
+    clock.Advance(1ms);
+    ScheduledResponse response = fetched.get();
+    EXPECT_TRUE(response.ok());
+    EXPECT_EQ(response.result.status, 200);
+    EXPECT_EQ(collector.body, body);
+    EXPECT_EQ(collector.restarts, 1);
+    EXPECT_EQ(scheduler.metrics().retried, 1u);
+}
+
+// the nth retry waits between half and all of min(100ms * 2^n, 400ms)
+TEST_F(RequestSchedulerTest, BacksOffExponentiallyUntilMaxRetries) {
+    limits.perSecond = 0;
+    limits.maxRetries = 3;
+    scheduler.Configure(limits);
+    respond = [](size_t, HTTPServerRequest &, HTTPServerResponse &response) {
+        SendStatus(response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+    };
+    Collector collector;
+    auto fetched = FetchAsync(Url("/stats"), collector, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitForRequests(1));
+    uint64_t attempt = 0;
+    for (auto ceiling: {100ms, 200ms, 400ms}) {
+        // the backoff is counted from when the failure was seen
+        ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().retried == attempt + 1; }));
+        attempt++;
+        size_t sent = requestCount();
+        clock.Advance(ceiling / 2 - 1ms);
+        ExpectNoRequestAfter(sent);
+        clock.Advance(ceiling / 2 + 1ms);
+        ASSERT_TRUE(WaitForRequests(sent + 1));
+    }
+    ScheduledResponse response = fetched.get();
+    EXPECT_FALSE(response.ok());
+    EXPECT_EQ(response.result.status, 503);
+    EXPECT_EQ(requestCount(), 4u);
+    EXPECT_EQ(scheduler.metrics().retried, 3u);
+}
+
+TEST_F(RequestSchedulerTest, RetriesTruncatedBodiesFromTheStart) {
+    limits.perSecond = 0;
+    scheduler.Configure(limits);
+    respond = [this](size_t index, HTTPServerRequest &, HTTPServerResponse &response) {
+        if (index != 0) {
+            Send(response, body);
+            return;
+        }
+        // announces the whole body, then the connection is closed under it
+        response.setKeepAlive(false);
+        response.setStatus(HTTPResponse::HTTP_OK);
+        response.setContentType("application/json");
+        response.setContentLength((streamsize) body.size());
+        response.send().write(body.data(), 10).flush();
+    };
+    Collector collector;
+    auto fetched = FetchAsync(Url("/stats"), collector, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().retried == 1; }));
+    clock.Advance(100ms);
+    EXPECT_TRUE(fetched.get().ok());
+    EXPECT_EQ(collector.restarts, 1);
+    EXPECT_EQ(collector.body, body);
+}
+
+// callers asking for the same thing while it is queued get one request, streamed to all of them.
+// One that revalidates a cached version asks for something else: it must not be handed a 304 that
+// was meant for another caller, or another caller its 304
+TEST_F(RequestSchedulerTest, SharesQueuedRequestsWithTheSameHeaders) {
+    respond = [this](size_t, HTTPServerRequest &request, HTTPServerResponse &response) {
+        if (request.get("If-None-Match", "") == "\"v1\"") {
+            SendStatus(response, HTTPResponse::HTTP_NOT_MODIFIED);
+        } else {
+            Send(response, body);
+        }
+    };
+    DrainBucket(Url("/stats"));
+    Collector plain[3];
+    Collector conditional[2];
+    vector<future<ScheduledResponse>> plainFetches;
+    vector<future<ScheduledResponse>> conditionalFetches;
+    for (auto &collector: plain) {
+        plainFetches.push_back(FetchAsync(Url("/stats"), collector, RequestPriority::Interactive));
+    }
+    for (auto &collector: conditional) {
+        conditionalFetches.push_back(
+                FetchAsync(Url("/stats"), collector, RequestPriority::Interactive, {"If-None-Match: \"v1\""}));
+    }
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().deduplicated == 3; }));
+    EXPECT_EQ(scheduler.metrics().queued[0], 2u);
+
+    clock.Advance(1s);
+    ASSERT_TRUE(WaitForRequests(1));
+    clock.Advance(1s);
+    for (size_t i = 0; i < size(plain); i++) {
+        ScheduledResponse response = plainFetches[i].get();
+        EXPECT_TRUE(response.ok());
+        EXPECT_EQ(response.result.status, 200);
+        EXPECT_EQ(plain[i].body, body);
+    }
+    for (size_t i = 0; i < size(conditional); i++) {
+        ScheduledResponse response = conditionalFetches[i].get();
+        EXPECT_TRUE(response.ok());
+        EXPECT_EQ(response.result.status, 304);
+        EXPECT_TRUE(conditional[i].body.empty());
+    }
+    ASSERT_EQ(requestCount(), 2u);
+    EXPECT_NE(requests[0].ifNoneMatch, requests[1].ifNoneMatch);
+    EXPECT_EQ(scheduler.metrics().sent, 3u);
+}
+
+TEST_F(RequestSchedulerTest, KeepsStreamingToCallersThatDidNotGiveUp) {
+    // a body of several chunks
+    string large(1 << 20, ' ');
+    large.replace(0, body.size(), body);
+    respond = [&](size_t, HTTPServerRequest &, HTTPServerResponse &response) { Send(response, large); };
+    DrainBucket(Url("/stats"));
+    Collector quitter;
+    quitter.chunksWanted = 1;
+    Collector stayer;
+    auto quitting = FetchAsync(Url("/stats"), quitter, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().queued[0] == 1; }));
+    auto staying = FetchAsync(Url("/stats"), stayer, RequestPriority::Interactive);
+    ASSERT_TRUE(WaitUntil([&] { return scheduler.metrics().deduplicated == 1; }));
+
+    clock.Advance(1s);
+    ScheduledResponse stayed = staying.get();
+    ScheduledResponse quit = quitting.get();
+    EXPECT_TRUE(stayed.ok());
+    EXPECT_EQ(stayer.body, large);
+    EXPECT_EQ(quit.result.code, CURLE_WRITE_ERROR);
+    EXPECT_LT(quitter.body.size(), large.size());
+    EXPECT_EQ(requestCount(), 1u);
+}
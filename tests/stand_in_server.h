@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <Poco/Net/Context.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/SecureServerSocket.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketAddress.h>
+
+#include "fixtures.h"
+
+// a local server the tests point the clients at, on a free port of 127.0.0.1. Every request goes
+// to handler, on one of the server's threads
+class StandInServer {
+public:
+    using Handler = std::function<void(Poco::Net::HTTPServerRequest &, Poco::Net::HTTPServerResponse &)>;
+
+    // with tls, the server speaks HTTPS with tests/localhost.pem, which the client has to trust
+    explicit StandInServer(Handler handler, Poco::Net::Context::Ptr tls = nullptr) {
+        Poco::Net::SocketAddress address("127.0.0.1", 0);
+        if (tls) {
+            socket = std::make_unique<Poco::Net::SecureServerSocket>(address, 64, tls);
+        } else {
+            socket = std::make_unique<Poco::Net::ServerSocket>(address);
+        }
+        auto params = new Poco::Net::HTTPServerParams;
+        params->setMaxThreads(16);
+        server = std::make_unique<Poco::Net::HTTPServer>(new Factory(std::move(handler)), *socket, params);
+        server->start();
+        base = std::string(tls ? "https" : "http") + "://127.0.0.1:" + std::to_string(socket->address().port());
+    }
+
+    ~StandInServer() {
+        // keep-alive connections the client still holds would otherwise keep the server waiting
+        server->stopAll(true);
+    }
+
+    std::string url(std::string_view path) const { return base + std::string(path); }
+
+    // a server side TLS context for tests/localhost.pem, resuming sessions like a real server
+    static Poco::Net::Context::Ptr Tls() {
+        Poco::Net::Context::Ptr context = new Poco::Net::Context(
+                Poco::Net::Context::TLS_SERVER_USE, TestPath("tests/localhost.key"), TestPath("tests/localhost.pem"), "",
+                Poco::Net::Context::VERIFY_NONE);
+        context->enableSessionCache(true, "tf-steam-api-tests");
+        return context;
+    }
+
+private:
+    class Handle : public Poco::Net::HTTPRequestHandler {
+    public:
+        explicit Handle(const Handler &handler) : handler(handler) {}
+
+        void handleRequest(Poco::Net::HTTPServerRequest &request, Poco::Net::HTTPServerResponse &response) override {
+            handler(request, response);
+        }
+
+    private:
+        const Handler &handler;
+    };
+
+    class Factory : public Poco::Net::HTTPRequestHandlerFactory {
+    public:
+        explicit Factory(Handler handler) : handler(std::move(handler)) {}
+
+        Poco::Net::HTTPRequestHandler *createRequestHandler(const Poco::Net::HTTPServerRequest &) override {
+            return new Handle(handler);
+        }
+
+    private:
+        Handler handler;
+    };
+
+    std::unique_ptr<Poco::Net::ServerSocket> socket;
+    std::unique_ptr<Poco::Net::HTTPServer> server;
+    std::string base;
+};
@@ -0,0 +1,146 @@
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fixtures.h"
+#include "stat_classifier.h"
+#include "stat_names.h"
+
+using namespace std;
+
+// the regexes FetchResults matched every stat against before ClassifyStat, and what it took from
+// their groups
+namespace legacy {
+
+const regex classPvp(
+        "(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.(accum|max)\\.i([a-zA-Z]+)");
+const regex classMvm(
+        "(Class|Scout|Soldier|Pyro|Demoman|Heavy|Engineer|Medic|Sniper|Spy)\\.mvm\\.(accum|max)\\.i([a-zA-Z]+)");
+const regex mapStat("((arena|cp|ctf|koth|pl|plr|sd)_[a-zA-Z0-9_]+)\\.accum\\.iPlayTime");
+const regex achievementStat("TF_.*_STAT");
+
+StatName Classify(const string &name) {
+    StatName result;
+    smatch match;
+    bool mvm = false;
+    if (regex_match(name, match, classPvp) || (mvm = regex_match(name, match, classMvm))) {
+        result.category = StatCategory::Class;
+        result.className = string_view(name).substr(match.position(1), match.length(1));
+        result.gameType = mvm ? GameType::coop : GameType::pvp;
+        result.statType = match.str(2) == "accum" ? StatType::accum : StatType::max;
+        result.shortName = string_view(name).substr(match.position(3), match.length(3));
+    } else if (regex_match(name, match, mapStat)) {
+        result.category = StatCategory::Map;
+        result.mapName = string_view(name).substr(match.position(1), match.length(1));
+        result.gamemode = string_view(name).substr(match.position(2), match.length(2));
+    } else if (regex_match(name, match, achievementStat)) {
+        result.category = StatCategory::Achievement;
+    }
+    return result;
+}
+
+}  // namespace legacy
+
+static void ExpectSameAsLegacy(const string &name) {
+    SCOPED_TRACE(name);
+    StatName expected = legacy::Classify(name);
+    StatName actual = ClassifyStat(name);
+    ASSERT_EQ(actual.category, expected.category);
+    EXPECT_EQ(actual.fullName, name);
+    if (expected.category == StatCategory::Class) {
+        EXPECT_EQ(actual.className, expected.className);
+        EXPECT_EQ(actual.isClassTemplate, expected.className == "Class");
+        if (!actual.isClassTemplate) {
+            EXPECT_EQ(tfClassNames[(size_t) actual.tfClass], expected.className);
+        }
+        EXPECT_EQ(actual.gameType, expected.gameType);
+        EXPECT_EQ(actual.statType, expected.statType);
+        EXPECT_EQ(actual.shortName, expected.shortName);
+    } else if (expected.category == StatCategory::Map) {
+        EXPECT_EQ(actual.mapName, expected.mapName);
+        EXPECT_EQ(actual.gamemode, expected.gamemode);
+    }
+}
+
+// every name stat_names.json describes, and every class stat template filled in for each class
+TEST(StatClassifier, MatchesLegacyRegexesOnKnownNames) {
+    for (auto &entry: embeddedStatNames) {
+        string name(entry.name);
+        ExpectSameAsLegacy(name);
+        if (name.compare(0, 6, "Class.") == 0) {
+            for (string_view className: tfClassNames) {
+                ExpectSameAsLegacy(string(className) + name.substr(5));
+            }
+        }
+    }
+}
+
+TEST(StatClassifier, MatchesLegacyRegexesOnFixtures) {
+    for (const char *fixture: {"stats_small.json", "stats_typical.json", "stats_inflated.json"}) {
+        vector<string> names = FixtureStatNames(ReadFixture(fixture));
+        ASSERT_FALSE(names.empty()) << fixture;
+        for (auto &name: names) {
+            ExpectSameAsLegacy(name);
+        }
+    }
+}
+
+TEST(StatClassifier, MatchesLegacyRegexesOnSyntheticMaps) {
+    for (const char *gamemode: {"arena", "cp", "ctf", "koth", "pl", "plr", "sd", "tc", "mvm", "CP", "c", ""}) {
+        for (const char *map: {"dustbowl", "2fort", "upward_rc2", "a", "_", "__", "map-name", "map.name", "",
+                               "Badwater_Basin_2", "x9"}) {
+            for (const char *suffix: {".accum.iPlayTime", ".accum.iPlaytime", ".max.iPlayTime",
+                                      ".accum.iPlayTimeX", "", ".accum.iPlayTime\n"}) {
+                ExpectSameAsLegacy(string(gamemode) + "_" + map + suffix);
+            }
+        }
+    }
+}
+
+TEST(StatClassifier, MatchesLegacyRegexesOnEdgeCases) {
+    for (const char *name: {"", "T", "TF_", "TF_STAT", "TF__STAT", "TF_X_STAT", "TF_X_STATS", "TF_\n_STAT",
+                            "TF_\r_STAT", "tf_x_stat", "Class", "Class.", "Class.accum.i", "Class.accum.i1",
+                            "Scout.accum.iA", "Scout.mvm.max.iA", "Scout.mvm.mvm.accum.iA", "Scout.pvp.accum.iA",
+                            "Scouts.accum.iA", "Scout.accum.iA.B", "Spy.max.iBackstabs ", ".accum.iPlayTime",
+                            "cp_.accum.iPlayTime", "Heavy.accum.iPlayTime"}) {
+        ExpectSameAsLegacy(name);
+    }
+}
+
+// known names with a character dropped, repeated or replaced, so every grammar is left at every
+// position at least once
+TEST(StatClassifier, MatchesLegacyRegexesOnMutatedNames) {
+    const string alphabet = "abcxyzACSTX019_.-\n ";
+    mt19937 random(7);
+    for (auto &entry: embeddedStatNames) {
+        string name(entry.name);
+        for (int i = 0; i < 20; i++) {
+            string mutated = name;
+            size_t at = random() % mutated.size();
+            switch (random() % 3) {
+                case 0:
+                    mutated.erase(at, 1);
+                    break;
+                case 1:
+                    mutated.insert(at, 1, mutated[at]);
+                    break;
+                default:
+                    mutated[at] = alphabet[random() % alphabet.size()];
+            }
+            ExpectSameAsLegacy(mutated);
+        }
+    }
+}
+
+// "Class" is the template stat_names.json describes every class's stats with, not a class of its own
+TEST(StatClassifier, ReportsClassTemplates) {
+    StatName name = ClassifyStat("Class.mvm.max.iDamageDealt");
+    EXPECT_EQ(name.category, StatCategory::Class);
+    EXPECT_TRUE(name.isClassTemplate);
+    EXPECT_EQ(name.gameType, GameType::coop);
+    EXPECT_EQ(name.statType, StatType::max);
+    EXPECT_EQ(name.shortName, "DamageDealt");
+}
@@ -0,0 +1,109 @@
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "stat_format.h"
+
+using namespace std;
+
+static string HhMmSs(int64_t seconds) {
+    return FormatToString(FormatHhMmSs, seconds);
+}
+
+static string Thousands(int64_t value, char separator = ',') {
+    return FormatToString(FormatThousands, value, separator);
+}
+
+static string HumanDuration(double seconds) {
+    return FormatToString(FormatHumanDuration, dseconds(seconds));
+}
+
+// how play times were formatted before FormatHhMmSs: H:MM:SS, or MM:SS under an hour
+static string ExpectedHhMmSs(int64_t seconds) {
+    char buffer[64];
+    int64_t hours = seconds / 3600;
+    int64_t minutes = seconds % 3600 / 60;
+    if (hours != 0) {
+        snprintf(buffer, sizeof(buffer), "%" PRId64 ":%02" PRId64 ":%02" PRId64, hours, minutes, seconds % 60);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%02" PRId64 ":%02" PRId64, minutes, seconds % 60);
+    }
+    return buffer;
+}
+
+// every second of the first 200 hours, then play times up to a few hundred years growing by 0.1% at a time
+TEST(StatFormatTest, FormatsPlayTimesLikeBefore) {
+    for (int64_t seconds = 0; seconds < 200 * 3600; seconds++) {
+        ASSERT_EQ(HhMmSs(seconds), ExpectedHhMmSs(seconds));
+    }
+    for (int64_t seconds = 200 * 3600; seconds < 10000000000; seconds += seconds / 1000 + 1) {
+        ASSERT_EQ(HhMmSs(seconds), ExpectedHhMmSs(seconds));
+    }
+}
+
+TEST(StatFormatTest, FormatsNegativeAndExtremePlayTimes) {
+    EXPECT_EQ(HhMmSs(-59), "-00:59");
+    EXPECT_EQ(HhMmSs(-3725), "-1:02:05");
+    EXPECT_EQ(HhMmSs(numeric_limits<int64_t>::max()), "2562047788015215:30:07");
+    EXPECT_EQ(HhMmSs(numeric_limits<int64_t>::min()), "-2562047788015215:30:08");
+}
+
+TEST(StatFormatTest, SeparatesThousands) {
+    EXPECT_EQ(Thousands(0), "0");
+    EXPECT_EQ(Thousands(7), "7");
+    EXPECT_EQ(Thousands(999), "999");
+    EXPECT_EQ(Thousands(1000), "1,000");
+    EXPECT_EQ(Thousands(999999), "999,999");
+    EXPECT_EQ(Thousands(1000000), "1,000,000");
+    EXPECT_EQ(Thousands(1234567, '.'), "1.234.567");
+    EXPECT_EQ(Thousands(-999), "-999");
+    EXPECT_EQ(Thousands(-1000), "-1,000");
+    EXPECT_EQ(Thousands(numeric_limits<int64_t>::max()), "9,223,372,036,854,775,807");
+    EXPECT_EQ(Thousands(numeric_limits<int64_t>::min()), "-9,223,372,036,854,775,808");
+}
+
+TEST(StatFormatTest, FormatsDurationsInTheLargestUnit) {
+    EXPECT_EQ(HumanDuration(0), "0 seconds");
+    EXPECT_EQ(HumanDuration(1), "1 second");
+    EXPECT_EQ(HumanDuration(45), "45 seconds");
+    EXPECT_EQ(HumanDuration(90), "1.5 minutes");
+    EXPECT_EQ(HumanDuration(3.5 * 3600), "3.5 hours");
+    EXPECT_EQ(HumanDuration(86400), "1 day");
+    EXPECT_EQ(HumanDuration(2 * 86400), "2 days");
+    EXPECT_EQ(HumanDuration(30 * 86400), "4.3 weeks");
+    EXPECT_EQ(HumanDuration(31 * 86400), "1 month");
+    EXPECT_EQ(HumanDuration(dseconds(dyears(2.1)).count()), "2.1 years");
+}
+
+// what rounds to a whole unit is shown in that unit, what doesn't stays in the unit below
+TEST(StatFormatTest, RoundsDurationsAtUnitBoundaries) {
+    EXPECT_EQ(HumanDuration(59.94), "59.9 seconds");
+    EXPECT_EQ(HumanDuration(59.96), "1 minute");
+    EXPECT_EQ(HumanDuration(57.6 * 60), "57.6 minutes");
+    EXPECT_EQ(HumanDuration(59.94 * 60), "59.9 minutes");
+    EXPECT_EQ(HumanDuration(59.97 * 60), "1 hour");
+    EXPECT_EQ(HumanDuration(6.94 * 86400), "6.9 days");
+    EXPECT_EQ(HumanDuration(6.97 * 86400), "1 week");
+    EXPECT_EQ(HumanDuration(dseconds(dmonths(11.94)).count()), "11.9 months");
+    EXPECT_EQ(HumanDuration(dseconds(dmonths(11.97)).count()), "1 year");
+    EXPECT_EQ(HumanDuration(1.04), "1 second");
+    EXPECT_EQ(HumanDuration(1.06), "1.1 seconds");
+}
+
+TEST(StatFormatTest, FormatsNegativeAndInvalidDurations) {
+    EXPECT_EQ(HumanDuration(-90), "-1.5 minutes");
+    EXPECT_EQ(HumanDuration(-59.97 * 60), "-1 hour");
+    EXPECT_EQ(HumanDuration(-0.06), "-0.1 seconds");
+    // rounds to nothing, without a sign
+    EXPECT_EQ(HumanDuration(-0.04), "0 seconds");
+    EXPECT_EQ(HumanDuration(-0.0), "0 seconds");
+    EXPECT_EQ(HumanDuration(nan("")), "0 seconds");
+    // capped at 1e17 seconds so it fits the buffer
+    EXPECT_EQ(HumanDuration(numeric_limits<double>::infinity()), "3168873850.7 years");
+    EXPECT_EQ(HumanDuration(-numeric_limits<double>::infinity()), "-3168873850.7 years");
+    EXPECT_EQ(HumanDuration(1e300), "3168873850.7 years");
+}
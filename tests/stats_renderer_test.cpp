@@ -0,0 +1,78 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aggregate.h"
+#include "fixtures.h"
+#include "main.h"
+#include "stat_index.h"
+#include "stats_renderer.h"
+
+using namespace std;
+
+class StatsRendererTest : public testing::Test {
+protected:
+    string RenderChanges(const PlayerStats &changes) {
+        ostringstream out;
+        renderer.RenderChanges(changes, "76561197960287930", "period", out);
+        return out.str();
+    }
+
+    StatDescriptionIndex descriptions;
+    StatsRenderer renderer{TestPath("templates/")};
+};
+
+// a stat can go down between two snapshots, e.g. after Steam reset it, and is shown with its sign
+TEST_F(StatsRendererTest, RendersNegativeChanges) {
+    PlayerStats changes;
+    AddStat(changes, descriptions, "Scout.accum.iPlayTime", -3725);
+    AddStat(changes, descriptions, "Scout.accum.iNumDeaths", -12);
+    AddStat(changes, descriptions, "Heavy.mvm.accum.iPlayTime", -59);
+    AddStat(changes, descriptions, "cp_dustbowl.accum.iPlayTime", -7200);
+    AddStat(changes, descriptions, "TF_SCOUT_STEAL_SANDMAN_STAT", -1);
+    string rendered = RenderChanges(changes);
+    EXPECT_NE(rendered.find(": -1:02:05\n"), string::npos) << rendered;
+    EXPECT_NE(rendered.find(": -12\n"), string::npos) << rendered;
+    EXPECT_NE(rendered.find(": -00:59\n"), string::npos) << rendered;
+    EXPECT_NE(rendered.find("cp_dustbowl: -2:00:00\n"), string::npos) << rendered;
+    EXPECT_NE(rendered.find(": -1\n"), string::npos) << rendered;
+}
+
+TEST_F(StatsRendererTest, RendersMixedChanges) {
+    PlayerStats changes;
+    AddStat(changes, descriptions, "Soldier.accum.iPlayTime", 60);
+    AddStat(changes, descriptions, "Soldier.max.iDamageDealt", -300);
+    string rendered = RenderChanges(changes);
+    EXPECT_NE(rendered.find(": 01:00\n"), string::npos) << rendered;
+    EXPECT_NE(rendered.find(": -300\n"), string::npos) << rendered;
+}
+
+static StatAggregate Aggregate(const string &name, const vector<int64_t> &values) {
+    StatAggregate aggregate;
+    aggregate.name = name;
+    aggregate.description = name;
+    for (int64_t value: values) {
+        aggregate.sum += value;
+        aggregate.sketch.Add((double) value);
+    }
+    return aggregate;
+}
+
+// the sum is exact and kept as a number, times are shown like the other play times
+TEST_F(StatsRendererTest, RendersTheSumOfAggregates) {
+    vector<StatAggregate> aggregates;
+    aggregates.push_back(Aggregate("Scout.accum.iNumDeaths", {1, 20, 300, 4000, 50000}));
+    aggregates.push_back(Aggregate("Scout.accum.iPlayTime", {3600, 1800, 59}));
+    aggregates.push_back(Aggregate("cp_dustbowl.accum.iPlayTime", {7200, 36000}));
+    ostringstream out;
+    renderer.RenderAggregates(aggregates, 5, out);
+    string rendered = out.str();
+    EXPECT_NE(rendered.find("Scout.accum.iNumDeaths: 5 players, sum 54321, mean 10864.2,"), string::npos)
+            << rendered;
+    EXPECT_NE(rendered.find("Scout.accum.iPlayTime: 3 players, sum 1:30:59, mean 30:19,"), string::npos)
+            << rendered;
+    EXPECT_NE(rendered.find("Play time on cp_dustbowl: 2 players, sum 12:00:00, mean 6:00:00,"), string::npos)
+            << rendered;
+}
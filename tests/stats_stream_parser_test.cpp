@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "stats_stream_parser.h"
+
+using namespace std;
+
+class StatsStreamParserTest : public testing::Test {
+protected:
+    // parses a response with a single stat whose value is the given JSON
+    bool Parse(const string &value) {
+        string json = R"({"playerstats":{"stats":[{"name":"Scout.accum.iNumDeaths","value":)" + value + "}]}}";
+        stats.clear();
+        StatsStreamParser parser([this](string_view name, int64_t value) { stats.emplace_back(name, value); });
+        bool ok = parser.Feed(json.data(), json.size()) && parser.Finish();
+        error = parser.error();
+        return ok;
+    }
+
+    vector<pair<string, int64_t>> stats;
+    string error;
+};
+
+TEST_F(StatsStreamParserTest, ParsesNumbersAndNumericStrings) {
+    ASSERT_TRUE(Parse("123"));
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].first, "Scout.accum.iNumDeaths");
+    EXPECT_EQ(stats[0].second, 123);
+    ASSERT_TRUE(Parse("\"456\""));
+    EXPECT_EQ(stats.at(0).second, 456);
+}
+
+// fractions and exponents are truncated like an int conversion would
+TEST_F(StatsStreamParserTest, TruncatesFractionsAndExponents) {
+    ASSERT_TRUE(Parse("12.9"));
+    EXPECT_EQ(stats.at(0).second, 12);
+    ASSERT_TRUE(Parse("-1.5e3"));
+    EXPECT_EQ(stats.at(0).second, -1500);
+}
+
+TEST_F(StatsStreamParserTest, KeepsTheExtremesOfInt64) {
+    ASSERT_TRUE(Parse("9223372036854775807"));
+    EXPECT_EQ(stats.at(0).second, INT64_MAX);
+    ASSERT_TRUE(Parse("-9223372036854775808"));
+    EXPECT_EQ(stats.at(0).second, INT64_MIN);
+}
+
+// numbers no int64_t can hold make the response malformed instead of being converted
+TEST_F(StatsStreamParserTest, RejectsNumbersOutOfRange) {
+    for (const char *value: {"1e30", "99999999999999999999", "-1e30", "-99999999999999999999", "1e400",
+                             "9.3e18"}) {
+        SCOPED_TRACE(value);
+        EXPECT_FALSE(Parse(value));
+        EXPECT_EQ(error.find("number out of range"), 0u) << error;
+        EXPECT_TRUE(stats.empty());
+    }
+}
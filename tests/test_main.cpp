@@ -0,0 +1,10 @@
+#include <gtest/gtest.h>
+
+#include "logging.h"
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    // the code under test logs what it does, only failures are of interest here
+    SetVerbosity(Verbosity::Quiet);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fixtures.h"
+#include "main.h"
+#include "profiler.h"
+#include "stat_index.h"
+#include "stats_renderer.h"
+#include "watch.h"
+
+using namespace std;
+
+class WatchedPageTest : public testing::Test {
+protected:
+    string Written() const {
+        ostringstream out;
+        page.Write(out);
+        return out.str();
+    }
+
+    // what a single run would write for body
+    string Rendered(const string &body) const {
+        ostringstream out;
+        renderer.Render(ParsePlayerStats(body, descriptions), "mibalolox482", out);
+        return out.str();
+    }
+
+    StatDescriptionIndex descriptions;
+    StatsRenderer renderer{TestPath("templates/")};
+    WatchedPage page{renderer};
+    const string body = ReadFixture("stats_typical.json");
+};
+
+TEST_F(WatchedPageTest, RendersLikeASingleRun) {
+    ASSERT_FALSE(body.empty());
+    EXPECT_TRUE(page.UpdateName("mibalolox482"));
+    EXPECT_TRUE(page.UpdateStats(body, descriptions));
+    EXPECT_EQ(Written(), Rendered(body));
+}
+
+// the same response again is hashed and nothing else: no parsing, no rendering, no allocation
+TEST_F(WatchedPageTest, UnchangedResponseCostsNothing) {
+    page.UpdateName("mibalolox482");
+    ASSERT_TRUE(page.UpdateStats(body, descriptions));
+    string before = Written();
+    uint64_t rendered = page.rendered();
+
+    uint64_t allocations = ThreadAllocations();
+    for (int i = 0; i < 10; i++) {
+        EXPECT_FALSE(page.UpdateStats(body, descriptions));
+    }
+    EXPECT_EQ(ThreadAllocations() - allocations, 0u);
+    EXPECT_FALSE(page.UpdateName("mibalolox482"));
+    EXPECT_EQ(page.rendered(), rendered);
+    EXPECT_EQ(Written(), before);
+}
+
+// different bytes with the same stats are parsed, but nothing is rendered again
+TEST_F(WatchedPageTest, ReformattedResponseRendersNothing) {
+    ASSERT_TRUE(page.UpdateStats(body, descriptions));
+    uint64_t rendered = page.rendered();
+    EXPECT_FALSE(page.UpdateStats(body + "\n", descriptions));
+    EXPECT_EQ(page.rendered(), rendered);
+}
+
+TEST_F(WatchedPageTest, RendersOnlyTheChangedSection) {
+    page.UpdateName("mibalolox482");
+    ASSERT_TRUE(page.UpdateStats(body, descriptions));
+    uint64_t rendered = page.rendered();
+
+    // the first stat's value, with another first digit
+    string changed = body;
+    size_t value = changed.find("\"value\": ") + 9;
+    changed[value] = changed[value] == '1' ? '2' : '1';
+    EXPECT_TRUE(page.UpdateStats(changed, descriptions));
+    EXPECT_EQ(page.rendered(), rendered + 1);
+    EXPECT_EQ(Written(), Rendered(changed));
+}
+
+TEST_F(WatchedPageTest, KeepsThePageWhenTheResponseIsMalformed) {
+    page.UpdateName("mibalolox482");
+    ASSERT_TRUE(page.UpdateStats(body, descriptions));
+    string before = Written();
+    EXPECT_THROW(page.UpdateStats(body.substr(0, body.size() / 2), descriptions), runtime_error);
+    EXPECT_EQ(Written(), before);
+    // and the good response is still recognised as the current one
+    EXPECT_FALSE(page.UpdateStats(body, descriptions));
+}
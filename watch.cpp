@@ -0,0 +1,176 @@
+#include "watch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "main.h"
+#include "binary_io.h"
+#include "logging.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "profiler.h"
+#include "request_scheduler.h"
+#include "response_cache.h"
+#include "snapshot_log.h"
+
+using namespace std;
+
+// names rarely change and cost a request of their own
+static const chrono::hours personaRefresh(1);
+
+WatchedPage::WatchedPage(const StatsRenderer &renderer) : renderer(renderer) {
+    UpdateName(name);
+    for (size_t i = 0; i < sections.size(); i++) {
+        RenderSection(i);
+    }
+}
+
+void WatchedPage::RenderSection(size_t index) {
+    ostringstream out;
+    renderer.RenderSection(statSections[index], current, out);
+    sections[index] = out.str();
+    renderedCount++;
+}
+
+bool WatchedPage::UpdateStats(const string &body, const StatDescriptionIndex &descriptions) {
+    uint64_t hash = HashBytes(body);
+    if (bodyHash == hash) {
+        return false;
+    }
+    PlayerStats stats = ParsePlayerStats(body, descriptions);
+    bodyHash = hash;
+
+    bool changed = false;
+    PlayerStats previous = std::move(current);
+    current = std::move(stats);
+    for (size_t i = 0; i < sections.size(); i++) {
+        const StatColumns &before = previous.section(statSections[i]);
+        const StatColumns &after = current.section(statSections[i]);
+        if (before.ids != after.ids || before.values != after.values) {
+            RenderSection(i);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool WatchedPage::UpdateName(const string &newName) {
+    if (newName == name && !title.empty()) {
+        return false;
+    }
+    name = newName;
+    ostringstream out;
+    renderer.RenderTitle(name, out);
+    title = out.str();
+    renderedCount++;
+    return true;
+}
+
+void WatchedPage::Write(ostream &out) const {
+    out << title;
+    for (auto &section: sections) {
+        out << section;
+    }
+}
+
+// written next to path and renamed over it, so readers see the old page or the new one, never half
+static bool ReplaceFile(const string &path, const WatchedPage &page, OutputBuffer &output) {
+    string temp = path + ".tmp";
+    if (!output.Open(temp)) {
+        fprintf(stderr, "Error: could not open %s for writing\n", temp.c_str());
+        return false;
+    }
+    page.Write(output.stream());
+    error_code ec;
+    if (!output.Close()) {
+        fprintf(stderr, "Error: could not write %s\n", temp.c_str());
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    filesystem::rename(temp, path, ec);
+    if (ec) {
+        fprintf(stderr, "Error: could not replace %s: %s\n", path.c_str(), ec.message().c_str());
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+int RunWatch(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache) {
+    string apiUrl = BuildApiUrl(options.apiBase, statsEndpoint, options.apiKey, options.steamId);
+    string playerUrl = BuildApiUrl(options.apiBase, playerSummariesEndpoint, options.apiKey, options.steamId);
+    auto interval = chrono::seconds(options.watchInterval);
+
+    StatsRenderer renderer;
+    WatchedPage page(renderer);
+    OutputBuffer output;
+    // validators of the last response, sent back so an unchanged profile can be answered with a 304
+    optional<CacheEntry> validators;
+    optional<chrono::steady_clock::time_point> namedAt;
+    bool written = false;
+    // every tick's response, keeps its capacity
+    string body;
+    ResponseSink sink{
+            [&](const char *data, size_t size) {
+                body.append(data, size);
+                return true;
+            },
+            [&] { body.clear(); }};
+
+    Log(Verbosity::Normal, "Watching %s, checking every %us\n", options.steamId.c_str(), options.watchInterval);
+    for (auto tick = chrono::steady_clock::now();; tick = max(tick + interval, chrono::steady_clock::now())) {
+        bool changed = false;
+        uint64_t renderedBefore = page.rendered();
+        if (!namedAt || tick - *namedAt >= personaRefresh) {
+            changed |= page.UpdateName(getPersonaName(playerUrl, cache, options.steamId));
+            namedAt = tick;
+        }
+
+        curl_slist *headers = validators ? ConditionalRequestHeaders(*validators) : nullptr;
+        body.clear();
+        ScheduledResponse response = RequestScheduler::Get().Fetch(apiUrl, headers, sink, RequestPriority::Background,
+                                                                   options.steamId);
+        curl_slist_free_all(headers);
+        const HttpResult &result = response.result;
+        if (!response.ok()) {
+            fprintf(stderr, "Error: could not fetch stats for %s (%s), trying again in %us\n",
+                    options.steamId.c_str(),
+                    response.overBudget ? "daily API budget spent" : curl_easy_strerror(result.code),
+                    options.watchInterval);
+        } else if (result.status != 304) {
+            if (!result.validators.etag.empty() || !result.validators.lastModified.empty()) {
+                validators = CacheEntry{0, result.validators.etag, result.validators.lastModified, ""};
+            }
+            try {
+                if (page.UpdateStats(body, descriptions)) {
+                    changed = true;
+                    if (!options.historyDir.empty() && !options.offline) {
+                        RecordSnapshot(options.historyDir, options.steamId, page.stats());
+                    }
+                }
+            } catch (const exception &e) {
+                fprintf(stderr, "Error: %s\n", e.what());
+            }
+        }
+
+        if (changed || !written) {
+            ProfileScope render(Phase::Render, options.steamId);
+            if (ReplaceFile(options.output, page, output)) {
+                written = true;
+                Log(Verbosity::Normal, "Updated %s, %llu of %zu parts rendered again\n", options.output.c_str(),
+                    (unsigned long long) (page.rendered() - renderedBefore), size(statSections) + 1);
+            } else if (!written) {
+                // not even the first page could be written, later ones won't fare better
+                return EXIT_FAILURE;
+            }
+        } else {
+            Log(Verbosity::Verbose, "No changes for %s\n", options.steamId.c_str());
+        }
+        this_thread::sleep_until(tick + interval);
+    }
+}
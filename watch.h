@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "data_classes.h"
+#include "stats_renderer.h"
+
+struct Options;
+class StatDescriptionIndex;
+class ResponseCache;
+
+// one player's rendered page and what it was rendered from. A stats response that is byte for
+// byte the last one costs a hash; one that isn't is parsed, and only the sections whose stats
+// differ are rendered again.
+class WatchedPage {
+public:
+    explicit WatchedPage(const StatsRenderer &renderer);
+
+    // false if nothing on the page changed. Throws runtime_error if body is not a stats response.
+    bool UpdateStats(const std::string &body, const StatDescriptionIndex &descriptions);
+    bool UpdateName(const std::string &name);
+
+    // the same as StatsRenderer::Render of the current stats and name
+    void Write(std::ostream &out) const;
+
+    const PlayerStats &stats() const { return current; }
+    // title and sections rendered since the page was made
+    uint64_t rendered() const { return renderedCount; }
+
+private:
+    void RenderSection(size_t index);
+
+    const StatsRenderer &renderer;
+    std::optional<uint64_t> bodyHash;
+    PlayerStats current;
+    std::string name = "User";
+    std::string title;
+    std::array<std::string, std::size(statSections)> sections;
+    uint64_t renderedCount = 0;
+};
+
+// --watch: renders options.steamId's stats to options.output every options.watchInterval seconds
+// until the process is stopped, replacing the file only when something changed. Persona names are
+// looked up far less often than stats. cache may be null. Only returns, with the process exit code,
+// if the output can't be written at all.
+int RunWatch(const Options &options, const StatDescriptionIndex &descriptions, const ResponseCache *cache);
@@ -0,0 +1,100 @@
+#include "work_stealing_pool.h"
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        queues.push_back(make_unique<TaskQueue>());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkStealingPool::Run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::ForEach(size_t count, const function<void(size_t, unsigned)> &task) {
+    if (count == 0) {
+        return;
+    }
+    unique_lock<mutex> lock(stateMutex);
+    // nobody is running, the queues can be filled without their locks
+    size_t threadCount = threads.size();
+    for (size_t i = 0; i < threadCount; i++) {
+        for (size_t t = count * i / threadCount; t < count * (i + 1) / threadCount; t++) {
+            queues[i]->tasks.push_back(t);
+        }
+    }
+    body = &task;
+    running = (unsigned) threadCount;
+    generation++;
+    started.notify_all();
+    finished.wait(lock, [this] { return running == 0; });
+    body = nullptr;
+}
+
+bool WorkStealingPool::Next(unsigned worker, size_t &task) {
+    {
+        TaskQueue &own = *queues[worker];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // the victim's last tasks are the ones it would get to last itself
+    for (size_t i = 1; i < queues.size(); i++) {
+        TaskQueue &victim = *queues[(worker + i) % queues.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            stolenCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Run(unsigned worker) {
+    uint64_t seen = 0;
+    while (true) {
+        const function<void(size_t, unsigned)> *task;
+        {
+            unique_lock<mutex> lock(stateMutex);
+            started.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            task = body;
+        }
+
+        // tasks are only added before the threads are woken, once every queue is empty this
+        // thread has nothing left to do for this round
+        size_t index;
+        while (Next(worker, index)) {
+            (*task)(index, worker);
+        }
+
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (--running == 0) {
+                finished.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of threads for data-parallel loops. Every thread gets its own queue holding a
+// contiguous share of the tasks, works through it front to back and, once it runs dry, steals
+// from the back of the others' queues, so uneven tasks still keep every thread busy. Unlike
+// WorkerPool, tasks know which thread runs them, so they can accumulate into per-thread state
+// without locking.
+class WorkStealingPool {
+public:
+    // 0 picks the number of hardware threads
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // calls body(task, worker) for every task in [0, count) with worker in [0, size()) and
+    // returns once all of them are done. Not reentrant.
+    void ForEach(size_t count, const std::function<void(size_t task, unsigned worker)> &body);
+
+    size_t size() const { return threads.size(); }
+    // tasks that ran on another thread than the one they were handed to, over the pool's lifetime
+    uint64_t stolen() const { return stolenCount; }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void Run(unsigned worker);
+    bool Next(unsigned worker, size_t &task);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex stateMutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const std::function<void(size_t, unsigned)> *body = nullptr;
+    // bumped by every ForEach, threads wait for it to change
+    uint64_t generation = 0;
+    // threads still working on the current ForEach
+    unsigned running = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> stolenCount{0};
+};
@@ -0,0 +1,62 @@
+#include "worker_pool.h"
+
+using namespace std;
+
+WorkerPool::WorkerPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::Run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Submit(function<void()> task) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void WorkerPool::Wait() {
+    unique_lock<mutex> lock(queueMutex);
+    idle.wait(lock, [this] { return tasks.empty() && active == 0; });
+}
+
+void WorkerPool::Run() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            active++;
+        }
+
+        task();
+
+        {
+            lock_guard<mutex> lock(queueMutex);
+            active--;
+            if (tasks.empty() && active == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of threads draining a shared FIFO of tasks
+class WorkerPool {
+public:
+    // 0 picks the number of hardware threads
+    explicit WorkerPool(unsigned threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void Submit(std::function<void()> task);
+    // blocks until every submitted task has finished
+    void Wait();
+
+    size_t size() const { return threads.size(); }
+
+private:
+    void Run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable idle;
+    size_t active = 0;
+    bool stopping = false;
+};